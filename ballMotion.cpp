@@ -0,0 +1,50 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// File: ballMotion.cpp
+//
+// Desc: Closed form motion of a ball under friction.
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "ballMotion.h"
+
+sim::CBallMotion::CBallMotion(void)
+{
+	m_time = 0;
+	m_x = m_z = 0;
+	m_vx = m_vz = 0;
+	m_friction = 0;
+	m_speed = 0;
+	m_rest = 0;
+}
+
+void sim::CBallMotion::start(double time, float x, float z, float vx, float vz, float friction)
+{
+	m_time = time;
+	m_x = x;
+	m_z = z;
+	m_vx = vx;
+	m_vz = vz;
+	m_friction = friction;
+	m_speed = std::sqrt(vx * vx + vz * vz);
+	m_rest = restTime(friction, vx, vz);
+}
+
+double sim::CBallMotion::getTimeAt(float distance) const
+{
+	if (distance <= 0)
+		return m_time;
+	if (distance > getRestDistance())
+		return DBL_MAX;
+	return m_time + travelTime(m_friction, distance / (BALL_TIME_SCALE * m_speed));
+}
+
+double sim::CBallMotion::getRestTime(void) const
+{
+	return m_rest == FLT_MAX ? DBL_MAX : m_time + m_rest;
+}
+
+float sim::CBallMotion::getRestDistance(void) const
+{
+	return m_rest == FLT_MAX ? FLT_MAX : BALL_TIME_SCALE * m_speed * decayTravel(m_friction, m_rest);
+}
@@ -0,0 +1,125 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// File: ballMotion.h
+//
+// Desc: Closed form motion of a ball under friction. The velocity decays exponentially,
+//
+//           v(t) = v0 e^(-k t)
+//           p(t) = p0 + BALL_TIME_SCALE v0 (1 - e^(-k t)) / k
+//
+//       so the state of a ball at any time costs the same as its state at the next frame,
+//       and two steps of t / 2 end where one step of t does: friction does not depend on the
+//       frame rate, unlike the per-frame damping of the original ballUpdate. A ball stops
+//       once its faster axis falls below BALL_REST_SPEED, as ballStep stops it. k = 0 is
+//       the motion without friction.
+//
+//       The paths know nothing of walls and balls; they hold from one contact to the next.
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __ballMotionH__
+#define __ballMotionH__
+
+#include "ballStore.h"
+#include <cfloat>
+#include <cmath>
+
+namespace sim
+{
+	// part of the velocity left after time t, e^(-k t)
+	inline float decayFactor(float friction, float t)
+	{
+		return friction > 0 ? std::exp(-friction * t) : 1.0f;
+	}
+
+	// time the start velocity takes for the path the ball covers in t, (1 - e^(-k t)) / k
+	inline float decayTravel(float friction, float t)
+	{
+		return friction > 0 ? -std::expm1(-friction * t) / friction : t;
+	}
+
+	// inverse of decayTravel, FLT_MAX when the ball never gets that far
+	inline float travelTime(float friction, float travel)
+	{
+		if (friction <= 0)
+			return travel;
+		float f = friction * travel;
+		return f < 1 ? -std::log1p(-f) / friction : FLT_MAX;
+	}
+
+	// time until a ball of velocity (vx, vz) stops, FLT_MAX without friction
+	inline float restTime(float friction, float vx, float vz)
+	{
+		float v = std::max(std::fabs(vx), std::fabs(vz));
+		if (v <= BALL_REST_SPEED)
+			return 0;
+		return friction > 0 ? std::log(v / BALL_REST_SPEED) / friction : FLT_MAX;
+	}
+
+	//
+	// The path of one ball from a start state, evaluated at any later time in O(1). The
+	// evaluations of every frame are inline.
+	//
+
+	class CBallMotion {
+	public:
+		CBallMotion(void);
+
+		// the ball at (x, z) with velocity (vx, vz) at game time time
+		void start(double time, float x, float z, float vx, float vz, float friction);
+
+		void getPosition(double time, float& x, float& z) const;
+		void getVelocity(double time, float& vx, float& vz) const;
+
+		float getDistance(double time) const;    // length of the path up to time
+		double getTimeAt(float distance) const;  // when the path is that long, DBL_MAX when never
+
+		double getStartTime(void) const { return m_time; }
+		void getStartVelocity(float& vx, float& vz) const
+		{
+			vx = m_vx;
+			vz = m_vz;
+		}
+		double getRestTime(void) const;   // DBL_MAX when the ball never stops
+		float getRestDistance(void) const;  // length of the whole path, FLT_MAX when endless
+		float getSpeed(void) const { return m_speed; }  // at the start
+
+	private:
+		double              m_time;
+		float               m_x, m_z;
+		float               m_vx, m_vz;
+		float               m_friction;
+		float               m_speed;
+		float               m_rest;  // restTime() from the start
+	};
+
+	// past the rest time the ball stays where it stopped
+	inline void CBallMotion::getPosition(double time, float& x, float& z) const
+	{
+		float t = std::min((float)(time - m_time), m_rest);
+		float d = BALL_TIME_SCALE * decayTravel(m_friction, t);
+		x = m_x + d * m_vx;
+		z = m_z + d * m_vz;
+	}
+
+	inline void CBallMotion::getVelocity(double time, float& vx, float& vz) const
+	{
+		float t = (float)(time - m_time);
+		if (t >= m_rest)
+		{
+			vx = vz = 0;
+			return;
+		}
+		float decay = decayFactor(m_friction, t);
+		vx = m_vx * decay;
+		vz = m_vz * decay;
+	}
+
+	inline float CBallMotion::getDistance(double time) const
+	{
+		float t = std::min((float)(time - m_time), m_rest);
+		return BALL_TIME_SCALE * m_speed * decayTravel(m_friction, t);
+	}
+}
+
+#endif // __ballMotionH__
@@ -0,0 +1,105 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// File: ballStore.cpp
+//
+// Desc: Struct-of-arrays storage for the balls of the simulation.
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "ballStore.h"
+#include "ballMotion.h"
+
+void sim::CBallStore::reserve(int count)
+{
+	m_x.reserve(count);
+	m_z.reserve(count);
+	m_vx.reserve(count);
+	m_vz.reserve(count);
+	m_radius.reserve(count);
+	m_entities.reserve(count);
+}
+
+void sim::CBallStore::clear(void)
+{
+	m_x.clear();
+	m_z.clear();
+	m_vx.clear();
+	m_vz.clear();
+	m_radius.clear();
+	m_entities.clear();
+}
+
+int sim::CBallStore::add(float x, float z, float radius)
+{
+	m_x.push_back(x);
+	m_z.push_back(z);
+	m_vx.push_back(0);
+	m_vz.push_back(0);
+	m_radius.push_back(radius);
+	return m_entities.add();
+}
+
+void sim::CBallStore::integrate(float timeDiff, float friction, float xLimit, float zLimit)
+{
+	// dead balls have zero velocity (see destroy), so they need no special case here
+	float* __restrict x = m_x.data();
+	float* __restrict z = m_z.data();
+	float* __restrict vx = m_vx.data();
+	float* __restrict vz = m_vz.data();
+	const float* __restrict radius = m_radius.data();
+	int count = size();
+	float travel = decayTravel(friction, timeDiff);
+	float decay = decayFactor(friction, timeDiff);
+
+	for (int i = 0; i < count; i++)
+		ballStepDecay(x[i], z[i], vx[i], vz[i], radius[i], travel, decay, xLimit, zLimit);
+}
+
+void sim::CBallStore::bounce(float xMin, float xMax, float zMin, float zMax)
+{
+	float* __restrict x = m_x.data();
+	float* __restrict z = m_z.data();
+	float* __restrict vx = m_vx.data();
+	float* __restrict vz = m_vz.data();
+	const float* __restrict radius = m_radius.data();
+	int count = size();
+
+	for (int i = 0; i < count; i++)
+	{
+		float r = radius[i];
+		bool left = (x[i] < xMin + r) & (vx[i] < 0);
+		bool right = (x[i] > xMax - r) & (vx[i] > 0);
+		bool bottom = (z[i] < zMin + r) & (vz[i] < 0);
+		bool top = (z[i] > zMax - r) & (vz[i] > 0);
+
+		x[i] = std::min(std::max(x[i], xMin + r), xMax - r);
+		z[i] = select(top, zMax - r, select(bottom, zMin + r, z[i]));
+		vx[i] = select(left | right, -vx[i], vx[i]);
+		vz[i] = select(bottom | top, -vz[i], vz[i]);
+	}
+}
+
+void sim::CBallStore::damp(float rate)
+{
+	float* __restrict vx = m_vx.data();
+	float* __restrict vz = m_vz.data();
+	int count = size();
+
+	for (int i = 0; i < count; i++)
+	{
+		vx[i] *= rate;
+		vz[i] *= rate;
+	}
+}
+
+float sim::CBallStore::maxSpeed(void) const
+{
+	const float* __restrict vx = m_vx.data();
+	const float* __restrict vz = m_vz.data();
+	int count = size();
+	float best = 0;
+
+	for (int i = 0; i < count; i++)
+		best = std::max(best, vx[i] * vx[i] + vz[i] * vz[i]);
+	return std::sqrt(best);
+}
@@ -0,0 +1,149 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// File: ballStore.h
+//
+// Desc: Struct-of-arrays storage for the balls of the simulation. Only the data the physics
+//       touches every frame (center, velocity, radius) lives here, one contiguous column per
+//       field, so the per-frame passes stream through memory. Which balls are alive is kept
+//       by a CEntitySet (entityStore.h): a bitset, a dense list of the live balls and handles
+//       that go stale when their ball dies. Render data (transforms, materials, meshes) stays
+//       in the front end.
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __ballStoreH__
+#define __ballStoreH__
+
+#include "entityStore.h"
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace sim
+{
+	const float BALL_TIME_SCALE = 3.3f;  // game units per time unit, see ballUpdate
+	const float BALL_REST_SPEED = 0.01f;  // below this speed a ball is stopped
+	const float BALL_LIMIT_X = 3, BALL_LIMIT_Z = 3.5f;  // clamp of ballStep on the classic table
+
+	// branch free c ? a : b, keeps the loops below free of control flow so they vectorize
+	inline float select(bool c, float a, float b)
+	{
+		unsigned int ua, ub;
+		std::memcpy(&ua, &a, sizeof(float));
+		std::memcpy(&ub, &b, sizeof(float));
+		unsigned int mask = 0u - (unsigned int)c;
+		unsigned int r = (ua & mask) | (ub & ~mask);
+		float f;
+		std::memcpy(&f, &r, sizeof(float));
+		return f;
+	}
+
+	//
+	// One ballUpdate step, written without branches so that a loop over the columns can be
+	// vectorized. Moves the ball and clamps it inside the table, |x| < xLimit - radius and
+	// z < zLimit - radius; the clamp only corrects one axis per step (the sides first, then the
+	// top) as the original ballUpdate does.
+	//
+	// Under friction the ball moves as far as its start velocity would in travel and keeps
+	// decay of it (decayTravel and decayFactor, see ballMotion.h); ballStep is the step
+	// without friction.
+	//
+	inline void ballStepDecay(float& x, float& z, float& vx, float& vz, float radius, float travel, float decay,
+		float xLimit = BALL_LIMIT_X, float zLimit = BALL_LIMIT_Z)
+	{
+		bool moving = std::max(std::fabs(vx), std::fabs(vz)) > BALL_REST_SPEED;
+
+		float tX = x + BALL_TIME_SCALE * travel * vx;
+		float tZ = z + BALL_TIME_SCALE * travel * vz;
+
+		float xMax = xLimit - radius;
+		float zMax = zLimit - radius;
+		float cX = std::min(std::max(tX, -xMax), xMax);
+		bool xFree = (tX < xMax) & (tX > -xMax);
+		float cZ = select(xFree, std::min(tZ, zMax), tZ);
+
+		x = select(moving, cX, x);
+		z = select(moving, cZ, z);
+		vx = select(moving, vx * decay, 0.0f);
+		vz = select(moving, vz * decay, 0.0f);
+	}
+
+	inline void ballStep(float& x, float& z, float& vx, float& vz, float radius, float timeDiff)
+	{
+		ballStepDecay(x, z, vx, vz, radius, timeDiff, 1.0f);
+	}
+
+	class CBallStore {
+	public:
+		CBallStore(void) {}
+
+		void reserve(int count);
+		void clear(void);
+		int add(float x, float z, float radius);  // returns the index of the new ball
+
+		int size(void) const { return (int)m_x.size(); }
+
+		void destroy(int i)
+		{
+			m_entities.destroy(i);
+			m_vx[i] = 0;
+			m_vz[i] = 0;
+		}
+		bool isAlive(int i) const { return m_entities.isAlive(i); }
+		const std::vector<int>& getLive(void) const { return m_entities.getLive(); }  // unordered
+		EntityHandle getHandle(int i) const { return m_entities.getHandle(i); }
+		bool isValid(EntityHandle h) const { return m_entities.isValid(h); }
+
+		// f(i) for every live ball in ascending index order; it may destroy i
+		template <class F> void forEachAlive(F f) const { m_entities.forEachAlive(f); }
+
+		float getX(int i) const { return m_x[i]; }
+		float getZ(int i) const { return m_z[i]; }
+		float getVelocity_X(int i) const { return m_vx[i]; }
+		float getVelocity_Z(int i) const { return m_vz[i]; }
+		float getRadius(int i) const { return m_radius[i]; }
+
+		void setCenter(int i, float x, float z)
+		{
+			m_x[i] = x;
+			m_z[i] = z;
+		}
+		void setPower(int i, float vx, float vz)
+		{
+			m_vx[i] = vx;
+			m_vz[i] = vz;
+		}
+
+		// raw columns, for bulk passes
+		float* columnX(void) { return m_x.data(); }
+		float* columnZ(void) { return m_z.data(); }
+		float* columnVX(void) { return m_vx.data(); }
+		float* columnVZ(void) { return m_vz.data(); }
+		const float* columnX(void) const { return m_x.data(); }
+		const float* columnZ(void) const { return m_z.data(); }
+		const float* columnRadius(void) const { return m_radius.data(); }
+
+		// bytes of the columns and the entity set for size() balls
+		size_t getBytes(void) const { return 5 * size() * sizeof(float) + m_entities.getBytes(); }
+
+		// ballUpdate for every ball in one pass over the columns, with friction the decay
+		// rate of ballMotion.h and the clamp of ballStepDecay
+		void integrate(float timeDiff, float friction = 0, float xLimit = BALL_LIMIT_X, float zLimit = BALL_LIMIT_Z);
+
+		// reflects the balls off the walls of the box, pass -FLT_MAX/FLT_MAX for an open side
+		void bounce(float xMin, float xMax, float zMin, float zMax);
+		void damp(float rate);  // scales every velocity by rate
+		float maxSpeed(void) const;
+
+	private:
+		std::vector<float>          m_x;
+		std::vector<float>          m_z;
+		std::vector<float>          m_vx;
+		std::vector<float>          m_vz;
+		std::vector<float>          m_radius;
+		CEntitySet                  m_entities;
+	};
+}
+
+#endif // __ballStoreH__
@@ -0,0 +1,230 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// File: benchBallStore.cpp
+//
+// Desc: Compares the per-frame ball integration over the old array-of-CSphere layout (center
+//       and velocity packed with the transform, material and mesh pointer) against the
+//       struct-of-arrays CBallStore, for 20, 10k and 1M balls. Reports time per ball and, on
+//       Linux when perf events are available, the cache misses per ball.
+//
+//       usage: benchBallStore [-updates U]   (ball updates per measurement, default 50M)
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "ballStore.h"
+#include "simCore.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// -----------------------------------------------------------------------------
+// Old layout: what g_sphere[BALLNUM] looked like before the split
+// -----------------------------------------------------------------------------
+
+struct CFatSphere {
+	float               center_x, center_y, center_z;
+	float               m_radius;
+	float               m_velocity_x;
+	float               m_velocity_z;
+	float               m_mLocal[16];  // D3DXMATRIX
+	unsigned char       m_mtrl[68];    // D3DMATERIAL9
+	void*               m_pSphereMesh;
+};
+
+// ballUpdate + setCenter as they ran on CSphere: the step rebuilds the local transform
+static void integrateFat(std::vector<CFatSphere>& spheres, float timeDiff)
+{
+	for (size_t i = 0; i < spheres.size(); i++)
+	{
+		CFatSphere& s = spheres[i];
+		if (s.m_pSphereMesh == NULL)  // isNull()
+			continue;
+		sim::ballStep(s.center_x, s.center_z, s.m_velocity_x, s.m_velocity_z, s.m_radius, timeDiff);
+		s.m_mLocal[12] = s.center_x;
+		s.m_mLocal[13] = s.center_y;
+		s.m_mLocal[14] = s.center_z;
+	}
+}
+
+// -----------------------------------------------------------------------------
+// Cache miss counter (perf events, Linux only)
+// -----------------------------------------------------------------------------
+
+class CCacheMissCounter {
+public:
+	CCacheMissCounter(void)
+	{
+		m_fd = -1;
+#if defined(__linux__)
+		struct perf_event_attr attr;
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = PERF_TYPE_HW_CACHE;
+		attr.config = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+			(PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+		attr.disabled = 1;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		m_fd = (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+	}
+	~CCacheMissCounter(void)
+	{
+#if defined(__linux__)
+		if (m_fd >= 0)
+			close(m_fd);
+#endif
+	}
+
+	bool isAvailable(void) const { return m_fd >= 0; }
+
+	void start(void)
+	{
+#if defined(__linux__)
+		if (m_fd < 0)
+			return;
+		ioctl(m_fd, PERF_EVENT_IOC_RESET, 0);
+		ioctl(m_fd, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+	}
+
+	long long stop(void)
+	{
+		long long count = -1;
+#if defined(__linux__)
+		if (m_fd < 0)
+			return -1;
+		ioctl(m_fd, PERF_EVENT_IOC_DISABLE, 0);
+		if (read(m_fd, &count, sizeof(count)) != sizeof(count))
+			count = -1;
+#endif
+		return count;
+	}
+
+private:
+	int                 m_fd;
+};
+
+// -----------------------------------------------------------------------------
+// Benchmark
+// -----------------------------------------------------------------------------
+
+struct Result {
+	double              nsPerBall;
+	double              missesPerBall;  // negative when not measured
+};
+
+static float frand(unsigned int& state)
+{
+	state = state * 1664525u + 1013904223u;
+	return (state >> 8) / 16777216.0f;
+}
+
+template <class F>
+static Result measure(CCacheMissCounter& counter, long long updates, int count, F pass)
+{
+	int passes = (int)(updates / count);
+	if (passes < 1)
+		passes = 1;
+
+	pass();  // warm up
+
+	counter.start();
+	std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+	for (int p = 0; p < passes; p++)
+		pass();
+	double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+	long long misses = counter.stop();
+
+	Result r;
+	r.nsPerBall = ns / ((double)passes * count);
+	r.missesPerBall = misses >= 0 ? (double)misses / ((double)passes * count) : -1;
+	return r;
+}
+
+int main(int argc, char* argv[])
+{
+	long long updates = 50000000;
+	for (int i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "-updates") && i + 1 < argc) updates = atoll(argv[++i]);
+		else
+		{
+			printf("usage: benchBallStore [-updates U]\n");
+			return 1;
+		}
+	}
+
+	const int counts[] = { BALLNUM, 10000, 1000000 };
+	const float dt = 16 * 0.0007f;
+	CCacheMissCounter counter;
+
+	// the store as the game fills it, and the columns integrate() streams: x, z, vx, vz, radius
+	sim::CBallStore layout;
+	for (int i = 0; i < 64; i++)
+		layout.add(0, 0, (float)M_RADIUS);
+	double storeBytes = (double)layout.getBytes() / layout.size();
+	double streamedBytes = 5 * sizeof(float);
+	printf("bytes per ball: CSphere layout %d, CBallStore %.2f (%.0f streamed by integrate)\n",
+		(int)sizeof(CFatSphere), storeBytes, streamedBytes);
+	if (!counter.isAvailable())
+		printf("perf events unavailable, cache misses not measured (streamed lines per ball: %.2f vs %.2f)\n",
+			sizeof(CFatSphere) / 64.0, streamedBytes / 64.0);
+	printf("%10s %14s %14s %16s %16s\n", "balls", "aos ns/ball", "soa ns/ball", "aos L1 miss/ball", "soa L1 miss/ball");
+
+	for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++)
+	{
+		int count = counts[c];
+		unsigned int state = 12345;
+
+		std::vector<CFatSphere> fat(count);
+		sim::CBallStore store;
+		store.reserve(count);
+		for (int i = 0; i < count; i++)
+		{
+			float x = (frand(state) - 0.5f) * 5.6f;
+			float z = (frand(state) - 0.5f) * 5.9f;
+			float vx = (frand(state) - 0.5f) * 2;
+			float vz = (frand(state) - 0.5f) * 2;
+
+			CFatSphere& s = fat[i];
+			memset(&s, 0, sizeof(s));
+			s.center_x = x;
+			s.center_y = (float)M_RADIUS;
+			s.center_z = z;
+			s.m_radius = (float)M_RADIUS;
+			s.m_velocity_x = vx;
+			s.m_velocity_z = vz;
+			s.m_pSphereMesh = &s;
+
+			int id = store.add(x, z, (float)M_RADIUS);
+			store.setPower(id, vx, vz);
+		}
+
+		Result aos = measure(counter, updates, count, [&]() { integrateFat(fat, dt); });
+		Result soa = measure(counter, updates, count, [&]() { store.integrate(dt); });
+
+		char aosMiss[32], soaMiss[32];
+		if (aos.missesPerBall >= 0)
+		{
+			snprintf(aosMiss, sizeof(aosMiss), "%.4f", aos.missesPerBall);
+			snprintf(soaMiss, sizeof(soaMiss), "%.4f", soa.missesPerBall);
+		}
+		else
+		{
+			strcpy(aosMiss, "n/a");
+			strcpy(soaMiss, "n/a");
+		}
+		printf("%10d %14.3f %14.3f %16s %16s\n", count, aos.nsPerBall, soa.nsPerBall, aosMiss, soaMiss);
+	}
+	return 0;
+}
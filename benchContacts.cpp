@@ -0,0 +1,125 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// File: benchContacts.cpp
+//
+// Desc: Ball to ball contact solver under load. Fills a closed box with thousands of moving
+//       balls (30% of the area covered, radius scaled to the count) and times the dynamic
+//       step (integrate, bounce, grid update, contact solve) with one thread and with the
+//       work-stealing pool.
+//
+//       usage: benchContacts [-steps S] [-threads T]   (T = 0: one per core)
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "contactSolver.h"
+#include "simCore.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+const float BOX = 2.8f;  // half size, inside the table clamp of ballStep
+
+struct Result {
+	double              stepMs;
+	double              solveMs;
+	double              contacts;
+	double              colours;
+	float               energy;  // kinetic energy at the end, equal masses
+};
+
+static float frand(unsigned int& state)
+{
+	state = state * 1664525u + 1013904223u;
+	return (state >> 8) / 16777216.0f;
+}
+
+static Result run(int count, int steps, sim::CWorkPool* pool)
+{
+	float radius = std::sqrt(0.3f * (2 * BOX) * (2 * BOX) / (count * 3.14159265f));
+	int side = (int)std::ceil(std::sqrt((float)count));
+	float spacing = 2 * BOX / side;
+
+	sim::CBallStore balls;
+	sim::CSpatialGrid grid;
+	sim::CContactSolver solver;
+	grid.init(-BOX, -BOX, BOX, BOX, 2 * radius);
+	balls.reserve(count);
+	solver.setPool(pool);
+
+	// jittered lattice, no overlap at the start
+	unsigned int state = 12345;
+	for (int i = 0; i < count; i++)
+	{
+		float jitter = 0.5f * (spacing - 2 * radius);
+		float x = -BOX + spacing * (i % side + 0.5f) + (frand(state) - 0.5f) * jitter;
+		float z = -BOX + spacing * (i / side + 0.5f) + (frand(state) - 0.5f) * jitter;
+		int id = balls.add(x, z, radius);
+		balls.setPower(id, (frand(state) - 0.5f) * 0.6f, (frand(state) - 0.5f) * 0.6f);
+		grid.insert(id, x, z);
+	}
+
+	const float dt = 16 * sim::GAME_TIME_PER_MS;
+	double solveNs = 0, contacts = 0, colours = 0;
+	std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+	for (int s = 0; s < steps; s++)
+	{
+		balls.integrate(dt);
+		balls.bounce(-BOX, BOX, -BOX, BOX);
+		for (int i = 0; i < count; i++)
+			grid.move(i, balls.getX(i), balls.getZ(i));
+
+		std::chrono::steady_clock::time_point s0 = std::chrono::steady_clock::now();
+		contacts += solver.solve(balls, grid, radius);
+		solveNs += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - s0).count();
+		colours += solver.getColours();
+	}
+	double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+
+	Result r;
+	r.stepMs = ns / steps * 1e-6;
+	r.solveMs = solveNs / steps * 1e-6;
+	r.contacts = contacts / steps;
+	r.colours = colours / steps;
+	r.energy = 0;
+	for (int i = 0; i < count; i++)
+		r.energy += 0.5f * (balls.getVelocity_X(i) * balls.getVelocity_X(i) + balls.getVelocity_Z(i) * balls.getVelocity_Z(i));
+	return r;
+}
+
+int main(int argc, char* argv[])
+{
+	int steps = 500;
+	int threads = 0;
+	for (int i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "-steps") && i + 1 < argc) steps = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-threads") && i + 1 < argc) threads = atoi(argv[++i]);
+		else
+		{
+			printf("usage: benchContacts [-steps S] [-threads T]\n");
+			return 1;
+		}
+	}
+
+	sim::CWorkPool pool(threads);
+	const int counts[] = { 1000, 4000, 16000, 64000 };
+
+	printf("workers %d, %d steps\n", pool.getWorkers(), steps);
+	printf("%8s %10s %9s %12s %12s %12s %12s %10s\n", "balls", "contacts", "colours",
+		"1T step ms", "1T solve ms", "NT step ms", "NT solve ms", "speedup");
+
+	for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++)
+	{
+		Result serial = run(counts[c], steps, NULL);
+		Result parallel = run(counts[c], steps, &pool);
+		if (std::fabs(serial.energy - parallel.energy) > 1e-3f * serial.energy)
+			printf("warning: serial and parallel runs diverged (%f vs %f)\n", serial.energy, parallel.energy);
+
+		printf("%8d %10.0f %9.1f %12.3f %12.3f %12.3f %12.3f %9.2fx\n", counts[c], serial.contacts,
+			parallel.colours, serial.stepMs, serial.solveMs, parallel.stepMs, parallel.solveMs,
+			parallel.solveMs > 0 ? serial.solveMs / parallel.solveMs : 0.0);
+	}
+	return 0;
+}
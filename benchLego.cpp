@@ -0,0 +1,423 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// File: benchLego.cpp
+//
+// Desc: Benchmark suite of the simulation core. Micro benchmarks of the ball and wall tests
+//       (CBall::ballUpdate / hitBy / hasIntersected, CWall::hitBy, CBallMotion::getPosition)
+//       over a sweep of ball counts and speeds, of the table geometry (CStaticGeometry::hitBy
+//       and sweep against a scan of every piece) over obstacle counts, of the layout (generateRandomPositions,
+//       SetupBlueBall) over ball counts, and a whole-frame macro benchmark: the non-rendering
+//       work of one Display() frame (paddle input and CGame::step, stepped and event driven,
+//       the snapshot the renderer interpolates, and recording, sorting and submitting the
+//       render list to the recording backend) on a fixed-seed table, and the cost of a
+//       profiler zone with the profiler off and on. Everything is deterministic, so two runs
+//       time the same work.
+//
+//       usage: benchLego [-iterations N] [-filter TEXT] [-json FILE] [-compare FILE]
+//                        [-threshold R]
+//
+//       The JSON goes to stdout (or -json FILE), the readable table to stderr. The exit code
+//       is the number of regressions against -compare.
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "benchUtil.h"
+#include "hudText.h"
+#include "profiler.h"
+#include "simCore.h"
+#include "simThread.h"
+#include "tableScene.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+const unsigned long long BENCH_SEED = 20240601;
+const float FRAME_DT = 16 * sim::GAME_TIME_PER_MS;
+
+static const int BALL_COUNTS[] = { 20, 1000, 100000 };
+static const float SPEEDS[] = { 0.5f, 2, 8 };
+static const int LAYOUT_COUNTS[] = { 20, 60, 120, 200 };  // 200 is close to a full table
+static const int OBSTACLE_COUNTS[] = { 3, 1000, 10000 };  // 3 is the classic table
+
+// balls spread over the table, moving at speed in random directions
+static void makeBalls(std::vector<sim::CBall>& balls, int count, float speed, sim::CRandom& random)
+{
+	balls.resize(count);
+	for (int i = 0; i < count; i++)
+	{
+		float angle = random.uniform(0, 6.28318531f);
+		balls[i].create();
+		balls[i].setCenter(random.uniform(sim::WALL_X_MIN, sim::WALL_X_MAX), random.uniform(sim::WALL_Z_MIN, sim::WALL_Z_MAX));
+		balls[i].setPower(speed * std::cos(angle), speed * std::sin(angle));
+	}
+}
+
+// pairs at up to two diameters apart, so about a quarter of them touch
+static void makePairs(std::vector<sim::CBall>& balls, std::vector<sim::Vec2>& others, int count, float speed,
+	sim::CRandom& random)
+{
+	makeBalls(balls, count, speed, random);
+	others.resize(count);
+	for (int i = 0; i < count; i++)
+	{
+		float angle = random.uniform(0, 6.28318531f);
+		float d = random.uniform(0, 4 * (float)M_RADIUS);
+		others[i].x = balls[i].getCenter().x + d * std::cos(angle);
+		others[i].z = balls[i].getCenter().z + d * std::sin(angle);
+	}
+}
+
+static void benchBalls(bench::CBenchSuite& suite)
+{
+	sim::CWall walls[3];  // top, right and left, as the classic table places them
+	std::vector<sim::CBall> balls, probes;
+	std::vector<sim::Vec2> others;
+	walls[0].create(6, 0.12f);
+	walls[0].setPosition(0.0f, 3.5f);
+	walls[1].create(0.12f, 7.12f);
+	walls[1].setPosition(3, 0.0f);
+	walls[2].create(0.12f, 7.12f);
+	walls[2].setPosition(-3, 0.0f);
+
+	for (size_t c = 0; c < sizeof(BALL_COUNTS) / sizeof(BALL_COUNTS[0]); c++)
+	{
+		for (size_t s = 0; s < sizeof(SPEEDS) / sizeof(SPEEDS[0]); s++)
+		{
+			int n = BALL_COUNTS[c];
+			float speed = SPEEDS[s];
+			sim::CRandom random(BENCH_SEED);
+
+			makeBalls(balls, n, speed, random);
+			suite.run("CBall::ballUpdate", { { "balls", (double)n }, { "speed", speed } }, n, [&]() {
+				for (int i = 0; i < n; i++)
+					balls[i].ballUpdate(FRAME_DT);
+			});
+
+			// the state a second of play ahead under friction, in one evaluation
+			std::vector<sim::CBallMotion> paths(n);
+			for (int i = 0; i < n; i++)
+			{
+				sim::Vec2 p = balls[i].getCenter();
+				paths[i].start(0, p.x, p.z, balls[i].getVelocity_X(), balls[i].getVelocity_Z(), sim::FRICTION);
+			}
+			suite.run("CBallMotion::getPosition", { { "balls", (double)n }, { "speed", speed } }, n, [&]() {
+				float sum = 0;
+				for (int i = 0; i < n; i++)
+				{
+					float x, z;
+					paths[i].getPosition(1000 * sim::GAME_TIME_PER_MS, x, z);
+					sum += x + z;
+				}
+				bench::keep(sum);
+			});
+
+			// the probes are copied, so every batch tests the same positions
+			makePairs(probes, others, n, speed, random);
+			suite.run("CBall::hitBy", { { "balls", (double)n }, { "speed", speed } }, n, [&]() {
+				int hits = 0;
+				for (int i = 0; i < n; i++)
+				{
+					sim::CBall ball = probes[i];
+					hits += ball.hitBy(others[i].x, others[i].z, (float)M_RADIUS);
+				}
+				bench::keep(hits);
+			});
+
+			suite.run("CBall::hasIntersected", { { "balls", (double)n }, { "speed", speed } }, n, [&]() {
+				int hits = 0;
+				for (int i = 0; i < n; i++)
+				{
+					sim::CBall ball = probes[i];
+					hits += ball.hasIntersected(others[i].x, others[i].z, (float)M_RADIUS);
+				}
+				bench::keep(hits);
+			});
+
+			// every ball against the three walls of the table, about half of them touch one
+			makeBalls(balls, n, speed, random);
+			for (int i = 0; i < n; i++)
+			{
+				sim::Vec2 p = balls[i].getCenter();
+				float x = random.uniform(2.6f, 2.9f);
+				balls[i].setCenter(p.x > 0 ? x : -x, p.z * 1.05f);
+			}
+			suite.run("CWall::hitBy", { { "balls", (double)n }, { "speed", speed } }, n, [&]() {
+				float sum = 0;
+				for (int i = 0; i < n; i++)
+				{
+					sim::CBall ball = balls[i];
+					for (int w = 0; w < 3; w++)
+						walls[w].hitBy(ball);
+					sum += ball.getVelocity_X();
+				}
+				bench::keep(sum);
+			});
+		}
+	}
+}
+
+// the classic table and tables of many small boxes: the contacts and the first piece on the
+// path of a ball through the hierarchy, and the contacts by a scan of every piece
+static void benchGeometry(bench::CBenchSuite& suite)
+{
+	const int PROBES = 1000;
+	sim::CRandom random(BENCH_SEED);
+	std::vector<sim::CBall> balls;
+	makeBalls(balls, PROBES, 2, random);
+
+	for (size_t c = 0; c < sizeof(OBSTACLE_COUNTS) / sizeof(OBSTACLE_COUNTS[0]); c++)
+	{
+		int n = OBSTACLE_COUNTS[c];
+		sim::CStaticGeometry geometry;
+		if (n == 3)
+			geometry.makeClassic();
+		else
+		{
+			// about one box in ten of the table is covered
+			float size = 0.6f * std::sqrt(6 * 7.0f / n);
+			for (int i = 0; i < n; i++)
+				geometry.addBox(random.uniform(-3, 3), random.uniform(-3.5f, 3.5f), size, size);
+			geometry.build();
+		}
+
+		suite.run("CStaticGeometry::hitBy", { { "obstacles", (double)n } }, PROBES, [&]() {
+			float sum = 0;
+			for (int i = 0; i < PROBES; i++)
+			{
+				sim::Vec2 p = balls[i].getCenter();
+				float vx = balls[i].getVelocity_X(), vz = balls[i].getVelocity_Z();
+				geometry.hitBy(p.x, p.z, vx, vz, (float)M_RADIUS);
+				sum += vx;
+			}
+			bench::keep(sum);
+		});
+
+		suite.run("linear hitBy", { { "obstacles", (double)n } }, PROBES, [&]() {
+			float sum = 0;
+			for (int i = 0; i < PROBES; i++)
+			{
+				sim::Vec2 p = balls[i].getCenter();
+				float vx = balls[i].getVelocity_X(), vz = balls[i].getVelocity_Z();
+				for (int k = 0; k < geometry.size(); k++)
+				{
+					const sim::Obstacle& o = geometry.get(k);
+					if (o.kind == sim::OBSTACLE_BOX &&
+						sim::boxOverlaps(p.x, p.z, (float)M_RADIUS, o.x, o.z, o.width, o.depth))
+						sim::hitBox(p.x, p.z, vx, vz, (float)M_RADIUS, o.x, o.z, o.width, o.depth);
+				}
+				sum += vx;
+			}
+			bench::keep(sum);
+		});
+
+		// one frame of travel at the top speed of the game
+		suite.run("CStaticGeometry::sweep", { { "obstacles", (double)n } }, PROBES, [&]() {
+			int hits = 0;
+			for (int i = 0; i < PROBES; i++)
+			{
+				sim::Vec2 p = balls[i].getCenter();
+				float t;
+				int piece;
+				hits += geometry.sweep(p.x, p.z, (float)M_RADIUS, balls[i].getVelocity_X() * 0.1f,
+					balls[i].getVelocity_Z() * 0.1f, t, piece);
+			}
+			bench::keep(hits);
+		});
+	}
+}
+
+// layouts do not depend on a speed, only on the number of balls
+static void benchLayout(bench::CBenchSuite& suite)
+{
+	sim::CSpatialGrid grid;
+	sim::CPoissonDisk sampler;
+	std::vector<sim::Vec2> positions;
+	const sim::CStaticGeometry& classic = sim::getClassicGeometry();
+	sim::initTableGrid(grid);
+
+	for (size_t c = 0; c < sizeof(LAYOUT_COUNTS) / sizeof(LAYOUT_COUNTS[0]); c++)
+	{
+		int n = LAYOUT_COUNTS[c];
+		sim::CRandom tables(BENCH_SEED);
+
+		// a new layout stream every call, the same sequence on every run
+		unsigned long long layout = 0;
+		suite.run("generateRandomPositions", { { "balls", (double)n } }, 1, [&]() {
+			bench::keep(sim::generateRandomPositions(positions, n, classic, tables.stream(layout++), grid, sampler));
+		});
+
+		sim::CBall blue;
+		sim::CRandom roll(BENCH_SEED);
+		sim::generateRandomPositions(positions, n, classic, tables.stream(0), grid, sampler);
+		suite.run("SetupBlueBall", { { "balls", (double)n } }, 1, [&]() {
+			bench::keep(sim::SetupBlueBall(blue, sampler, n, roll));
+		});
+	}
+}
+
+// the paddle chases the red ball as a player would, the game restarts once it is over
+static void playFrame(sim::CGame& game, unsigned long long& games, bool dynamic)
+{
+	if (game.isOver())
+	{
+		game.setDynamic(dynamic);
+		game.setup(BENCH_SEED + games++);
+	}
+	if (!game.isLaunched())
+		game.launch();
+
+	float dx = game.getRedBall().getCenter().x - game.getWhiteBall().getCenter().x;
+	game.movePaddle(std::min(std::max(dx, -0.05f), 0.05f));
+	game.step(FRAME_DT);
+}
+
+static void benchFrame(bench::CBenchSuite& suite)
+{
+	const int FRAMES = 1000;  // per batch
+	const int balls[] = { BALLNUM, 60 };
+
+	for (size_t b = 0; b < sizeof(balls) / sizeof(balls[0]); b++)
+	{
+		for (int dynamic = 0; dynamic < 2; dynamic++)
+		{
+			sim::CGame start(balls[b]);
+			start.setDynamic(dynamic != 0);
+			start.setup(BENCH_SEED);
+
+			// every batch plays the same frames from the same table, so the iterations compare
+			sim::CGame game(balls[b]);
+			suite.run("frame/step", { { "balls", (double)balls[b] }, { "dynamic", (double)dynamic } }, FRAMES, [&]() {
+				unsigned long long games = 1;
+				game = start;
+				for (int f = 0; f < FRAMES; f++)
+					playFrame(game, games, dynamic != 0);
+			});
+		}
+
+		// the same tables with the event driven red ball
+		sim::CGame start(balls[b]);
+		start.setEventDriven(true);
+		start.setup(BENCH_SEED);
+		sim::CGame game(balls[b]);
+		suite.run("frame/step events", { { "balls", (double)balls[b] } }, FRAMES, [&]() {
+			unsigned long long games = 1;
+			game = start;
+			for (int f = 0; f < FRAMES; f++)
+				playFrame(game, games, false);
+		});
+	}
+
+	// the rest of a frame besides drawing: the sim thread captures a snapshot every tick and
+	// the renderer interpolates the last two
+	sim::CGame game;
+	game.setup(BENCH_SEED);
+	sim::Snapshot a, b, out;
+	long long tick = 0;
+	suite.run("frame/snapshot", { { "balls", (double)BALLNUM } }, FRAMES, [&]() {
+		for (int f = 0; f < FRAMES; f++)
+		{
+			std::swap(a, b);
+			tick++;
+			b.capture(game, tick, tick * (1.0 / sim::SIM_TICK_HZ));
+			sim::interpolate(a, b, 0.5f, out);
+		}
+		bench::keep(out.red.x);
+	});
+
+	// the draw paths of Display() without the device
+	render::CMeshCache cache;
+	render::CTableScene scene;
+	render::CRenderList list;
+	render::CRecordingBackend backend;
+	render::Matrix world;
+	render::setIdentity(world);
+	scene.setup(list, cache);
+	suite.run("frame/render", { { "balls", (double)BALLNUM } }, FRAMES, [&]() {
+		for (int f = 0; f < FRAMES; f++)
+		{
+			backend.beginFrame();
+			list.clear();
+			scene.record(out, world, list);
+			list.sort();
+			render::submit(list, backend);
+		}
+		bench::keep(backend.getStats().instances);
+	});
+
+	// the same with frustum culling and levels of detail for the camera of Setup()
+	render::Matrix view, proj;
+	render::CTableScene::getCamera(1024.0f / 768, view, proj);
+	scene.setView(view, proj, 768);
+	suite.run("frame/render culled", { { "balls", (double)BALLNUM } }, FRAMES, [&]() {
+		for (int f = 0; f < FRAMES; f++)
+		{
+			backend.beginFrame();
+			list.clear();
+			scene.record(out, world, list);
+			list.sort();
+			render::submit(list, backend);
+		}
+		bench::keep(backend.getStats().instances);
+	});
+
+	// the HUD of a frame whose state did not change, and of one laid out again every frame
+	render::CGlyphAtlas atlas;
+	int advances[render::GLYPH_COUNT];
+	for (int i = 0; i < render::GLYPH_COUNT; i++)
+		advances[i] = 13;
+	atlas.build(16, 24, advances);
+	render::CHudText hud;
+	hud.setAtlas(&atlas);
+	render::HudState state = { out.life, out.destroyNum, out.level, out.win, out.defeated, 16, 16, 8706 };
+	suite.run("frame/hud cached", {}, FRAMES, [&]() {
+		for (int f = 0; f < FRAMES; f++)
+		{
+			backend.beginFrame();
+			hud.update(state);
+			hud.submit(backend);
+		}
+		bench::keep(backend.getStats().glyphs);
+	});
+	suite.run("frame/hud layout", {}, FRAMES, [&]() {
+		for (int f = 0; f < FRAMES; f++)
+		{
+			backend.beginFrame();
+			state.triangles ^= 1;
+			hud.update(state);
+			hud.submit(backend);
+		}
+		bench::keep(backend.getStats().glyphs);
+	});
+}
+
+static void benchProfiler(bench::CBenchSuite& suite)
+{
+	const int ZONES = 1000;
+	for (int on = 0; on < 2; on++)
+	{
+		prof::setEnabled(on != 0);
+		suite.run(on ? "profiler/zone on" : "profiler/zone off", {}, ZONES, [&]() {
+			for (int i = 0; i < ZONES; i++)
+			{
+				PROF_ZONE("bench");
+				bench::keep(i);
+			}
+		});
+	}
+	prof::setEnabled(false);
+	prof::clear();
+}
+
+int main(int argc, char* argv[])
+{
+	bench::CBenchSuite suite("benchLego");
+	if (!suite.parse(argc, argv, ""))
+		return 1;
+
+	benchBalls(suite);
+	benchGeometry(suite);
+	benchLayout(suite);
+	benchFrame(suite);
+	benchProfiler(suite);
+	return suite.finish();
+}
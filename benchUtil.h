@@ -0,0 +1,258 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// File: benchUtil.h
+//
+// Desc: Small benchmark harness. A case is a function that runs a fixed batch of operations;
+//       the harness calibrates how many batches make one iteration (at least MIN_ITERATION_NS),
+//       times a number of iterations and keeps the time per operation of every iteration.
+//
+//       The results are written as JSON, one case per line, with the per-iteration samples
+//       and their min / median / mean / p90 / max / stddev, so regressions can be tracked by
+//       scripts. The same file can be given back with -compare to flag the cases whose
+//       median got slower than the threshold.
+//
+//       Common options: -iterations N  -filter TEXT  -json FILE  -compare FILE  -threshold R
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __benchUtilH__
+#define __benchUtilH__
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace bench
+{
+	const double MIN_ITERATION_NS = 2e6;  // an iteration runs at least this long
+	const int DEFAULT_ITERATIONS = 15;
+
+	// keeps a value the optimiser would otherwise drop: its address escapes into a compiler
+	// barrier, so it has to be computed and stored, whatever its type
+	template <class T> inline void keep(const T& value)
+	{
+#if defined(_MSC_VER)
+		static const void* volatile sink;
+		sink = &value;
+		_ReadWriteBarrier();
+#else
+		asm volatile("" : : "r"(&value) : "memory");
+#endif
+	}
+
+	struct Param
+	{
+		const char*         name;
+		double              value;
+	};
+
+	struct Stats
+	{
+		double              min, median, mean, p90, max, stddev;
+	};
+
+	inline Stats computeStats(std::vector<double> samples)
+	{
+		Stats s = {};
+		if (samples.empty())
+			return s;
+		std::sort(samples.begin(), samples.end());
+		size_t n = samples.size();
+		double sum = 0;
+		for (size_t i = 0; i < n; i++)
+			sum += samples[i];
+		s.min = samples[0];
+		s.max = samples[n - 1];
+		s.median = n % 2 ? samples[n / 2] : 0.5 * (samples[n / 2 - 1] + samples[n / 2]);
+		s.p90 = samples[std::min(n - 1, (size_t)std::ceil(0.9 * n) - 1)];
+		s.mean = sum / n;
+		double var = 0;
+		for (size_t i = 0; i < n; i++)
+			var += (samples[i] - s.mean) * (samples[i] - s.mean);
+		s.stddev = n > 1 ? std::sqrt(var / (n - 1)) : 0;
+		return s;
+	}
+
+	class CBenchSuite {
+	public:
+		CBenchSuite(const char* name)
+		{
+			m_name = name;
+			m_iterations = DEFAULT_ITERATIONS;
+			m_filter = NULL;
+			m_json = NULL;
+			m_compare = NULL;
+			m_threshold = 0.10;
+			m_out = NULL;
+			m_cases = 0;
+			m_regressions = 0;
+		}
+
+		~CBenchSuite(void)
+		{
+			if (m_out != NULL && m_out != stdout)
+				fclose(m_out);
+		}
+
+		// false (after printing the usage) on an unknown option; usage lists the suite options
+		bool parse(int argc, char* argv[], const char* usage)
+		{
+			for (int i = 1; i < argc; i++)
+			{
+				if (!strcmp(argv[i], "-iterations") && i + 1 < argc) m_iterations = std::max(1, atoi(argv[++i]));
+				else if (!strcmp(argv[i], "-filter") && i + 1 < argc) m_filter = argv[++i];
+				else if (!strcmp(argv[i], "-json") && i + 1 < argc) m_json = argv[++i];
+				else if (!strcmp(argv[i], "-compare") && i + 1 < argc) m_compare = argv[++i];
+				else if (!strcmp(argv[i], "-threshold") && i + 1 < argc) m_threshold = atof(argv[++i]);
+				else
+				{
+					fprintf(stderr, "usage: %s [-iterations N] [-filter TEXT] [-json FILE] [-compare FILE] "
+						"[-threshold R]\n%s", m_name, usage);
+					return false;
+				}
+			}
+
+			if (m_compare != NULL)
+				loadBaseline(m_compare);
+			m_out = m_json != NULL ? fopen(m_json, "w") : stdout;
+			if (m_out == NULL)
+			{
+				fprintf(stderr, "could not write %s\n", m_json);
+				return false;
+			}
+			fprintf(m_out, "{\"suite\": \"%s\", \"unit\": \"ns/op\", \"cases\": [\n", m_name);
+			fprintf(stderr, "%-44s %12s %12s %12s %10s\n", "case", "median", "min", "p90", "stddev");
+			return true;
+		}
+
+		// f() runs ops operations; the case is skipped when it does not match -filter
+		template <class F> void run(const char* name, std::initializer_list<Param> params, long long ops, F f)
+		{
+			std::string full = name;
+			char buffer[64];
+			for (const Param& p : params)
+			{
+				snprintf(buffer, sizeof(buffer), "/%s=%g", p.name, p.value);
+				full += buffer;
+			}
+			if (m_filter != NULL && full.find(m_filter) == std::string::npos)
+				return;
+
+			// warm up and calibrate the batches per iteration
+			double ns = time(f, 1);
+			long long batches = std::max(1LL, (long long)std::ceil(MIN_ITERATION_NS / std::max(ns, 1.0)));
+
+			std::vector<double> samples;
+			for (int i = 0; i < m_iterations; i++)
+				samples.push_back(time(f, batches) / ((double)batches * ops));
+			Stats s = computeStats(samples);
+
+			fprintf(m_out, "%s{\"name\": \"%s\", \"params\": {", m_cases++ ? ",\n" : "", full.c_str());
+			bool first = true;
+			for (const Param& p : params)
+			{
+				fprintf(m_out, "%s\"%s\": %g", first ? "" : ", ", p.name, p.value);
+				first = false;
+			}
+			fprintf(m_out, "}, \"ops\": %lld, \"iterations\": %d, \"median\": %.4f, \"min\": %.4f, \"mean\": %.4f, "
+				"\"p90\": %.4f, \"max\": %.4f, \"stddev\": %.4f, \"samples\": [", ops * batches, m_iterations,
+				s.median, s.min, s.mean, s.p90, s.max, s.stddev);
+			for (size_t i = 0; i < samples.size(); i++)
+				fprintf(m_out, "%s%.4f", i ? ", " : "", samples[i]);
+			fprintf(m_out, "]}");
+			fflush(m_out);
+
+			fprintf(stderr, "%-44s %12.3f %12.3f %12.3f %10.3f", full.c_str(), s.median, s.min, s.p90, s.stddev);
+			compare(full, s.median);
+			fprintf(stderr, "\n");
+		}
+
+		// closes the JSON; returns the number of regressions against -compare
+		int finish(void)
+		{
+			if (m_out != NULL)
+				fprintf(m_out, "\n]}\n");
+			if (m_compare != NULL)
+				fprintf(stderr, "%d regression(s) over %.0f%% against %s\n", m_regressions, m_threshold * 100, m_compare);
+			return m_regressions;
+		}
+
+	private:
+		template <class F> static double time(F& f, long long batches)
+		{
+			std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+			for (long long b = 0; b < batches; b++)
+				f();
+			return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+		}
+
+		// the JSON above has one case per line, so the baseline only needs the name and median
+		void loadBaseline(const char* path)
+		{
+			FILE* file = fopen(path, "r");
+			if (file == NULL)
+			{
+				fprintf(stderr, "could not read %s\n", path);
+				return;
+			}
+			char line[65536];
+			while (fgets(line, sizeof(line), file) != NULL)
+			{
+				const char* name = strstr(line, "\"name\": \"");
+				const char* median = strstr(line, "\"median\": ");
+				if (name == NULL || median == NULL)
+					continue;
+				name += 9;
+				const char* end = strchr(name, '"');
+				if (end == NULL)
+					continue;
+				Baseline b = { std::string(name, end), atof(median + 10) };
+				m_baseline.push_back(b);
+			}
+			fclose(file);
+		}
+
+		void compare(const std::string& name, double median)
+		{
+			for (size_t i = 0; i < m_baseline.size(); i++)
+			{
+				if (m_baseline[i].name != name || m_baseline[i].median <= 0)
+					continue;
+				double ratio = median / m_baseline[i].median;
+				bool regression = ratio > 1 + m_threshold;
+				fprintf(stderr, "  %6.2fx%s", ratio, regression ? "  REGRESSION" : "");
+				m_regressions += regression;
+				return;
+			}
+		}
+
+		struct Baseline
+		{
+			std::string         name;
+			double              median;
+		};
+
+		const char*             m_name;
+		int                     m_iterations;
+		const char*             m_filter;
+		const char*             m_json;
+		const char*             m_compare;
+		double                  m_threshold;
+		FILE*                   m_out;
+		int                     m_cases;
+		int                     m_regressions;
+		std::vector<Baseline>   m_baseline;
+	};
+}
+
+#endif // __benchUtilH__
@@ -0,0 +1,196 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// File: contactSolver.cpp
+//
+// Desc: Parallel ball to ball contact solver (graph coloured contact batches).
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "contactSolver.h"
+#include "profiler.h"
+#include <algorithm>
+#include <cmath>
+
+sim::CContactSolver::CContactSolver(void)
+{
+	m_pool = NULL;
+	m_colours = 0;
+	for (int c = 0; c < MAX_COLOURS + 2; c++)
+		m_start[c] = 0;
+}
+
+int sim::CContactSolver::solve(CBallStore& balls, const CSpatialGrid& grid, float maxRadius)
+{
+	PROF_ZONE("contactSolve");
+	findContacts(balls, grid, maxRadius);
+	int count = (int)m_contacts.size();
+	if (count == 0)
+	{
+		m_colours = 0;
+		return 0;
+	}
+
+	colour(count);
+
+	// the same colour order with or without the pool, so both give the same result
+	bool parallel = m_pool != NULL && count >= PARALLEL_CONTACTS;
+	for (int c = 0; c < m_colours; c++)
+	{
+		// contacts of one colour never share a ball, so the chunks can run in any order
+		const Contact* batch = m_sorted.data() + m_start[c];
+		auto run = [&](int begin, int end, int) {
+			resolve(balls, batch + begin, end - begin);
+		};
+		if (parallel)
+			m_pool->parallelFor(m_start[c + 1] - m_start[c], 64, run);
+		else
+			run(0, m_start[c + 1] - m_start[c], 0);
+	}
+
+	// contacts that did not get a colour, resolved in order
+	resolve(balls, m_sorted.data() + m_start[MAX_COLOURS], m_start[MAX_COLOURS + 1] - m_start[MAX_COLOURS]);
+	return count;
+}
+
+void sim::CContactSolver::findContacts(const CBallStore& balls, const CSpatialGrid& grid, float maxRadius)
+{
+	int n = balls.size();
+	m_moving.clear();
+	balls.forEachAlive([&](int i) {
+		if (balls.getVelocity_X(i) != 0 || balls.getVelocity_Z(i) != 0)
+			m_moving.push_back(i);
+	});
+
+	int workers = m_pool ? m_pool->getWorkers() : 1;
+	if ((int)m_found.size() < workers)
+		m_found.resize(workers);
+	for (int w = 0; w < workers; w++)
+		m_found[w].clear();
+
+	auto find = [&](int begin, int end, int worker) {
+		std::vector<Contact>& found = m_found[worker];
+		for (int k = begin; k < end; k++)
+		{
+			int i = m_moving[k];
+			float x = balls.getX(i), z = balls.getZ(i), r = balls.getRadius(i);
+			grid.query(x, z, r + maxRadius, [&](int j) {
+				if (j == i)
+					return;
+				bool jMoving = balls.getVelocity_X(j) != 0 || balls.getVelocity_Z(j) != 0;
+				if (jMoving && j < i)
+					return;  // found from j
+				float dx = balls.getX(j) - x;
+				float dz = balls.getZ(j) - z;
+				float reach = r + balls.getRadius(j);
+				if (dx * dx + dz * dz < reach * reach)
+				{
+					Contact c = { std::min(i, j), std::max(i, j) };
+					found.push_back(c);
+				}
+			});
+		}
+	};
+	if (m_pool != NULL && (int)m_moving.size() >= PARALLEL_CONTACTS)
+		m_pool->parallelFor((int)m_moving.size(), 256, find);
+	else
+		find(0, (int)m_moving.size(), 0);
+
+	m_contacts.clear();
+	for (int w = 0; w < workers; w++)
+		m_contacts.insert(m_contacts.end(), m_found[w].begin(), m_found[w].end());
+
+	// the workers steal in any order; sorting keeps the result independent of the schedule
+	std::sort(m_contacts.begin(), m_contacts.end(), [](const Contact& l, const Contact& r) {
+		return l.a < r.a || (l.a == r.a && l.b < r.b);
+	});
+
+	if ((int)m_used.size() < n)
+		m_used.resize(n, 0);
+}
+
+// greedy colouring: every contact takes the lowest colour free on both of its balls
+void sim::CContactSolver::colour(int count)
+{
+	m_colour.resize(count);
+	int histogram[MAX_COLOURS + 1] = { 0 };
+	m_colours = 0;
+
+	for (int k = 0; k < count; k++)
+	{
+		const Contact& c = m_contacts[k];
+		unsigned long long used = m_used[c.a] | m_used[c.b];
+		int colour = MAX_COLOURS;  // overflow, resolved serially
+		if (~used != 0)
+		{
+			colour = 0;
+			while (used & (1ull << colour))
+				colour++;
+			m_used[c.a] |= 1ull << colour;
+			m_used[c.b] |= 1ull << colour;
+			m_colours = std::max(m_colours, colour + 1);
+		}
+		m_colour[k] = (unsigned char)colour;
+		histogram[colour]++;
+	}
+
+	m_start[0] = 0;
+	for (int c = 0; c <= MAX_COLOURS; c++)
+		m_start[c + 1] = m_start[c] + histogram[c];
+
+	int fill[MAX_COLOURS + 1];
+	for (int c = 0; c <= MAX_COLOURS; c++)
+		fill[c] = m_start[c];
+	m_sorted.resize(count);
+	for (int k = 0; k < count; k++)
+	{
+		const Contact& c = m_contacts[k];
+		m_sorted[fill[m_colour[k]]++] = c;
+		m_used[c.a] = 0;
+		m_used[c.b] = 0;
+	}
+}
+
+// equal masses, restitution 1: the balls swap their velocity along the normal and are pushed
+// apart by half the overlap each
+void sim::CContactSolver::resolve(CBallStore& balls, const Contact* contacts, int count)
+{
+	float* x = balls.columnX();
+	float* z = balls.columnZ();
+	float* vx = balls.columnVX();
+	float* vz = balls.columnVZ();
+	const float* radius = balls.columnRadius();
+
+	for (int k = 0; k < count; k++)
+	{
+		int a = contacts[k].a, b = contacts[k].b;
+		float dx = x[b] - x[a];
+		float dz = z[b] - z[a];
+		float reach = radius[a] + radius[b];
+		float d2 = dx * dx + dz * dz;
+		if (d2 >= reach * reach)
+			continue;  // separated by an earlier contact
+
+		float d = std::sqrt(d2);
+		float nx = 1, nz = 0;
+		if (d > 0)
+		{
+			nx = dx / d;
+			nz = dz / d;
+		}
+
+		float approach = (vx[b] - vx[a]) * nx + (vz[b] - vz[a]) * nz;
+		if (approach < 0)
+		{
+			vx[a] += approach * nx;
+			vz[a] += approach * nz;
+			vx[b] -= approach * nx;
+			vz[b] -= approach * nz;
+		}
+
+		float push = 0.5f * (reach - d);
+		x[a] -= push * nx;
+		z[a] -= push * nz;
+		x[b] += push * nx;
+		z[b] += push * nz;
+	}
+}
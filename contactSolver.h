@@ -0,0 +1,63 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// File: contactSolver.h
+//
+// Desc: Ball to ball contacts between every live ball of a CBallStore, with momentum exchange
+//       between both partners (equal masses, elastic). Contacts are found around the moving
+//       balls only, so balls at rest cost nothing until something hits them.
+//
+//       The contacts are partitioned by greedy graph colouring: no two contacts of one colour
+//       share a ball, so every colour is resolved in parallel without locks, one colour after
+//       the other. Small contact sets are resolved on the calling thread.
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __contactSolverH__
+#define __contactSolverH__
+
+#include "ballStore.h"
+#include "spatialGrid.h"
+#include "workPool.h"
+#include <vector>
+
+namespace sim
+{
+	const int MAX_COLOURS = 64;            // colours of the contact graph, see colour()
+	const int PARALLEL_CONTACTS = 512;     // below this the pool is not used
+
+	class CContactSolver {
+	public:
+		CContactSolver(void);
+
+		void setPool(CWorkPool* pool) { m_pool = pool; }  // NULL: single threaded
+
+		// resolves the contacts of the live balls; grid holds every live ball under its index
+		// in the store, and maxRadius bounds the radius of the balls. Returns the contacts.
+		int solve(CBallStore& balls, const CSpatialGrid& grid, float maxRadius);
+
+		int getContacts(void) const { return (int)m_contacts.size(); }
+		int getColours(void) const { return m_colours; }
+
+	private:
+		struct Contact
+		{
+			int             a, b;
+		};
+
+		void findContacts(const CBallStore& balls, const CSpatialGrid& grid, float maxRadius);
+		void colour(int count);
+		void resolve(CBallStore& balls, const Contact* contacts, int count);
+
+		CWorkPool*                          m_pool;
+		std::vector<int>                    m_moving;
+		std::vector<std::vector<Contact> >  m_found;  // per worker
+		std::vector<Contact>                m_contacts;
+		std::vector<unsigned char>          m_colour;  // per contact
+		std::vector<unsigned long long>     m_used;    // per ball, colours of its contacts
+		std::vector<Contact>                m_sorted;  // contacts grouped by colour
+		int                                 m_start[MAX_COLOURS + 2];
+		int                                 m_colours;
+	};
+}
+
+#endif // __contactSolverH__
@@ -0,0 +1,242 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// File: d3dBackend.cpp
+//
+// Desc: Direct3D 9 backend of the render command list.
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "d3dBackend.h"
+#include <algorithm>
+#include <cstring>
+
+// the command list keeps its matrices and materials in the Direct3D layout
+static_assert(sizeof(render::Matrix) == sizeof(D3DMATRIX), "render::Matrix is not a D3DMATRIX");
+static_assert(sizeof(render::Material) == sizeof(D3DMATERIAL9), "render::Material is not a D3DMATERIAL9");
+static_assert(sizeof(render::Vertex) == 6 * sizeof(float), "render::Vertex is not D3DFVF_XYZ | D3DFVF_NORMAL");
+
+// copies the geometry into the buffers of a mesh with D3DFVF_XYZ | D3DFVF_NORMAL vertices
+static bool fillMesh(ID3DXMesh* pMesh, const render::Geometry& geometry)
+{
+	void* data = NULL;
+	if (FAILED(pMesh->LockVertexBuffer(0, &data)))
+		return false;
+	memcpy(data, geometry.vertices.data(), geometry.vertices.size() * sizeof(render::Vertex));
+	pMesh->UnlockVertexBuffer();
+
+	if (FAILED(pMesh->LockIndexBuffer(0, &data)))
+		return false;
+	memcpy(data, geometry.indices.data(), geometry.indices.size() * sizeof(unsigned short));
+	pMesh->UnlockIndexBuffer();
+
+	// a single subset, drawn by DrawSubset(0)
+	DWORD* attributes = NULL;
+	if (FAILED(pMesh->LockAttributeBuffer(0, &attributes)))
+		return false;
+	memset(attributes, 0, geometry.getTriangleCount() * sizeof(DWORD));
+	pMesh->UnlockAttributeBuffer();
+	return true;
+}
+
+static ID3DXMesh* createMesh(IDirect3DDevice9* pDevice, const render::Geometry& geometry)
+{
+	ID3DXMesh* pMesh = NULL;
+	if (FAILED(D3DXCreateMeshFVF((DWORD)geometry.getTriangleCount(), (DWORD)geometry.vertices.size(),
+		D3DXMESH_MANAGED, D3DFVF_XYZ | D3DFVF_NORMAL, pDevice, &pMesh)))
+	{
+		return NULL;
+	}
+	if (!fillMesh(pMesh, geometry))
+	{
+		pMesh->Release();
+		return NULL;
+	}
+	return pMesh;
+}
+
+// white glyphs with the coverage of the GDI rendering (grey on black) as alpha
+static IDirect3DTexture9* createFontTexture(IDirect3DDevice9* pDevice, const DWORD* bits, int width, int height)
+{
+	IDirect3DTexture9* pTexture = NULL;
+	if (FAILED(pDevice->CreateTexture(width, height, 1, 0, D3DFMT_A8R8G8B8, D3DPOOL_MANAGED, &pTexture, NULL)))
+		return NULL;
+	D3DLOCKED_RECT locked;
+	if (FAILED(pTexture->LockRect(0, &locked, NULL, 0)))
+	{
+		pTexture->Release();
+		return NULL;
+	}
+	for (int y = 0; y < height; y++)
+	{
+		DWORD* row = (DWORD*)((BYTE*)locked.pBits + y * locked.Pitch);
+		for (int x = 0; x < width; x++)
+			row[x] = ((bits[y * width + x] & 0xff) << 24) | 0x00ffffff;
+	}
+	pTexture->UnlockRect(0);
+	return pTexture;
+}
+
+render::CD3DBackend::CD3DBackend(void)
+{
+	m_pDevice = NULL;
+	m_pFont = NULL;
+}
+
+render::CD3DBackend::~CD3DBackend(void)
+{
+	destroy();
+}
+
+bool render::CD3DBackend::create(IDirect3DDevice9* pDevice, const CMeshCache& cache)
+{
+	if (NULL == pDevice)
+		return false;
+
+	destroy();
+	m_pDevice = pDevice;
+	m_meshes.assign(cache.getCapacity(), NULL);
+	for (int i = 0; i < cache.getCapacity(); i++)
+	{
+		if (!cache.isLive(i))
+			continue;
+		m_meshes[i] = createMesh(pDevice, cache.getGeometry(i));
+		if (m_meshes[i] == NULL)
+		{
+			destroy();
+			return false;
+		}
+	}
+	return true;
+}
+
+bool render::CD3DBackend::createFont(const char* face, int height, CGlyphAtlas& atlas)
+{
+	if (NULL == m_pDevice)
+		return false;
+	d3d::Release<IDirect3DTexture9*>(m_pFont);
+
+	HDC hDC = CreateCompatibleDC(NULL);
+	HFONT hFont = CreateFontA(height, 0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE, DEFAULT_CHARSET, OUT_DEFAULT_PRECIS,
+		CLIP_DEFAULT_PRECIS, ANTIALIASED_QUALITY, DEFAULT_PITCH, face);
+	HGDIOBJ hOldFont = SelectObject(hDC, hFont);
+
+	// a cell holds the widest character and its overhang
+	INT advances[GLYPH_COUNT];
+	TEXTMETRICA metrics;
+	GetCharWidth32A(hDC, GLYPH_FIRST, GLYPH_FIRST + GLYPH_COUNT - 1, advances);
+	GetTextMetricsA(hDC, &metrics);
+	int widest = *std::max_element(advances, advances + GLYPH_COUNT);
+	atlas.build(widest + metrics.tmOverhang + 2, metrics.tmHeight, advances);
+
+	BITMAPINFO info;
+	ZeroMemory(&info, sizeof(info));
+	info.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+	info.bmiHeader.biWidth = atlas.getTextureWidth();
+	info.bmiHeader.biHeight = -atlas.getTextureHeight();  // top row first
+	info.bmiHeader.biPlanes = 1;
+	info.bmiHeader.biBitCount = 32;
+	info.bmiHeader.biCompression = BI_RGB;
+	DWORD* bits = NULL;
+	HBITMAP hBitmap = CreateDIBSection(hDC, &info, DIB_RGB_COLORS, (void**)&bits, NULL, 0);
+	if (hBitmap != NULL)
+	{
+		HGDIOBJ hOldBitmap = SelectObject(hDC, hBitmap);
+		PatBlt(hDC, 0, 0, atlas.getTextureWidth(), atlas.getTextureHeight(), BLACKNESS);
+		SetTextColor(hDC, RGB(255, 255, 255));
+		SetBkMode(hDC, TRANSPARENT);
+		SetTextAlign(hDC, TA_TOP | TA_LEFT);
+		for (int i = 0; i < GLYPH_COUNT; i++)
+		{
+			char c = (char)(GLYPH_FIRST + i);
+			int x, y;
+			atlas.getCell(c, x, y);
+			TextOutA(hDC, x, y, &c, 1);
+		}
+		GdiFlush();
+		m_pFont = createFontTexture(m_pDevice, bits, atlas.getTextureWidth(), atlas.getTextureHeight());
+		SelectObject(hDC, hOldBitmap);
+		DeleteObject(hBitmap);
+	}
+
+	SelectObject(hDC, hOldFont);
+	DeleteObject(hFont);
+	DeleteDC(hDC);
+	return m_pFont != NULL;
+}
+
+void render::CD3DBackend::destroy(void)
+{
+	for (size_t i = 0; i < m_meshes.size(); i++)
+		d3d::Release<ID3DXMesh*>(m_meshes[i]);
+	m_meshes.clear();
+	d3d::Release<IDirect3DTexture9*>(m_pFont);
+	m_pDevice = NULL;
+}
+
+void render::CD3DBackend::setMaterial(int, const Material& material)
+{
+	m_pDevice->SetMaterial(reinterpret_cast<const D3DMATERIAL9*>(&material));
+}
+
+void render::CD3DBackend::drawInstances(int mesh, const Matrix* worlds, int count)
+{
+	ID3DXMesh* pMesh = m_meshes[mesh];
+	for (int i = 0; i < count; i++)
+	{
+		m_pDevice->SetTransform(D3DTS_WORLD, reinterpret_cast<const D3DMATRIX*>(&worlds[i]));
+		pMesh->DrawSubset(0);
+	}
+}
+
+// two triangles per quad; texel centres are half a pixel off pixel centres in Direct3D 9, so
+// the quads are moved by half a pixel to sample the atlas one to one with the default point
+// filter. The default stage 0 (texture colour times diffuse, texture alpha) colours the white
+// glyphs, the states the scene uses are put back afterwards
+void render::CD3DBackend::drawText(const GlyphQuad* quads, int count)
+{
+	if (m_pFont == NULL || count == 0)
+		return;
+
+	m_textVertices.resize(6 * (size_t)count);
+	for (int i = 0; i < count; i++)
+	{
+		const GlyphQuad& q = quads[i];
+		const float x0 = q.x0 - 0.5f, y0 = q.y0 - 0.5f, x1 = q.x1 - 0.5f, y1 = q.y1 - 0.5f;
+		const TextVertex corners[4] = {
+			{ x0, y0, 0, 1, q.color, q.u0, q.v0 },
+			{ x1, y0, 0, 1, q.color, q.u1, q.v0 },
+			{ x1, y1, 0, 1, q.color, q.u1, q.v1 },
+			{ x0, y1, 0, 1, q.color, q.u0, q.v1 },
+		};
+		TextVertex* v = &m_textVertices[6 * (size_t)i];
+		v[0] = corners[0];
+		v[1] = corners[1];
+		v[2] = corners[2];
+		v[3] = corners[0];
+		v[4] = corners[2];
+		v[5] = corners[3];
+	}
+
+	DWORD blend, src, dest, zEnable, fill;
+	m_pDevice->GetRenderState(D3DRS_ALPHABLENDENABLE, &blend);
+	m_pDevice->GetRenderState(D3DRS_SRCBLEND, &src);
+	m_pDevice->GetRenderState(D3DRS_DESTBLEND, &dest);
+	m_pDevice->GetRenderState(D3DRS_ZENABLE, &zEnable);
+	m_pDevice->GetRenderState(D3DRS_FILLMODE, &fill);
+
+	m_pDevice->SetRenderState(D3DRS_ALPHABLENDENABLE, TRUE);
+	m_pDevice->SetRenderState(D3DRS_SRCBLEND, D3DBLEND_SRCALPHA);
+	m_pDevice->SetRenderState(D3DRS_DESTBLEND, D3DBLEND_INVSRCALPHA);
+	m_pDevice->SetRenderState(D3DRS_ZENABLE, FALSE);
+	m_pDevice->SetRenderState(D3DRS_FILLMODE, D3DFILL_SOLID);
+	m_pDevice->SetTexture(0, m_pFont);
+	m_pDevice->SetFVF(D3DFVF_XYZRHW | D3DFVF_DIFFUSE | D3DFVF_TEX1);
+	m_pDevice->DrawPrimitiveUP(D3DPT_TRIANGLELIST, 2 * count, m_textVertices.data(), sizeof(TextVertex));
+
+	m_pDevice->SetTexture(0, NULL);
+	m_pDevice->SetRenderState(D3DRS_ALPHABLENDENABLE, blend);
+	m_pDevice->SetRenderState(D3DRS_SRCBLEND, src);
+	m_pDevice->SetRenderState(D3DRS_DESTBLEND, dest);
+	m_pDevice->SetRenderState(D3DRS_ZENABLE, zEnable);
+	m_pDevice->SetRenderState(D3DRS_FILLMODE, fill);
+}
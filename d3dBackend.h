@@ -0,0 +1,63 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// File: d3dBackend.h
+//
+// Desc: Direct3D 9 backend of the render command list. It owns one ID3DXMesh per mesh of a
+//       CMeshCache, filled with the cached geometry, and replays the batches of a CRenderList.
+//
+//       The fixed function pipeline of Direct3D 9 has no instancing (stream frequencies need a
+//       vertex shader), so an instanced batch is drawn as one SetTransform and DrawSubset per
+//       instance. The world and local transforms were already combined when the command was
+//       recorded, so there is no MultiplyTransform, and a material is set once per batch
+//       instead of once per object.
+//
+//       createFont() renders the printable characters of a GDI font once into a texture and
+//       describes it in a CGlyphAtlas; drawText() then draws the HUD as pre-transformed,
+//       alpha blended quads from that texture with a single DrawPrimitiveUP.
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __d3dBackendH__
+#define __d3dBackendH__
+
+#include "d3dUtility.h"
+#include "hudText.h"
+#include "meshCache.h"
+#include "renderList.h"
+#include <vector>
+
+namespace render
+{
+	class CD3DBackend : public IRenderBackend {
+	public:
+		CD3DBackend(void);
+		~CD3DBackend(void);
+
+		// a device mesh for every live mesh of cache, under the same id; call it again after
+		// the cache changed
+		bool create(IDirect3DDevice9* pDevice, const CMeshCache& cache);
+		// the glyph texture of a font of height pixels, after create()
+		bool createFont(const char* face, int height, CGlyphAtlas& atlas);
+		void destroy(void);
+
+		void setMaterial(int id, const Material& material);
+		void drawInstances(int mesh, const Matrix* worlds, int count);
+		void drawText(const GlyphQuad* quads, int count);
+
+	private:
+		// D3DFVF_XYZRHW | D3DFVF_DIFFUSE | D3DFVF_TEX1
+		struct TextVertex
+		{
+			float           x, y, z, rhw;
+			D3DCOLOR        color;
+			float           u, v;
+		};
+
+		IDirect3DDevice9*           m_pDevice;
+		std::vector<ID3DXMesh*>     m_meshes;
+		IDirect3DTexture9*          m_pFont;
+		std::vector<TextVertex>     m_textVertices;
+	};
+}
+
+#endif // __d3dBackendH__
@@ -13,51 +13,11 @@
 #include "d3dUtility.h"
 
 bool d3d::InitD3D(
-	HINSTANCE hInstance,
-	int width, int height,
+	HWND hwnd,
 	bool windowed,
 	D3DDEVTYPE deviceType,
 	IDirect3DDevice9** device)
 {
-	//
-	// Create the main application window.
-	//
-
-	WNDCLASS wc;
-
-	wc.style         = CS_HREDRAW | CS_VREDRAW;
-	wc.lpfnWndProc   = (WNDPROC)d3d::WndProc; 
-	wc.cbClsExtra    = 0;
-	wc.cbWndExtra    = 0;
-	wc.hInstance     = hInstance;
-	wc.hIcon         = LoadIcon(0, IDI_APPLICATION);
-	wc.hCursor       = LoadCursor(0, IDC_ARROW);
-	wc.hbrBackground = (HBRUSH)GetStockObject(WHITE_BRUSH);
-	wc.lpszMenuName  = 0;
-	wc.lpszClassName = "Direct3D9App";
-
-	if( !RegisterClass(&wc) ) 
-	{
-		::MessageBox(0, "RegisterClass() - FAILED", 0, 0);
-		return false;
-	}
-		
-	HWND hwnd = 0;
-    hwnd = ::CreateWindow("Direct3D9App",
-        "Virtual Billiard", 
-		WS_EX_TOPMOST,
-		0, 0, width, height,
-		0 /*parent hwnd*/, 0 /* menu */, hInstance, 0 /*extra*/); 
-
-	if( !hwnd )
-	{
-		::MessageBox(0, "CreateWindow() - FAILED", 0, 0);
-		return false;
-	}
-
-	::ShowWindow(hwnd, SW_SHOW);
-	::UpdateWindow(hwnd);
-
 	//
 	// Init D3D: 
 	//
@@ -144,32 +104,6 @@ bool d3d::InitD3D(
 	return true;
 }
 
-int d3d::EnterMsgLoop( bool (*ptr_display)(float timeDelta) )
-{
-	MSG msg;
-	::ZeroMemory(&msg, sizeof(MSG));
-
-	static double lastTime = (double)timeGetTime(); 
-
-	while(msg.message != WM_QUIT)
-	{
-		if(::PeekMessage(&msg, 0, 0, 0, PM_REMOVE))
-		{
-			::TranslateMessage(&msg);
-			::DispatchMessage(&msg);
-		}
-		else
-        {	
-			double currTime  = (double)timeGetTime();
-			double timeDelta = (currTime - lastTime)*0.0007;
-			ptr_display((float)timeDelta);
-
-			lastTime = currTime;
-        }
-    }
-    return msg.wParam;
-}
-
 D3DLIGHT9 d3d::InitDirectionalLight(D3DXVECTOR3* direction, D3DXCOLOR* color)
 {
 	D3DLIGHT9 light;
@@ -28,22 +28,13 @@ namespace d3d
 	//
 	// Init
 	//
+	// the window comes from the platform (platformWin32.h), its client area is the backbuffer
 	bool InitD3D(
-		HINSTANCE hInstance,       // [in] Application instance.
-		int width, int height,     // [in] Backbuffer dimensions.
+		HWND hwnd,                 // [in] Window of the device.
 		bool windowed,             // [in] Windowed (true)or full screen (false).
 		D3DDEVTYPE deviceType,     // [in] HAL or REF
 		IDirect3DDevice9** device);// [out]The created device.
 
-	int EnterMsgLoop( 
-		bool (*ptr_display)(float timeDelta));
-
-	LRESULT CALLBACK WndProc(
-		HWND hwnd,
-		UINT msg, 
-		WPARAM wParam,
-		LPARAM lParam);
-
 	//
 	// Cleanup
 	//
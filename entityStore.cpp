@@ -0,0 +1,86 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// File: entityStore.cpp
+//
+// Desc: Packed bitset and live entity set.
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "entityStore.h"
+
+//
+// CBitSet
+//
+
+void sim::CBitSet::assign(int size, bool value)
+{
+	m_size = size;
+	m_words.assign((size + 63) / 64, value ? ~0ull : 0);
+	if (value && (size & 63) != 0)
+		m_words.back() = (1ull << (size & 63)) - 1;
+}
+
+void sim::CBitSet::push_back(bool value)
+{
+	if ((m_size & 63) == 0)
+		m_words.push_back(0);
+	if (value)
+		set(m_size);
+	m_size++;
+}
+
+int sim::CBitSet::count(void) const
+{
+	int n = 0;
+	for (int w = 0; w < (int)m_words.size(); w++)
+		n += popcount64(m_words[w]);
+	return n;
+}
+
+//
+// CEntitySet
+//
+
+void sim::CEntitySet::reserve(int count)
+{
+	m_alive.reserve(count);
+	m_live.reserve(count);
+	m_slot.reserve(count);
+	m_generation.reserve(count);
+}
+
+void sim::CEntitySet::clear(void)
+{
+	for (int i = 0; i < size(); i++)
+		m_generation[i]++;
+	m_alive.assign(0, false);
+	m_live.clear();
+	m_slot.clear();
+}
+
+int sim::CEntitySet::add(void)
+{
+	int i = size();
+	m_alive.push_back(true);
+	m_slot.push_back((int)m_live.size());
+	m_live.push_back(i);
+	if (i == (int)m_generation.size())
+		m_generation.push_back(0);
+	return i;
+}
+
+void sim::CEntitySet::destroy(int i)
+{
+	if (!isAlive(i))
+		return;
+	m_alive.reset(i);
+	m_generation[i]++;
+
+	// the last live index takes the hole
+	int slot = m_slot[i];
+	int last = m_live.back();
+	m_live[slot] = last;
+	m_slot[last] = slot;
+	m_live.pop_back();
+	m_slot[i] = -1;
+}
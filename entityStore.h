@@ -0,0 +1,143 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// File: entityStore.h
+//
+// Desc: Liveness of the entities of a store (the yellow balls of CBallStore). An entity is
+//       alive while its bit is set in a packed bitset, so counts are a popcount per 64
+//       entities and a pass over the live ones skips 64 dead ones per word. The live indices
+//       are also kept in a dense list, compacted (the last one moves into the hole) when one
+//       dies, for passes that do not care about order (snapshots for the renderer).
+//
+//       Handles pair an index with the generation of its slot; the generation changes when
+//       the entity dies or the store is cleared, so a handle kept past either is stale
+//       instead of pointing at whatever took the slot.
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __entityStoreH__
+#define __entityStoreH__
+
+#include <cstddef>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace sim
+{
+	inline int popcount64(unsigned long long word)
+	{
+#if defined(_MSC_VER) && defined(_M_X64)
+		return (int)__popcnt64(word);
+#elif defined(_MSC_VER)
+		return (int)(__popcnt((unsigned int)word) + __popcnt((unsigned int)(word >> 32)));
+#else
+		return __builtin_popcountll(word);
+#endif
+	}
+
+	// index of the lowest set bit, word != 0
+	inline int lowestBit64(unsigned long long word)
+	{
+#if defined(_MSC_VER) && defined(_M_X64)
+		unsigned long index;
+		_BitScanForward64(&index, word);
+		return (int)index;
+#elif defined(_MSC_VER)
+		unsigned long index;
+		if (_BitScanForward(&index, (unsigned long)word))
+			return (int)index;
+		_BitScanForward(&index, (unsigned long)(word >> 32));
+		return (int)index + 32;
+#else
+		return __builtin_ctzll(word);
+#endif
+	}
+
+	//
+	// Packed bits, 64 per word
+	//
+
+	class CBitSet {
+	public:
+		CBitSet(void) : m_size(0) {}
+
+		void reserve(int size) { m_words.reserve((size + 63) / 64); }
+		void assign(int size, bool value);  // size bits, all set to value
+		void push_back(bool value);
+		int size(void) const { return m_size; }
+
+		bool test(int i) const { return (m_words[i >> 6] >> (i & 63)) & 1; }
+		void set(int i) { m_words[i >> 6] |= 1ull << (i & 63); }
+		void reset(int i) { m_words[i >> 6] &= ~(1ull << (i & 63)); }
+
+		int count(void) const;  // bits set
+		size_t getBytes(void) const { return m_words.size() * sizeof(unsigned long long); }
+
+		// f(i) for every set bit in ascending order, over a copy of each word: f may reset i
+		template <class F> void forEach(F f) const
+		{
+			int words = (int)m_words.size();
+			for (int w = 0; w < words; w++)
+			{
+				for (unsigned long long word = m_words[w]; word != 0; word &= word - 1)
+					f(w * 64 + lowestBit64(word));
+			}
+		}
+
+	private:
+		std::vector<unsigned long long>  m_words;  // bits past m_size are 0
+		int                 m_size;
+	};
+
+	struct EntityHandle
+	{
+		int                 index;
+		unsigned int        generation;
+	};
+
+	//
+	// Live entities of a store, indices [0, size())
+	//
+
+	class CEntitySet {
+	public:
+		CEntitySet(void) {}
+
+		void reserve(int count);
+		void clear(void);      // every entity dies, their handles go stale
+		int add(void);         // a new live entity at index size()
+		void destroy(int i);   // nothing when it is dead already
+
+		int size(void) const { return m_alive.size(); }
+		bool isAlive(int i) const { return m_alive.test(i); }
+
+		// dense list of the live indices, in no particular order once one died
+		const std::vector<int>& getLive(void) const { return m_live; }
+
+		// bytes of the bitset, the slots, a full live list and the generations for size() entities
+		size_t getBytes(void) const { return m_alive.getBytes() + 3 * size() * sizeof(int); }
+
+		// f(i) for every live entity in ascending index order; it may destroy i
+		template <class F> void forEachAlive(F f) const { m_alive.forEach(f); }
+
+		EntityHandle getHandle(int i) const
+		{
+			EntityHandle h = { i, m_generation[i] };
+			return h;
+		}
+		bool isValid(EntityHandle h) const
+		{
+			return h.index >= 0 && h.index < size() && m_generation[h.index] == h.generation && isAlive(h.index);
+		}
+
+	private:
+		CBitSet             m_alive;
+		std::vector<int>    m_live;
+		std::vector<int>    m_slot;  // position in m_live, -1 for a dead entity
+		std::vector<unsigned int>  m_generation;  // per index, outlives clear()
+	};
+}
+
+#endif // __entityStoreH__
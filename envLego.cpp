@@ -0,0 +1,151 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// File: envLego.cpp
+//
+// Desc: Driver of the vectorized environment (legoEnv.h), through the C interface only, as a
+//       training loop would use it. Steps a batch of games with a paddle that follows the red
+//       ball in the observations, and reports the environment steps per second, the games
+//       finished and their average score.
+//
+//       usage: envLego [-envs N] [-steps S] [-balls B] [-seed S] [-threads T] [-dt T]
+//                      [-frames F] [-discrete] [-dynamic] [-events] [-friction]
+//
+//       -frames F: a game is done after F steps. Env i starts on game i of headlessLego
+//       -seed S. The checksum covers the observations of the last step and does not depend
+//       on -threads.
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "legoEnv.h"
+#include "simCore.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+// paddle travel per frame at a 16 ms frame, scaled with the frame time, as the headless bot
+static const float POLICY_STEP = 0.05f;
+
+// FNV-1a over the bytes of a buffer
+static void hashBytes(unsigned long long& h, const void* data, size_t size)
+{
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	for (size_t i = 0; i < size; i++)
+	{
+		h ^= bytes[i];
+		h *= 1099511628211ull;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	LegoEnvConfig config;
+	legoEnvDefaultConfig(&config);
+	config.count = 256;
+	config.maxFrames = 200000;
+	int steps = 20000;
+	unsigned long long seed = 1;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "-envs") && i + 1 < argc) config.count = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-steps") && i + 1 < argc) steps = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-balls") && i + 1 < argc) config.ballNum = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-seed") && i + 1 < argc) seed = strtoull(argv[++i], 0, 10);
+		else if (!strcmp(argv[i], "-threads") && i + 1 < argc) config.threads = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-dt") && i + 1 < argc)  // game units, in whole microseconds as headlessLego
+			config.frameMicros = (unsigned int)std::max(1L, std::lround(atof(argv[++i]) / sim::GAME_TIME_PER_MS * 1000));
+		else if (!strcmp(argv[i], "-frames") && i + 1 < argc) config.maxFrames = atol(argv[++i]);
+		else if (!strcmp(argv[i], "-discrete")) config.flags |= LEGO_ENV_DISCRETE;
+		else if (!strcmp(argv[i], "-dynamic")) config.flags |= LEGO_ENV_DYNAMIC;
+		else if (!strcmp(argv[i], "-events")) config.flags |= LEGO_ENV_EVENTS;
+		else if (!strcmp(argv[i], "-friction")) config.flags |= LEGO_ENV_FRICTION;
+		else
+		{
+			printf("usage: envLego [-envs N] [-steps S] [-balls B] [-seed S] [-threads T] [-dt T]\n"
+				"               [-frames F] [-discrete] [-dynamic] [-events] [-friction]\n");
+			return 1;
+		}
+	}
+
+	LegoEnv* env = legoEnvCreate(&config);
+	if (env == NULL)
+	{
+		printf("invalid environment settings\n");
+		return 1;
+	}
+
+	int count = config.count;
+	int ballNum = config.ballNum;
+	std::vector<float> balls((size_t)count * 2 * ballNum), alive((size_t)count * ballNum);
+	std::vector<float> red((size_t)count * LEGO_ENV_RED), blue((size_t)count * LEGO_ENV_BLUE);
+	std::vector<float> paddle(count), life(count), level(count), reward(count);
+	std::vector<unsigned char> done(count);
+	LegoEnvBuffers buffers = { balls.data(), alive.data(), red.data(), blue.data(), paddle.data(), life.data(),
+		level.data(), reward.data(), done.data() };
+	legoEnvBind(env, &buffers);
+
+	std::vector<unsigned long long> seeds(count);
+	sim::CRandom master(seed);
+	for (int i = 0; i < count; i++)
+		seeds[i] = master.at((unsigned long long)i);
+	legoEnvReset(env, seeds.data());
+
+	float maxStep = POLICY_STEP * config.frameMicros / 16000.0f;
+	std::vector<float> actions((size_t)count * LEGO_ENV_ACTION);
+	std::vector<float> score(count);
+	long long games = 0;
+	double scoreSum = 0, levelSum = 0;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (int s = 0; s < steps; s++)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			const float* r = &red[(size_t)i * LEGO_ENV_RED];
+			float* action = &actions[(size_t)i * LEGO_ENV_ACTION];
+			action[0] = std::min(std::max(r[0] - paddle[i], -maxStep), maxStep);
+			action[1] = r[4] == 0 ? 1.0f : 0.0f;
+		}
+
+		if (legoEnvStep(env, actions.data()) < 0)
+		{
+			printf("step failed\n");
+			return 1;
+		}
+
+		for (int i = 0; i < count; i++)
+		{
+			score[i] += reward[i];
+			if (done[i])
+			{
+				games++;
+				scoreSum += score[i];
+				levelSum += level[i];
+				score[i] = 0;
+			}
+		}
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	unsigned long long h = 1469598103934665603ull;
+	hashBytes(h, balls.data(), balls.size() * sizeof(float));
+	hashBytes(h, alive.data(), alive.size() * sizeof(float));
+	hashBytes(h, red.data(), red.size() * sizeof(float));
+	hashBytes(h, blue.data(), blue.size() * sizeof(float));
+	hashBytes(h, paddle.data(), paddle.size() * sizeof(float));
+	hashBytes(h, life.data(), life.size() * sizeof(float));
+	hashBytes(h, level.data(), level.size() * sizeof(float));
+
+	long long envSteps = (long long)count * steps;
+	printf("envs %d  steps %d  games finished %lld\n", count, steps, games);
+	printf("average score %.2f  average level %.2f\n", games > 0 ? scoreSum / games : 0.0, games > 0 ? levelSum / games : 0.0);
+	printf("env steps %lld  time %.3f s  %.0f env steps/s\n", envSteps, seconds, seconds > 0 ? envSteps / seconds : 0.0);
+	printf("threads %d  checksum %016llx\n", config.threads, h);
+
+	legoEnvDestroy(env);
+	return 0;
+}
@@ -0,0 +1,399 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// File: headlessLego.cpp
+//
+// Desc: Headless driver. Plays complete games of Virtual Billiard on the simulation core with a
+//       scripted paddle, without a window or a device, and reports the simulation throughput.
+//       The games run on the frame loop of the front end (platform::runLoop) over a headless
+//       platform, whose virtual clock steps a frame as soon as the last one is done.
+//
+//       usage: headlessLego [-games N] [-balls B] [-seed S] [-dt T] [-frames F] [-discrete]
+//                           [-dynamic] [-threads T] [-assist P] [-record PREFIX] [-trace FILE]
+//                           [-warp W] [-events] [-friction] [-pack FILE] [-obstacles N] [-v]
+//
+//       -assist P: the bot picks every launch with the shot evaluator, over P paddle
+//       positions by ASSIST_ANGLES launch angles.
+//       -record PREFIX: saves game g as the replay PREFIXg.vbr (see replayLego).
+//       -warp W: plays at W times real time instead of as fast as possible.
+//       -events: the red ball jumps from contact to contact (CGame::setEventDriven) instead of
+//       being stepped; a frame without a contact costs a comparison, so long frames (-dt) are
+//       as exact and almost as cheap as short ones.
+//       -friction: the balls slow down (CGame::setFriction), a red ball that stops goes back on
+//       the paddle without losing a life.
+//       -pack FILE: game g plays the levels of table g of a level pack (packLego) built for
+//       the same -seed and -balls, instead of generating them; levels past the pack are
+//       generated. The games are the same either way.
+//       -obstacles N: game g plays on a table of its own, the classic walls with N bumpers and
+//       pockets placed from its seed (CStaticGeometry::makeCourse), and the balls are laid out
+//       around them; not with -pack or -record, which hold games of the classic table.
+//       -trace FILE: records the profiler zones and writes the last of them to FILE as a Chrome
+//       trace; prints the p50 / p99 / p99.9 step time of the last TRACE_FRAMES frames.
+//
+//       The bot plays through the same input as a window: whole mouse pixels and frame
+//       times in whole microseconds, so every game can be recorded and replayed exactly.
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "levelPack.h"
+#include "platform.h"
+#include "profiler.h"
+#include "replay.h"
+#include "shotEvaluator.h"
+#include "simCore.h"
+#include "workPool.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// frame time in game units, as the front end gets it for a 16 ms frame
+const float DEFAULT_DT = 16 * sim::GAME_TIME_PER_MS;
+
+const int ASSIST_ANGLES = 9;
+const float ASSIST_MAX_ANGLE = 0.6f;  // radians
+const float ASSIST_PENALTY = 10;      // a lost life against destroyed balls
+
+const int TRACE_FRAMES = 1 << 16;     // frame times in the -trace histogram
+
+// -----------------------------------------------------------------------------
+// Scripted player
+// -----------------------------------------------------------------------------
+
+class CBot {
+public:
+	CBot(const sim::CRandom& random, float maxStep)
+	{
+		m_random = random;
+		m_maxPixels = std::max(1, (int)(maxStep / sim::PADDLE_STEP));
+		m_aim = 0;
+		m_recorder = NULL;
+		m_evaluator = NULL;
+		m_evaluations = 0;
+		m_evaluationSeconds = 0;
+	}
+
+	// launches are chosen by the evaluator over candidates instead of straight up
+	void setAssist(sim::CShotEvaluator* evaluator, const std::vector<sim::ShotCandidate>* candidates)
+	{
+		m_evaluator = evaluator;
+		m_candidates = candidates;
+	}
+
+	void setRecorder(sim::CReplayWriter* recorder) { m_recorder = recorder; }
+
+	int getEvaluations(void) const { return m_evaluations; }
+	double getEvaluationSeconds(void) const { return m_evaluationSeconds; }
+
+	// OnEvent replacement: follows the red ball with a limited paddle speed
+	void play(sim::CGame& game)
+	{
+		const sim::CBall& red = game.getRedBall();
+		const sim::CBall& white = game.getWhiteBall();
+
+		if (!game.isLaunched())
+		{
+			m_aim = nextOffset();
+			if (m_evaluator != NULL)
+				assistedLaunch(game);
+			else
+				launch(game, 0);
+			return;
+		}
+
+		float target = red.getCenter().x;
+		if (red.getVelocity_Z() < 0)
+			target += m_aim;  // hit the ball off center to send it sideways
+		else
+			m_aim = nextOffset();
+
+		int pixels = (int)std::lround((target - white.getCenter().x) / sim::PADDLE_STEP);
+		move(game, std::min(std::max(pixels, -m_maxPixels), m_maxPixels));
+	}
+
+private:
+	void assistedLaunch(sim::CGame& game)
+	{
+		int count = (int)m_candidates->size();
+		m_results.resize(count);
+
+		std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+		m_evaluator->evaluate(game, m_candidates->data(), count, sim::CRandom(m_random.next64()), m_results.data());
+		m_evaluationSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+		m_evaluations++;
+
+		const sim::ShotCandidate& shot = (*m_candidates)[sim::CShotEvaluator::best(m_results.data(), count, ASSIST_PENALTY)];
+		move(game, (int)std::lround((shot.x - game.getWhiteBall().getCenter().x) / sim::PADDLE_STEP));
+		launch(game, (int)std::lround(shot.angle * 1e6f));
+	}
+
+	// the input of OnEvent, in the units a replay stores
+	void move(sim::CGame& game, int pixels)
+	{
+		if (pixels == 0)
+			return;
+		game.movePaddle((float)pixels * sim::PADDLE_STEP);
+		if (m_recorder != NULL)
+			m_recorder->movePaddle(pixels);
+	}
+
+	void launch(sim::CGame& game, int microradians)
+	{
+		game.launch((float)microradians * 1e-6f);
+		if (m_recorder != NULL)
+			m_recorder->launch(microradians);
+	}
+
+	float nextOffset(void)
+	{
+		return m_random.uniform(-0.2f, 0.2f);
+	}
+
+	sim::CRandom        m_random;
+	int                 m_maxPixels;  // paddle speed
+	float               m_aim;
+	sim::CReplayWriter* m_recorder;
+
+	sim::CShotEvaluator*                        m_evaluator;
+	const std::vector<sim::ShotCandidate>*      m_candidates;
+	std::vector<sim::ShotResult>                m_results;
+	int                 m_evaluations;
+	double              m_evaluationSeconds;
+};
+
+// -----------------------------------------------------------------------------
+// One game on the frame loop
+// -----------------------------------------------------------------------------
+
+class CGameLoop : public platform::IApplication {
+public:
+	CGameLoop(sim::CGame& game, CBot& bot, long maxFrames)
+		: m_game(game), m_bot(bot)
+	{
+		m_maxFrames = maxFrames;
+		m_frames = 0;
+		m_recorder = NULL;
+		m_frameTimes = NULL;
+	}
+
+	void setRecorder(sim::CReplayWriter* recorder) { m_recorder = recorder; }
+	void setFrameTimes(prof::CFrameHistogram* frameTimes) { m_frameTimes = frameTimes; }
+	long getFrames(void) const { return m_frames; }
+
+	void onEvent(const platform::Event&) {}
+
+	bool frame(unsigned int micros)
+	{
+		if (m_game.isOver() || m_frames >= m_maxFrames)
+			return false;
+
+		unsigned long long t0 = m_frameTimes != NULL ? prof::now() : 0;
+		{
+			PROF_ZONE("frame");
+			m_bot.play(m_game);
+			m_game.step(sim::deltaFromMicros(micros));
+		}
+		if (m_frameTimes != NULL)
+			m_frameTimes->add(prof::ticksToNanos(prof::now() - t0));
+		if (m_recorder != NULL)
+			m_recorder->step(micros);
+		m_frames++;
+		return true;
+	}
+
+private:
+	sim::CGame&         m_game;
+	CBot&               m_bot;
+	long                m_maxFrames;
+	long                m_frames;
+	sim::CReplayWriter* m_recorder;
+	prof::CFrameHistogram*  m_frameTimes;
+};
+
+// -----------------------------------------------------------------------------
+// main
+// -----------------------------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+	int games = 1000;
+	int balls = BALLNUM;
+	unsigned long long seed = 1;
+	float dt = DEFAULT_DT;
+	long maxFrames = 200000;  // per game
+	bool verbose = false;
+	bool discrete = false;  // single step per frame, no swept tests
+	bool dynamic = false;   // struck balls move and collide
+	int threads = 1;        // contact solver threads, 0 for one per core
+	int assist = 0;         // paddle positions of the shot evaluator, 0: no assist
+	const char* record = NULL;  // replay file prefix
+	const char* trace = NULL;   // Chrome trace file
+	double warp = 0;            // times real time, 0: as fast as possible
+	bool events = false;        // event driven red ball
+	bool friction = false;      // the balls slow down
+	const char* packPath = NULL;  // level pack
+	int obstacles = 0;            // pieces of a generated table, 0: the classic table
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "-games") && i + 1 < argc) games = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-balls") && i + 1 < argc) balls = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-seed") && i + 1 < argc) seed = strtoull(argv[++i], 0, 10);
+		else if (!strcmp(argv[i], "-dt") && i + 1 < argc) dt = (float)atof(argv[++i]);
+		else if (!strcmp(argv[i], "-frames") && i + 1 < argc) maxFrames = atol(argv[++i]);
+		else if (!strcmp(argv[i], "-discrete")) discrete = true;
+		else if (!strcmp(argv[i], "-dynamic")) dynamic = true;
+		else if (!strcmp(argv[i], "-threads") && i + 1 < argc) threads = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-assist") && i + 1 < argc) assist = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-record") && i + 1 < argc) record = argv[++i];
+		else if (!strcmp(argv[i], "-trace") && i + 1 < argc) trace = argv[++i];
+		else if (!strcmp(argv[i], "-warp") && i + 1 < argc) warp = std::max(0.0, atof(argv[++i]));
+		else if (!strcmp(argv[i], "-events")) events = true;
+		else if (!strcmp(argv[i], "-friction")) friction = true;
+		else if (!strcmp(argv[i], "-pack") && i + 1 < argc) packPath = argv[++i];
+		else if (!strcmp(argv[i], "-obstacles") && i + 1 < argc) obstacles = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-v")) verbose = true;
+		else
+		{
+			printf("usage: headlessLego [-games N] [-balls B] [-seed S] [-dt T] [-frames F] [-discrete]\n"
+				"                    [-dynamic] [-threads T] [-assist P] [-record PREFIX] [-trace FILE]\n"
+				"                    [-warp W] [-events] [-friction] [-pack FILE] [-obstacles N] [-v]\n");
+			return 1;
+		}
+	}
+	if (obstacles > 0 && (packPath != NULL || record != NULL))
+	{
+		printf("-obstacles does not run with -pack or -record, they hold games of the classic table\n");
+		return 1;
+	}
+
+	sim::CLevelPack pack;
+	if (packPath != NULL)
+	{
+		if (!pack.open(packPath))
+		{
+			printf("could not map the level pack %s\n", packPath);
+			return 1;
+		}
+		if (pack.getSeed() != seed || pack.getBallNum() != balls)
+		{
+			printf("%s was built for -seed %llu -balls %d\n", packPath, pack.getSeed(), pack.getBallNum());
+			return 1;
+		}
+	}
+
+	// frame time in whole microseconds, as a replay keeps it
+	unsigned int micros = (unsigned int)std::max(1L, std::lround(dt / sim::GAME_TIME_PER_MS * 1000));
+	dt = sim::deltaFromMicros(micros);
+
+	long long totalFrames = 0, contacts = 0;
+	int wins = 0, defeats = 0, failed = 0, unfinished = 0;
+	long long levelSum = 0, scoreSum = 0;
+	sim::CWorkPool pool(threads);
+	sim::CRandom master(seed);
+
+	// the game runs on the calling thread, so the pool serves the evaluator or the contact
+	// solver, one at a time
+	sim::CShotEvaluator evaluator;
+	std::vector<sim::ShotCandidate> candidates;
+	evaluator.setPool(pool.getWorkers() > 1 ? &pool : NULL);
+	evaluator.getSettings().dt = dt;
+	evaluator.getSettings().paddleStep = 0.05f * dt / DEFAULT_DT;
+	sim::CShotEvaluator::makeGrid(assist, ASSIST_ANGLES, ASSIST_MAX_ANGLE, candidates);
+	int evaluations = 0;
+	double evaluationSeconds = 0;
+	prof::CFrameHistogram frameTimes(TRACE_FRAMES);
+	prof::setEnabled(trace != NULL);
+	platform::CHeadlessPlatform platform(warp);
+	sim::CStaticGeometry course;  // the table of the current game with -obstacles
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	for (int g = 0; g < games; g++)
+	{
+		// every game gets its own seed from the master stream, the bot plays a child of it
+		unsigned long long gameSeed = master.at((unsigned long long)g);
+		sim::CGame game(balls);
+		CBot bot(sim::CRandom(gameSeed).stream(sim::STREAM_PLAYER), 0.05f * dt / DEFAULT_DT);  // same paddle speed whatever the frame step
+		sim::CReplayWriter recorder;
+		game.setContinuous(!discrete);
+		game.setDynamic(dynamic);
+		game.setEventDriven(events);
+		game.setFriction(friction);
+		game.setLevelPack(pack.isOpen() && g < pack.getTables() ? &pack : NULL, g);
+		if (obstacles > 0)
+		{
+			course.makeCourse(obstacles, sim::CRandom(gameSeed).stream(sim::STREAM_COURSE));
+			game.setGeometry(&course);
+		}
+		game.setPool(pool.getWorkers() > 1 ? &pool : NULL);
+		game.setup(gameSeed);
+		if (assist > 0)
+			bot.setAssist(&evaluator, &candidates);
+		if (record != NULL)
+		{
+			recorder.begin(game, gameSeed);
+			bot.setRecorder(&recorder);
+		}
+
+		CGameLoop loop(game, bot, maxFrames);
+		loop.setRecorder(record != NULL ? &recorder : NULL);
+		loop.setFrameTimes(trace != NULL ? &frameTimes : NULL);
+		platform::runLoop(platform, loop, micros);
+		long frame = loop.getFrames();
+
+		if (record != NULL)
+		{
+			char path[512];
+			snprintf(path, sizeof(path), "%s%d.vbr", record, g);
+			recorder.end(game);
+			if (!recorder.save(path))
+				printf("could not write %s\n", path);
+		}
+
+		totalFrames += frame;
+		contacts += game.getEventCount();
+		if (game.isWin()) wins++;
+		else if (game.isDefeated()) defeats++;
+		else if (game.isFailed()) failed++;
+		else unfinished++;
+		levelSum += game.getLevel();
+		scoreSum += game.getDestroyNum();
+		evaluations += bot.getEvaluations();
+		evaluationSeconds += bot.getEvaluationSeconds();
+
+		if (verbose)
+			printf("game %d: %s level %d score %d frames %ld\n", g,
+				game.isWin() ? "win" : (game.isDefeated() ? "defeat" : (game.isFailed() ? "failed" : "unfinished")),
+				game.getLevel(), game.getDestroyNum(), frame);
+	}
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	printf("games %d  wins %d  defeats %d  failed layouts %d  unfinished %d\n", games, wins, defeats, failed, unfinished);
+	printf("average level %.2f  average score %.2f\n",
+		games ? (double)levelSum / games : 0.0, games ? (double)scoreSum / games : 0.0);
+	double gameSeconds = platform.getClock().now() * 1e-9;
+	printf("frames %lld  time %.3f s  %.0f frames/s  clock %.1f s (%.0fx real time)\n",
+		totalFrames, seconds, seconds > 0 ? totalFrames / seconds : 0.0, gameSeconds,
+		seconds > 0 ? gameSeconds / seconds : 0.0);
+	if (events)
+		printf("contacts %lld  %.3f per frame\n", contacts, totalFrames > 0 ? (double)contacts / totalFrames : 0.0);
+	if (evaluations > 0)
+		printf("shot evaluations %d  %d candidates  %.2f ms each\n", evaluations, (int)candidates.size(),
+			1e3 * evaluationSeconds / evaluations);
+
+	if (trace != NULL)
+	{
+		prof::setEnabled(false);
+		printf("frame time over the last %d frames: p50 %.1f us  p99 %.1f us  p99.9 %.1f us  max %.1f us\n",
+			frameTimes.getCount(), frameTimes.getPercentile(50) * 1e-3, frameTimes.getPercentile(99) * 1e-3,
+			frameTimes.getPercentile(99.9) * 1e-3, frameTimes.getMax() * 1e-3);
+		long long events = prof::writeChromeTrace(trace);
+		if (events < 0)
+			printf("could not write %s\n", trace);
+		else
+			printf("trace %s: %lld zones\n", trace, events);
+	}
+	return 0;
+}
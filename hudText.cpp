@@ -0,0 +1,148 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// File: hudText.cpp
+//
+// Desc: Glyph atlas layout and the cached HUD text.
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "hudText.h"
+#include <cassert>
+#include <cstdio>
+
+static const unsigned int HUD_COLOR = 0xff000000;  // D3DCOLOR_XRGB(0, 0, 0)
+
+static int roundUpPow2(int n)
+{
+	int p = 1;
+	while (p < n)
+		p <<= 1;
+	return p;
+}
+
+//
+// CGlyphAtlas
+//
+
+render::CGlyphAtlas::CGlyphAtlas(void)
+{
+	const int advances[GLYPH_COUNT] = { 0 };
+	build(1, 1, advances);
+}
+
+void render::CGlyphAtlas::build(int cellWidth, int cellHeight, const int advances[GLYPH_COUNT])
+{
+	assert(cellWidth > 0 && cellHeight > 0);
+	const int rows = (GLYPH_COUNT + ATLAS_COLUMNS - 1) / ATLAS_COLUMNS;
+	m_cellWidth = cellWidth;
+	m_cellHeight = cellHeight;
+	m_width = roundUpPow2(ATLAS_COLUMNS * cellWidth);
+	m_height = roundUpPow2(rows * cellHeight);
+
+	for (int i = 0; i < GLYPH_COUNT; i++)
+	{
+		int x = (i % ATLAS_COLUMNS) * cellWidth, y = (i / ATLAS_COLUMNS) * cellHeight;
+		Glyph& g = m_glyphs[i];
+		g.u0 = (float)x / m_width;
+		g.v0 = (float)y / m_height;
+		g.u1 = (float)(x + cellWidth) / m_width;
+		g.v1 = (float)(y + cellHeight) / m_height;
+		g.advance = advances[i];
+	}
+}
+
+void render::CGlyphAtlas::getCell(char c, int& x, int& y) const
+{
+	int i = (unsigned char)c - GLYPH_FIRST;
+	assert(i >= 0 && i < GLYPH_COUNT);
+	x = (i % ATLAS_COLUMNS) * m_cellWidth;
+	y = (i / ATLAS_COLUMNS) * m_cellHeight;
+}
+
+const render::Glyph& render::CGlyphAtlas::getGlyph(char c) const
+{
+	int i = (unsigned char)c - GLYPH_FIRST;
+	if (i < 0 || i >= GLYPH_COUNT)
+		i = '?' - GLYPH_FIRST;
+	return m_glyphs[i];
+}
+
+//
+// CHudText
+//
+
+static bool sameState(const render::HudState& a, const render::HudState& b)
+{
+	return a.life == b.life && a.score == b.score && a.level == b.level && a.win == b.win &&
+		a.defeated == b.defeated && a.objects == b.objects && a.drawn == b.drawn && a.triangles == b.triangles;
+}
+
+render::CHudText::CHudText(void)
+{
+	m_atlas = NULL;
+	m_valid = false;
+	m_layouts = 0;
+}
+
+void render::CHudText::setAtlas(const CGlyphAtlas* atlas)
+{
+	m_atlas = atlas;
+	m_valid = false;
+}
+
+// the rectangles Display() gave ID3DXFont::DrawText
+bool render::CHudText::update(const HudState& state)
+{
+	if (m_valid && sameState(state, m_state))
+		return false;
+	m_state = state;
+	m_valid = true;
+	m_quads.clear();
+	m_layouts++;
+	if (m_atlas == NULL)
+		return true;
+
+	char text[100];
+	snprintf(text, sizeof(text), "Life : %d\nScore : %d", state.life, state.score);
+	addText(50, 50, text, HUD_COLOR);
+	snprintf(text, sizeof(text), "Level: %d", state.level);
+	addText(800, 50, text, HUD_COLOR);
+	snprintf(text, sizeof(text), "Objects: %d / %d  Triangles: %lld", state.drawn, state.objects, state.triangles);
+	addText(50, 700, text, HUD_COLOR);
+	addText(400, 650, "Press Space to Start", HUD_COLOR);
+
+	if (state.win)
+		addText(330, 300, "YOU WIN! Press ESC to quit game", HUD_COLOR);
+	else if (state.defeated)
+		addText(330, 300, "Defeated. Press ESC to quit game", HUD_COLOR);
+	return true;
+}
+
+void render::CHudText::submit(IRenderBackend& backend) const
+{
+	if (!m_quads.empty())
+		backend.drawText(m_quads.data(), (int)m_quads.size());
+}
+
+// one quad of a whole cell per visible character, the pen on the top left of the cell
+void render::CHudText::addText(int x, int y, const char* text, unsigned int color)
+{
+	const float w = (float)m_atlas->getCellWidth(), h = (float)m_atlas->getCellHeight();
+	int penX = x, penY = y;
+	for (const char* c = text; *c != '\0'; c++)
+	{
+		if (*c == '\n')
+		{
+			penX = x;
+			penY += m_atlas->getCellHeight();
+			continue;
+		}
+		const Glyph& g = m_atlas->getGlyph(*c);
+		if (*c != ' ')
+		{
+			GlyphQuad q = { (float)penX, (float)penY, penX + w, penY + h, g.u0, g.v0, g.u1, g.v1, color };
+			m_quads.push_back(q);
+		}
+		penX += g.advance;
+	}
+}
@@ -0,0 +1,94 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// File: hudText.h
+//
+// Desc: The text of the HUD as cached glyph quads. CGlyphAtlas describes one texture that
+//       holds every printable character of the HUD font in a grid of equal cells; the backend
+//       that owns the texture fills it (CD3DBackend::createFont renders it with GDI) and
+//       gives the atlas the advances of the font.
+//
+//       CHudText lays the life, score, level, start and end messages of Display() out as one
+//       quad per character and keeps them. update() compares the state with the one the
+//       quads were made for and lays the text out again only when it changed, so a frame
+//       without a change does no string formatting or glyph lookup, and submit() hands all
+//       quads to the backend in a single drawText() call.
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __hudTextH__
+#define __hudTextH__
+
+#include "renderList.h"
+#include <vector>
+
+namespace render
+{
+	const int GLYPH_FIRST = 32;    // ' '
+	const int GLYPH_COUNT = 95;    // up to '~'
+	const int ATLAS_COLUMNS = 16;  // cells per row of the texture
+
+	struct Glyph
+	{
+		float               u0, v0, u1, v1;  // the cell in the texture
+		int                 advance;         // pixels to the next character
+	};
+
+	class CGlyphAtlas {
+	public:
+		CGlyphAtlas(void);
+
+		// cells of cellWidth x cellHeight pixels, advances[i] for character GLYPH_FIRST + i;
+		// the texture is ATLAS_COLUMNS cells wide, both sides rounded up to a power of two
+		void build(int cellWidth, int cellHeight, const int advances[GLYPH_COUNT]);
+
+		int getTextureWidth(void) const { return m_width; }
+		int getTextureHeight(void) const { return m_height; }
+		int getCellWidth(void) const { return m_cellWidth; }
+		int getCellHeight(void) const { return m_cellHeight; }  // also the line height
+
+		// where the backend draws c into the texture, top left texel
+		void getCell(char c, int& x, int& y) const;
+		// '?' for a character that is not in the atlas
+		const Glyph& getGlyph(char c) const;
+
+	private:
+		int                 m_width, m_height;
+		int                 m_cellWidth, m_cellHeight;
+		Glyph               m_glyphs[GLYPH_COUNT];
+	};
+
+	// what the HUD shows
+	struct HudState
+	{
+		int                 life, score, level;
+		bool                win, defeated;
+		int                 objects, drawn;  // SceneStats of the frame
+		long long           triangles;
+	};
+
+	class CHudText {
+	public:
+		CHudText(void);
+
+		// the glyphs of atlas from now on; the next update() lays the text out again
+		void setAtlas(const CGlyphAtlas* atlas);
+
+		// lays the text of state out when it differs from the last state; true when it did
+		bool update(const HudState& state);
+		void submit(IRenderBackend& backend) const;
+
+		const std::vector<GlyphQuad>& getQuads(void) const { return m_quads; }
+		long long getLayoutCount(void) const { return m_layouts; }
+
+	private:
+		void addText(int x, int y, const char* text, unsigned int color);
+
+		const CGlyphAtlas*  m_atlas;
+		bool                m_valid;  // m_quads were laid out for m_state
+		HudState            m_state;
+		std::vector<GlyphQuad>  m_quads;
+		long long           m_layouts;
+	};
+}
+
+#endif // __hudTextH__
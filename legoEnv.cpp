@@ -0,0 +1,255 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// File: legoEnv.cpp
+//
+// Desc: Vectorized environment. Every game of the batch is a CGame made once at create time
+//       and set up again in place, so reset and step only touch memory the games already
+//       hold. A step runs the games over the work pool in chunks of neighbours, and each game
+//       writes its rows of the bound buffers right after its frame, while its state is still
+//       in cache; the ball rows are copies of the x and z columns of the ball store.
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "legoEnv.h"
+#include "replay.h"
+#include "simCore.h"
+#include "workPool.h"
+#include <cstring>
+#include <new>
+#include <vector>
+
+// games per chunk of the pool: a frame is a microsecond or so, a chunk has to pay for the claim
+static const int ENV_GRAIN = 16;
+
+namespace
+{
+	// one game of the batch, a cache line apart from its neighbours
+	struct EnvSlot
+	{
+		sim::CGame          game;
+		unsigned long long  seed;     // of the reset
+		int                 episode;  // games played since the reset
+		long                frames;
+		int                 score;    // destroyNum at the last step
+		bool                done;
+		char                pad[64];
+
+		explicit EnvSlot(int ballNum) : game(ballNum), seed(0), episode(0), frames(0), score(0), done(false) {}
+	};
+}
+
+struct LegoEnv
+{
+	LegoEnvConfig       config;
+	LegoEnvBuffers      buffers;
+	float               dt;
+	bool                ready;  // reset at least once
+	sim::CWorkPool      pool;
+	std::vector<EnvSlot>  slots;
+
+	explicit LegoEnv(const LegoEnvConfig& c) : config(c), dt(sim::deltaFromMicros(c.frameMicros)), ready(false), pool(c.threads)
+	{
+		memset(&buffers, 0, sizeof(buffers));
+		slots.reserve(c.count);
+		for (int i = 0; i < c.count; i++)
+		{
+			slots.push_back(EnvSlot(c.ballNum));
+			sim::CGame& game = slots.back().game;
+			game.setContinuous((c.flags & LEGO_ENV_DISCRETE) == 0);
+			game.setDynamic((c.flags & LEGO_ENV_DYNAMIC) != 0);
+			game.setEventDriven((c.flags & LEGO_ENV_EVENTS) != 0);
+			game.setFriction((c.flags & LEGO_ENV_FRICTION) != 0);
+		}
+	}
+};
+
+static void setupSlot(EnvSlot& slot)
+{
+	unsigned long long seed = slot.episode == 0 ? slot.seed : sim::CRandom(slot.seed).at((unsigned long long)slot.episode);
+	slot.game.setup(seed);
+	slot.frames = 0;
+	slot.score = 0;
+	slot.done = slot.game.isOver();  // a layout that does not fit ends the game at once
+}
+
+// rows of game i, reward the balls destroyed since the last observation
+static void observe(const LegoEnv& env, int i, int reward)
+{
+	const LegoEnvBuffers& b = env.buffers;
+	const EnvSlot& slot = env.slots[i];
+	const sim::CGame& game = slot.game;
+	int ballNum = env.config.ballNum;
+
+	if (b.balls != NULL || b.alive != NULL)
+	{
+		const sim::CBallStore& balls = game.getBalls();
+		int n = balls.size() < ballNum ? balls.size() : ballNum;
+		if (b.balls != NULL)
+		{
+			float* x = b.balls + (size_t)i * 2 * ballNum;
+			float* z = x + ballNum;
+			memcpy(x, balls.columnX(), n * sizeof(float));
+			memcpy(z, balls.columnZ(), n * sizeof(float));
+			for (int j = n; j < ballNum; j++)
+				x[j] = z[j] = 0;
+		}
+		if (b.alive != NULL)
+		{
+			float* alive = b.alive + (size_t)i * ballNum;
+			for (int j = 0; j < ballNum; j++)
+				alive[j] = 0;
+			const std::vector<int>& live = balls.getLive();
+			for (size_t k = 0; k < live.size(); k++)
+			{
+				if (live[k] < n)
+					alive[live[k]] = 1;
+			}
+		}
+	}
+	if (b.red != NULL)
+	{
+		const sim::CBall& red = game.getRedBall();
+		float* row = b.red + (size_t)i * LEGO_ENV_RED;
+		row[0] = red.getCenter().x;
+		row[1] = red.getCenter().z;
+		row[2] = red.getVelocity_X();
+		row[3] = red.getVelocity_Z();
+		row[4] = game.isLaunched() ? 1.0f : 0.0f;
+	}
+	if (b.blue != NULL)
+	{
+		const sim::CBall& blue = game.getBlueBall();
+		float* row = b.blue + (size_t)i * LEGO_ENV_BLUE;
+		row[0] = blue.getCenter().x;
+		row[1] = blue.getCenter().z;
+		row[2] = game.isBlueActivated() ? 1.0f : 0.0f;
+	}
+	if (b.paddle != NULL)
+		b.paddle[i] = game.getWhiteBall().getCenter().x;
+	if (b.life != NULL)
+		b.life[i] = (float)game.getLife();
+	if (b.level != NULL)
+		b.level[i] = (float)game.getLevel();
+	if (b.reward != NULL)
+		b.reward[i] = (float)reward;
+	if (b.done != NULL)
+		b.done[i] = slot.done ? 1 : 0;
+}
+
+void legoEnvDefaultConfig(LegoEnvConfig* config)
+{
+	if (config == NULL)
+		return;
+	config->count = 1;
+	config->ballNum = BALLNUM;
+	config->frameMicros = 16000;
+	config->maxFrames = 0;
+	config->threads = 1;
+	config->flags = 0;
+}
+
+LegoEnv* legoEnvCreate(const LegoEnvConfig* config)
+{
+	if (config == NULL || config->count < 1 || config->ballNum < 1 || config->frameMicros == 0 ||
+		config->maxFrames < 0 || config->threads < 0)
+		return NULL;
+	if ((config->flags & LEGO_ENV_EVENTS) != 0 && (config->flags & LEGO_ENV_DYNAMIC) != 0)
+		return NULL;  // the event driven mode does not run with dynamic mode
+
+	// nothing may throw across the C interface
+	try
+	{
+		return new LegoEnv(*config);
+	}
+	catch (const std::bad_alloc&)
+	{
+		return NULL;
+	}
+}
+
+void legoEnvDestroy(LegoEnv* env)
+{
+	delete env;
+}
+
+int legoEnvGetCount(const LegoEnv* env)
+{
+	return env != NULL ? env->config.count : 0;
+}
+
+int legoEnvGetBallNum(const LegoEnv* env)
+{
+	return env != NULL ? env->config.ballNum : 0;
+}
+
+void legoEnvBind(LegoEnv* env, const LegoEnvBuffers* buffers)
+{
+	if (env == NULL)
+		return;
+	if (buffers != NULL)
+		env->buffers = *buffers;
+	else
+		memset(&env->buffers, 0, sizeof(env->buffers));
+}
+
+int legoEnvReset(LegoEnv* env, const unsigned long long* seeds)
+{
+	if (env == NULL || seeds == NULL)
+		return -1;
+
+	auto reset = [env, seeds](int begin, int end, int) {
+		for (int i = begin; i < end; i++)
+		{
+			EnvSlot& slot = env->slots[i];
+			slot.seed = seeds[i];
+			slot.episode = 0;
+			setupSlot(slot);
+			observe(*env, i, 0);
+		}
+	};
+	env->pool.parallelFor(env->config.count, ENV_GRAIN, reset);
+	env->ready = true;
+	return 0;
+}
+
+int legoEnvStep(LegoEnv* env, const float* actions)
+{
+	if (env == NULL || actions == NULL || !env->ready)
+		return -1;
+
+	auto step = [env, actions](int begin, int end, int) {
+		long maxFrames = env->config.maxFrames;
+		for (int i = begin; i < end; i++)
+		{
+			EnvSlot& slot = env->slots[i];
+			if (slot.done)
+			{
+				slot.episode++;
+				setupSlot(slot);
+				observe(*env, i, 0);
+				continue;
+			}
+
+			sim::CGame& game = slot.game;
+			const float* action = actions + (size_t)i * LEGO_ENV_ACTION;
+			if (action[0] != 0)
+				game.movePaddle(action[0]);
+			if (action[1] > 0.5f)
+				game.launch(0);
+			game.step(env->dt);
+			slot.frames++;
+
+			int score = game.getDestroyNum();
+			int reward = score - slot.score;
+			slot.score = score;
+			slot.done = game.isOver() || (maxFrames > 0 && slot.frames >= maxFrames);
+			observe(*env, i, reward);
+		}
+	};
+	env->pool.parallelFor(env->config.count, ENV_GRAIN, step);
+
+	int done = 0;
+	for (int i = 0; i < env->config.count; i++)
+		done += env->slots[i].done ? 1 : 0;
+	return done;
+}
@@ -0,0 +1,108 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// File: legoEnv.h
+//
+// Desc: Vectorized environment for training paddle agents, as a C interface over the shared
+//       library legoEnv. One LegoEnv holds N games that reset and step as one batch: step takes
+//       one action per game and writes every observation straight into buffers the caller
+//       bound once, so nothing is allocated or returned per step.
+//
+//       The action of a game is LEGO_ENV_ACTION floats: the paddle move in world units, as
+//       WM_MOUSEMOVE passes it to CGame::movePaddle (a move past the side walls is dropped),
+//       and a launch flag, VK_SPACE when it is above 0.5. A step is then one frame of
+//       frameMicros, as the front end runs it.
+//
+//       The observations are rows of one game each, in the order of the games:
+//         balls   ballNum x, then ballNum z of the yellow balls
+//         alive   ballNum, 1 for a ball still on the table, 0 for a destroyed one
+//         red     LEGO_ENV_RED: x, z, velocity x, velocity z, 1 once launched
+//         blue    LEGO_ENV_BLUE: x, z, 1 while it is on the table
+//         paddle  1: x of the white ball
+//         life, level, reward (balls destroyed in the step): 1 each
+//         done    1 byte: the game ended in the step (or hit maxFrames)
+//       A NULL buffer is not written.
+//
+//       A game that is done is set up again on its next step, which ignores its action and
+//       returns the first observation of the new game. Game k of env i (counted from the
+//       reset) plays on seeds[i] for k = 0 and on CRandom(seeds[i]).at(k) after that.
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __legoEnvH__
+#define __legoEnvH__
+
+#if defined(_WIN32)
+#if defined(LEGO_ENV_BUILD)
+#define LEGO_ENV_API __declspec(dllexport)
+#else
+#define LEGO_ENV_API __declspec(dllimport)
+#endif
+#else
+#define LEGO_ENV_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LEGO_ENV_ACTION 2  // floats per action
+#define LEGO_ENV_RED 5     // floats per red ball row
+#define LEGO_ENV_BLUE 3    // floats per blue ball row
+
+// LegoEnvConfig::flags, the modes of CGame
+#define LEGO_ENV_DISCRETE 1  // no continuous collision
+#define LEGO_ENV_DYNAMIC 2
+#define LEGO_ENV_EVENTS 4
+#define LEGO_ENV_FRICTION 8
+
+typedef struct LegoEnv LegoEnv;
+
+typedef struct LegoEnvConfig
+{
+	int                 count;        // games in the batch
+	int                 ballNum;      // yellow balls per level
+	unsigned int        frameMicros;  // frame time of a step
+	long                maxFrames;    // a game is done after this many steps, 0: no limit
+	int                 threads;      // workers stepping the batch, 0: one per core
+	int                 flags;        // LEGO_ENV_*
+} LegoEnvConfig;
+
+typedef struct LegoEnvBuffers
+{
+	float*              balls;   // count * 2 * ballNum
+	float*              alive;   // count * ballNum
+	float*              red;     // count * LEGO_ENV_RED
+	float*              blue;    // count * LEGO_ENV_BLUE
+	float*              paddle;  // count
+	float*              life;    // count
+	float*              level;   // count
+	float*              reward;  // count
+	unsigned char*      done;    // count
+} LegoEnvBuffers;
+
+// 1 game of BALLNUM balls, 16 ms frames, no frame limit, the calling thread only
+LEGO_ENV_API void legoEnvDefaultConfig(LegoEnvConfig* config);
+
+// NULL when the config is invalid or the memory runs out
+LEGO_ENV_API LegoEnv* legoEnvCreate(const LegoEnvConfig* config);
+LEGO_ENV_API void legoEnvDestroy(LegoEnv* env);
+
+LEGO_ENV_API int legoEnvGetCount(const LegoEnv* env);
+LEGO_ENV_API int legoEnvGetBallNum(const LegoEnv* env);
+
+// the buffers stay bound until the next call, they have to outlive the steps
+LEGO_ENV_API void legoEnvBind(LegoEnv* env, const LegoEnvBuffers* buffers);
+
+// sets every game up on seeds[i] (count seeds) and writes the first observations; 0, or -1
+// for a NULL argument
+LEGO_ENV_API int legoEnvReset(LegoEnv* env, const unsigned long long* seeds);
+
+// one frame of every game with actions[i * LEGO_ENV_ACTION]; returns the number of games done
+// in the step, or -1 for a NULL argument or a batch that was never reset
+LEGO_ENV_API int legoEnvStep(LegoEnv* env, const float* actions);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __legoEnvH__
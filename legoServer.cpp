@@ -0,0 +1,167 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// File: legoServer.cpp
+//
+// Desc: Multi-table server driver. Plays a batch of games on the table server (tableServer.h)
+//       over all cores and reports the results and the aggregate frames and games per
+//       second, for tournament scoring and bot evaluation runs.
+//
+//       usage: legoServer [-games N] [-balls B] [-seed S] [-threads T] [-dt T]
+//                         [-frames F] [-discrete] [-dynamic] [-events] [-friction]
+//                         [-pack FILE] [-scale] [-v]
+//
+//       -threads T: workers, 0 (the default) for one per core.
+//       -scale: plays the batch on 1, 2, 4, ... up to T workers and prints the speedup and
+//       the parallel efficiency of each against one worker.
+//
+//       Game g is game g of headlessLego -seed S (without -assist), so both print the same
+//       results; the results do not depend on the number of workers, the checksum shows it.
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "levelPack.h"
+#include "tableServer.h"
+#include "workPool.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// FNV-1a over the results in game order
+static unsigned long long checksum(const std::vector<sim::TableResult>& results)
+{
+	unsigned long long h = 1469598103934665603ull;
+	for (size_t g = 0; g < results.size(); g++)
+	{
+		const sim::TableResult& r = results[g];
+		long long fields[] = { r.frames, r.level, r.destroyNum, r.life, r.win, r.defeated, r.failed };
+		for (size_t f = 0; f < sizeof(fields) / sizeof(fields[0]); f++)
+		{
+			h ^= (unsigned long long)fields[f];
+			h *= 1099511628211ull;
+		}
+	}
+	return h;
+}
+
+static double play(sim::CTableServer& server, unsigned long long seed, int games, std::vector<sim::TableResult>& results)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	server.run(seed, games, results);
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char* argv[])
+{
+	int games = 10000;
+	unsigned long long seed = 1;
+	int threads = 0;
+	bool scale = false;
+	bool verbose = false;
+	const char* packPath = NULL;
+	sim::TableSettings settings;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "-games") && i + 1 < argc) games = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-balls") && i + 1 < argc) settings.ballNum = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-seed") && i + 1 < argc) seed = strtoull(argv[++i], 0, 10);
+		else if (!strcmp(argv[i], "-threads") && i + 1 < argc) threads = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-dt") && i + 1 < argc)  // game units, in whole microseconds as headlessLego
+			settings.frameMicros = (unsigned int)std::max(1L, std::lround(atof(argv[++i]) / sim::GAME_TIME_PER_MS * 1000));
+		else if (!strcmp(argv[i], "-frames") && i + 1 < argc) settings.maxFrames = atol(argv[++i]);
+		else if (!strcmp(argv[i], "-discrete")) settings.continuous = false;
+		else if (!strcmp(argv[i], "-dynamic")) settings.dynamic = true;
+		else if (!strcmp(argv[i], "-events")) settings.eventDriven = true;
+		else if (!strcmp(argv[i], "-friction")) settings.friction = true;
+		else if (!strcmp(argv[i], "-pack") && i + 1 < argc) packPath = argv[++i];
+		else if (!strcmp(argv[i], "-scale")) scale = true;
+		else if (!strcmp(argv[i], "-v")) verbose = true;
+		else
+		{
+			printf("usage: legoServer [-games N] [-balls B] [-seed S] [-threads T] [-dt T]\n"
+				"                  [-frames F] [-discrete] [-dynamic] [-events] [-friction]\n"
+				"                  [-pack FILE] [-scale] [-v]\n");
+			return 1;
+		}
+	}
+
+	sim::CLevelPack pack;
+	if (packPath != NULL)
+	{
+		if (!pack.open(packPath))
+		{
+			printf("could not map the level pack %s\n", packPath);
+			return 1;
+		}
+		if (pack.getSeed() != seed || pack.getBallNum() != settings.ballNum)
+		{
+			printf("%s was built for -seed %llu -balls %d\n", packPath, pack.getSeed(), pack.getBallNum());
+			return 1;
+		}
+		settings.pack = &pack;
+	}
+
+	sim::CWorkPool pool(threads);
+	std::vector<sim::TableResult> results;
+
+	if (scale)
+	{
+		double single = 0;
+		printf("workers   games/s    frames/s  speedup  efficiency  checksum\n");
+		for (int w = 1; ; w = std::min(w * 2, pool.getWorkers()))
+		{
+			sim::CWorkPool workers(w);
+			sim::CTableServer server(&workers);
+			server.getSettings() = settings;
+			double seconds = play(server, seed, games, results);
+			if (w == 1)
+				single = seconds;
+			printf("%7d %9.0f %11.0f %7.2fx %10.0f%%  %016llx\n", w, games / seconds, server.getFrames() / seconds,
+				single / seconds, 100 * single / seconds / w, checksum(results));
+			if (w == pool.getWorkers())
+				break;
+		}
+		return 0;
+	}
+
+	sim::CTableServer server(&pool);
+	server.getSettings() = settings;
+	double seconds = play(server, seed, games, results);
+
+	int wins = 0, defeats = 0, failed = 0, unfinished = 0;
+	long long levelSum = 0, scoreSum = 0;
+	for (int g = 0; g < games; g++)
+	{
+		const sim::TableResult& r = results[g];
+		if (r.win) wins++;
+		else if (r.defeated) defeats++;
+		else if (r.failed) failed++;
+		else unfinished++;
+		levelSum += r.level;
+		scoreSum += r.destroyNum;
+
+		if (verbose)
+			printf("game %d: %s level %d score %d frames %ld\n", g,
+				r.win ? "win" : (r.defeated ? "defeat" : (r.failed ? "failed" : "unfinished")), r.level, r.destroyNum,
+				r.frames);
+	}
+
+	long long frames = server.getFrames();
+	long long minFrames = frames, maxFrames = 0;
+	for (int w = 0; w < server.getWorkers(); w++)
+	{
+		minFrames = std::min(minFrames, server.getWorkerFrames(w));
+		maxFrames = std::max(maxFrames, server.getWorkerFrames(w));
+	}
+
+	printf("games %d  wins %d  defeats %d  failed layouts %d  unfinished %d\n", games, wins, defeats, failed, unfinished);
+	printf("average level %.2f  average score %.2f\n", (double)levelSum / games, (double)scoreSum / games);
+	printf("frames %lld  time %.3f s  %.0f frames/s  %.1f games/s\n", frames, seconds,
+		seconds > 0 ? frames / seconds : 0.0, seconds > 0 ? games / seconds : 0.0);
+	printf("workers %d  frames per worker %lld to %lld  checksum %016llx\n", server.getWorkers(), minFrames, maxFrames,
+		checksum(results));
+	return 0;
+}
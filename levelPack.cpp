@@ -0,0 +1,252 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// File: levelPack.cpp
+//
+// Desc: Level pack mapping and builder.
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "levelPack.h"
+#include "workPool.h"
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const char LEVEL_PACK_MAGIC[4] = { 'V', 'B', 'L', 'P' };
+
+static_assert(sizeof(sim::LevelPackHeader) == 64, "the header is part of the file format");
+static_assert(sizeof(sim::LevelRecord) == 16 && sizeof(sim::Vec2) == 8, "records are part of the file format");
+
+static size_t recordSize(int ballNum)
+{
+	return sizeof(sim::LevelRecord) + ballNum * sizeof(sim::Vec2);
+}
+
+//
+// Mapping
+//
+
+static const unsigned char* mapFile(const char* path, size_t& size)
+{
+#ifdef _WIN32
+	HANDLE file = ::CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return NULL;
+	LARGE_INTEGER length;
+	HANDLE mapping = NULL;
+	if (::GetFileSizeEx(file, &length) && length.QuadPart > 0)
+		mapping = ::CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	::CloseHandle(file);
+	if (mapping == NULL)
+		return NULL;
+	// the view keeps the mapping alive
+	void* view = ::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	::CloseHandle(mapping);
+	size = (size_t)length.QuadPart;
+	return (const unsigned char*)view;
+#else
+	int file = ::open(path, O_RDONLY);
+	if (file < 0)
+		return NULL;
+	struct stat info;
+	void* view = MAP_FAILED;
+	if (::fstat(file, &info) == 0 && info.st_size > 0)
+		view = ::mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_SHARED, file, 0);
+	::close(file);
+	if (view == MAP_FAILED)
+		return NULL;
+	size = (size_t)info.st_size;
+	return (const unsigned char*)view;
+#endif
+}
+
+static void unmapFile(const unsigned char* data, size_t size)
+{
+#ifdef _WIN32
+	(void)size;
+	::UnmapViewOfFile(data);
+#else
+	::munmap((void*)data, size);
+#endif
+}
+
+//
+// CLevelPack
+//
+
+sim::CLevelPack::CLevelPack(void)
+{
+	m_data = NULL;
+	m_size = 0;
+	m_header = NULL;
+}
+
+sim::CLevelPack::~CLevelPack(void)
+{
+	close();
+}
+
+bool sim::CLevelPack::open(const char* path)
+{
+	close();
+	size_t size = 0;
+	const unsigned char* data = mapFile(path, size);
+	if (data == NULL)
+		return false;
+
+	// every record the header promises has to be in the file
+	const LevelPackHeader* header = (const LevelPackHeader*)data;
+	bool valid = size >= sizeof(LevelPackHeader) && memcmp(header->magic, LEVEL_PACK_MAGIC, 4) == 0 &&
+		header->version == LEVEL_PACK_VERSION && header->recordSize == recordSize((int)header->ballNum) &&
+		header->recordsOffset >= sizeof(LevelPackHeader) + header->tables * 8ull &&
+		header->recordsOffset % 8 == 0 && header->recordsOffset <= size &&
+		(size - header->recordsOffset) / header->recordSize >= (unsigned long long)header->tables * header->levels;
+	if (!valid)
+	{
+		unmapFile(data, size);
+		return false;
+	}
+
+	m_data = data;
+	m_size = size;
+	m_header = header;
+	return true;
+}
+
+void sim::CLevelPack::close(void)
+{
+	if (m_data != NULL)
+		unmapFile(m_data, m_size);
+	m_data = NULL;
+	m_size = 0;
+	m_header = NULL;
+}
+
+unsigned long long sim::CLevelPack::getTableSeed(int table) const
+{
+	unsigned long long seed;
+	memcpy(&seed, m_data + sizeof(LevelPackHeader) + table * 8ull, sizeof(seed));
+	return seed;
+}
+
+bool sim::CLevelPack::getLevel(int table, int level, PackedLevel& packed) const
+{
+	if (m_header == NULL || table < 0 || table >= (int)m_header->tables || level < 1 || level > (int)m_header->levels)
+		return false;
+
+	const unsigned char* record = m_data + m_header->recordsOffset +
+		((unsigned long long)table * m_header->levels + (level - 1)) * m_header->recordSize;
+	const LevelRecord* r = (const LevelRecord*)record;
+	packed.flags = r->flags;
+	packed.blue = r->blue;
+	packed.positions = (const Vec2*)(record + sizeof(LevelRecord));
+	return true;
+}
+
+//
+// CLevelPackBuilder
+//
+
+sim::CLevelPackBuilder::CLevelPackBuilder(void)
+{
+	m_failed = 0;
+}
+
+void sim::CLevelPackBuilder::build(unsigned long long seed, int tables, int levels, int ballNum, CWorkPool* pool)
+{
+	size_t size = recordSize(ballNum);
+	size_t seedsOffset = sizeof(LevelPackHeader);
+	size_t recordsOffset = (seedsOffset + tables * 8ull + 7) / 8 * 8;
+	m_data.assign(recordsOffset + (size_t)tables * levels * size, 0);
+
+	LevelPackHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, LEVEL_PACK_MAGIC, 4);
+	header.version = LEVEL_PACK_VERSION;
+	header.ballNum = (unsigned int)ballNum;
+	header.tables = (unsigned int)tables;
+	header.levels = (unsigned int)levels;
+	header.recordSize = (unsigned int)size;
+	header.seed = seed;
+	header.recordsOffset = recordsOffset;
+	memcpy(m_data.data(), &header, sizeof(header));
+
+	CRandom master(seed);
+	for (int t = 0; t < tables; t++)
+	{
+		unsigned long long tableSeed = master.at((unsigned long long)t);
+		memcpy(&m_data[seedsOffset + t * 8ull], &tableSeed, sizeof(tableSeed));
+	}
+
+	// one record per item, the layout scratch per worker
+	struct Scratch
+	{
+		CSpatialGrid        grid;
+		CPoissonDisk        sampler;
+		std::vector<Vec2>   positions;
+		CBall               blue;
+		int                 failed;
+	};
+	int workers = pool != NULL ? pool->getWorkers() : 1;
+	std::vector<Scratch> scratch(workers);
+	for (int w = 0; w < workers; w++)
+	{
+		initTableGrid(scratch[w].grid);
+		scratch[w].failed = 0;
+	}
+
+	unsigned char* records = &m_data[recordsOffset];
+	const CStaticGeometry& classic = getClassicGeometry();
+	auto generate = [&](int begin, int end, int worker) {
+		Scratch& s = scratch[worker];
+		for (int i = begin; i < end; i++)
+		{
+			int table = i / levels, level = i % levels + 1;
+			CRandom random(master.at((unsigned long long)table));
+			bool blue = false;
+			unsigned char* record = records + (size_t)i * size;
+			LevelRecord r;
+			memset(&r, 0, sizeof(r));
+			if (generateLevel(random, level, ballNum, classic, s.positions, s.grid, s.sampler, s.blue, blue))
+			{
+				r.flags = LEVEL_PLACED | (blue ? LEVEL_BLUE : 0);
+				if (blue)
+					r.blue = s.blue.getCenter();
+				memcpy(record + sizeof(LevelRecord), s.positions.data(), ballNum * sizeof(Vec2));
+			}
+			else
+			{
+				s.failed++;
+			}
+			memcpy(record, &r, sizeof(r));
+		}
+	};
+	int count = tables * levels;
+	if (pool != NULL)
+		pool->parallelFor(count, 16, generate);
+	else
+		generate(0, count, 0);
+
+	m_failed = 0;
+	for (int w = 0; w < workers; w++)
+		m_failed += scratch[w].failed;
+}
+
+bool sim::CLevelPackBuilder::save(const char* path) const
+{
+	FILE* file = fopen(path, "wb");
+	if (file == NULL)
+		return false;
+	bool ok = fwrite(m_data.data(), 1, m_data.size(), file) == m_data.size();
+	return fclose(file) == 0 && ok;
+}
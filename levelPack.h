@@ -0,0 +1,123 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// File: levelPack.h
+//
+// Desc: Level packs: the layouts of many tables and levels generated ahead of time (packLego)
+//       into one file of fixed size records, which the game maps into memory and indexes
+//       directly. A level transition then copies its layout out of the mapping, with no
+//       generation, parsing or allocation.
+//
+//       Format, native byte order (little endian on every target of the game):
+//
+//           header   LevelPackHeader, 64 bytes
+//           seeds    tables x u64, the game seed of table t: CRandom(seed).at(t), as
+//                    headlessLego seeds its games
+//           records  tables x levels records of recordSize bytes from recordsOffset, level
+//                    l of table t at (t * levels + l - 1) * recordSize
+//
+//       A record is a LevelRecord (flags and the blue ball) followed by the ballNum yellow
+//       balls as x z floats. A layout that could not hold the balls is stored without
+//       LEVEL_PLACED, so the game fails on it as it would have generating it. A pack of
+//       another version is refused, not converted.
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __levelPackH__
+#define __levelPackH__
+
+#include "simCore.h"
+#include <cstddef>
+#include <vector>
+
+namespace sim
+{
+	const unsigned int LEVEL_PACK_VERSION = 2;  // 1: layouts that could touch the walls
+
+	enum { LEVEL_PLACED = 1, LEVEL_BLUE = 2 };  // LevelRecord flags
+
+	struct LevelPackHeader
+	{
+		char                magic[4];       // "VBLP"
+		unsigned int        version;        // LEVEL_PACK_VERSION
+		unsigned int        ballNum;
+		unsigned int        tables;
+		unsigned int        levels;         // levels 1 to levels of every table
+		unsigned int        recordSize;
+		unsigned long long  seed;           // master seed of the tables
+		unsigned long long  recordsOffset;
+		unsigned char       reserved[24];
+	};
+
+	struct LevelRecord
+	{
+		unsigned int        flags;
+		unsigned int        reserved;
+		Vec2                blue;           // LEVEL_BLUE: position of the blue ball
+	};
+
+	// a level as the pack holds it, positions point into the mapping
+	struct PackedLevel
+	{
+		unsigned int        flags;
+		Vec2                blue;
+		const Vec2*         positions;      // ballNum yellow balls
+	};
+
+	//
+	// Reading: a read-only mapping of the file
+	//
+
+	class CLevelPack {
+	public:
+		CLevelPack(void);
+		~CLevelPack(void);
+
+		// false when the file is missing, of another version or shorter than its header says
+		bool open(const char* path);
+		void close(void);
+		bool isOpen(void) const { return m_header != NULL; }
+
+		unsigned long long getSeed(void) const { return m_header->seed; }
+		int getBallNum(void) const { return (int)m_header->ballNum; }
+		int getTables(void) const { return (int)m_header->tables; }
+		int getLevels(void) const { return (int)m_header->levels; }
+		unsigned long long getTableSeed(int table) const;
+
+		// O(1); false when the pack does not hold the level
+		bool getLevel(int table, int level, PackedLevel& packed) const;
+
+	private:
+		CLevelPack(const CLevelPack&);
+		CLevelPack& operator=(const CLevelPack&);
+
+		const unsigned char*    m_data;
+		size_t              m_size;
+		const LevelPackHeader*  m_header;
+	};
+
+	//
+	// Building
+	//
+
+	class CWorkPool;
+
+	class CLevelPackBuilder {
+	public:
+		CLevelPackBuilder(void);
+
+		// generates levels 1 to levels of tables tables of ballNum balls with generateLevel on
+		// the classic table, spread over the workers of pool (NULL: on this thread); the
+		// records do not depend on the number of workers
+		void build(unsigned long long seed, int tables, int levels, int ballNum, CWorkPool* pool);
+
+		const std::vector<unsigned char>& getData(void) const { return m_data; }
+		int getFailed(void) const { return m_failed; }  // layouts that could not hold the balls
+		bool save(const char* path) const;
+
+	private:
+		std::vector<unsigned char>  m_data;
+		int                 m_failed;
+	};
+}
+
+#endif // __levelPackH__
@@ -0,0 +1,235 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// File: meshCache.cpp
+//
+// Desc: Sphere and box generators and the reference counted mesh cache.
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "meshCache.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+static const float MESH_PI = 3.14159265f;
+
+static void addVertex(render::Geometry& out, float x, float y, float z, float nx, float ny, float nz)
+{
+	render::Vertex v = { x, y, z, nx, ny, nz };
+	out.vertices.push_back(v);
+}
+
+static void addTriangle(render::Geometry& out, int a, int b, int c)
+{
+	out.indices.push_back((unsigned short)a);
+	out.indices.push_back((unsigned short)b);
+	out.indices.push_back((unsigned short)c);
+}
+
+// Direct3D culls counter-clockwise faces by default; seen from outside, a front face has
+// (b - a) x (c - a) along its outward normal
+void render::generateSphere(float radius, int slices, int stacks, Geometry& out)
+{
+	assert(slices >= 3 && stacks >= 2 && slices * (stacks - 1) + 2 <= 0x10000);
+	out.vertices.clear();
+	out.indices.clear();
+
+	addVertex(out, 0, 0, radius, 0, 0, 1);
+	for (int i = 1; i < stacks; i++)
+	{
+		float theta = MESH_PI * i / stacks;
+		float z = std::cos(theta), ring = std::sin(theta);
+		for (int j = 0; j < slices; j++)
+		{
+			float phi = 2 * MESH_PI * j / slices;
+			float x = ring * std::cos(phi), y = ring * std::sin(phi);
+			addVertex(out, radius * x, radius * y, radius * z, x, y, z);
+		}
+	}
+	addVertex(out, 0, 0, -radius, 0, 0, -1);
+
+	const int bottom = (int)out.vertices.size() - 1;
+	for (int j = 0; j < slices; j++)
+	{
+		int next = (j + 1) % slices;
+		addTriangle(out, 0, 1 + j, 1 + next);
+		for (int i = 0; i < stacks - 2; i++)
+		{
+			int upper = 1 + i * slices, lower = upper + slices;
+			addTriangle(out, upper + j, lower + j, lower + next);
+			addTriangle(out, upper + j, lower + next, upper + next);
+		}
+		int last = 1 + (stacks - 2) * slices;
+		addTriangle(out, last + j, bottom, last + next);
+	}
+}
+
+void render::generateBox(float width, float height, float depth, Geometry& out)
+{
+	out.vertices.clear();
+	out.indices.clear();
+
+	const float half[3] = { width / 2, height / 2, depth / 2 };
+	for (int axis = 0; axis < 3; axis++)
+	{
+		int u = (axis + 1) % 3, v = (axis + 2) % 3;
+		for (int sign = -1; sign <= 1; sign += 2)
+		{
+			float n[3] = { 0, 0, 0 };
+			n[axis] = (float)sign;
+
+			// corners around the face, turning from u towards v
+			const float cu[4] = { -1, 1, 1, -1 }, cv[4] = { -1, -1, 1, 1 };
+			int base = (int)out.vertices.size();
+			for (int k = 0; k < 4; k++)
+			{
+				float p[3];
+				p[axis] = sign * half[axis];
+				p[u] = cu[k] * half[u];
+				p[v] = cv[k] * half[v];
+				addVertex(out, p[0], p[1], p[2], n[0], n[1], n[2]);
+			}
+			// u x v is +axis, so base, base + 1, base + 2 faces +axis
+			if (sign > 0)
+			{
+				addTriangle(out, base, base + 1, base + 2);
+				addTriangle(out, base, base + 2, base + 3);
+			}
+			else
+			{
+				addTriangle(out, base, base + 2, base + 1);
+				addTriangle(out, base, base + 3, base + 2);
+			}
+		}
+	}
+}
+
+void render::generate(const MeshDesc& desc, Geometry& out)
+{
+	if (desc.shape == SHAPE_SPHERE)
+		generateSphere(desc.width, desc.slices, desc.stacks, out);
+	else
+		generateBox(desc.width, desc.height, desc.depth, out);
+}
+
+// a sphere of n slices and m stacks is a polygon of n sides around its equator and of 2 m
+// sides over the poles; a polygon of k sides misses its circle by r (1 - cos(pi / k))
+static float getMaxRadius(const render::MeshDesc& desc)
+{
+	if (desc.shape != render::SHAPE_SPHERE)
+		return 1e30f;
+	int sides = std::min(desc.slices, 2 * desc.stacks);
+	return render::LOD_TOLERANCE / (1 - std::cos(MESH_PI / sides));
+}
+
+int render::selectLod(const MeshLods& lods, float screenRadius)
+{
+	int level = 0;
+	while (level + 1 < lods.count && screenRadius <= lods.maxRadius[level + 1])
+		level++;
+	return level;
+}
+
+int render::makeLods(const MeshDesc& desc, MeshDesc levels[MAX_MESH_LODS])
+{
+	levels[0] = desc;
+	if (desc.shape != SHAPE_SPHERE)
+		return 1;
+
+	int count = 1;
+	for (int k = 1; k < MAX_MESH_LODS; k++)
+	{
+		MeshDesc level = desc;
+		level.slices = std::min(desc.slices, std::max(MIN_SPHERE_SLICES, desc.slices >> k));
+		level.stacks = std::min(desc.stacks, std::max(MIN_SPHERE_STACKS, desc.stacks >> k));
+		if (level.slices == levels[count - 1].slices && level.stacks == levels[count - 1].stacks)
+			break;
+		levels[count++] = level;
+	}
+	return count;
+}
+
+//
+// CMeshCache
+//
+
+static bool sameDesc(const render::MeshDesc& a, const render::MeshDesc& b)
+{
+	return a.shape == b.shape && a.width == b.width && a.height == b.height && a.depth == b.depth &&
+		a.slices == b.slices && a.stacks == b.stacks;
+}
+
+int render::CMeshCache::acquire(const MeshDesc& desc)
+{
+	int slot = -1;
+	for (size_t i = 0; i < m_entries.size(); i++)
+	{
+		if (m_entries[i].refs > 0 && sameDesc(m_entries[i].desc, desc))
+		{
+			m_entries[i].refs++;
+			return (int)i;
+		}
+		if (m_entries[i].refs == 0 && slot < 0)
+			slot = (int)i;
+	}
+
+	if (slot < 0)
+	{
+		slot = (int)m_entries.size();
+		m_entries.push_back(Entry());
+	}
+	Entry& e = m_entries[slot];
+	e.desc = desc;
+	e.refs = 1;
+	generate(desc, e.geometry);
+	return slot;
+}
+
+void render::CMeshCache::release(int id)
+{
+	assert(isLive(id));
+	if (--m_entries[id].refs == 0)
+		m_entries[id].geometry = Geometry();  // gives the storage back
+}
+
+void render::CMeshCache::acquireLods(const MeshDesc& desc, MeshLods& lods)
+{
+	MeshDesc levels[MAX_MESH_LODS];
+	lods.count = makeLods(desc, levels);
+	for (int i = 0; i < lods.count; i++)
+	{
+		lods.mesh[i] = acquire(levels[i]);
+		lods.maxRadius[i] = getMaxRadius(levels[i]);
+	}
+}
+
+void render::CMeshCache::releaseLods(MeshLods& lods)
+{
+	for (int i = 0; i < lods.count; i++)
+		release(lods.mesh[i]);
+	lods.count = 0;
+}
+
+bool render::CMeshCache::isLive(int id) const
+{
+	return id >= 0 && id < (int)m_entries.size() && m_entries[id].refs > 0;
+}
+
+int render::CMeshCache::getMeshCount(void) const
+{
+	int count = 0;
+	for (size_t i = 0; i < m_entries.size(); i++)
+		count += m_entries[i].refs > 0 ? 1 : 0;
+	return count;
+}
+
+size_t render::CMeshCache::getBytes(void) const
+{
+	size_t bytes = 0;
+	for (size_t i = 0; i < m_entries.size(); i++)
+	{
+		const Geometry& g = m_entries[i].geometry;
+		bytes += g.vertices.size() * sizeof(Vertex) + g.indices.size() * sizeof(unsigned short);
+	}
+	return bytes;
+}
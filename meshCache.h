@@ -0,0 +1,110 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// File: meshCache.h
+//
+// Desc: Shared procedural geometry. generateSphere / generateBox build the same triangle lists
+//       as D3DXCreateSphere / D3DXCreateBox (position and normal per vertex, 16 bit indices,
+//       clockwise front faces), without a device, so every backend draws the same geometry.
+//
+//       CMeshCache keeps one copy of every mesh, keyed by its MeshDesc. acquire() of a mesh
+//       that is already cached only adds a reference, and the geometry is freed when the last
+//       reference is released, so the memory depends on the kinds of meshes in use and not on
+//       how many objects draw them or how often they are acquired again. A sphere is cached
+//       as a chain of tessellations (MeshLods), finest first, for level of detail.
+//
+//       The ids of the cache are the mesh ids of the render list.
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __meshCacheH__
+#define __meshCacheH__
+
+#include <cstddef>
+#include <vector>
+
+namespace render
+{
+	enum { SHAPE_SPHERE, SHAPE_BOX };
+
+	const int MAX_MESH_LODS = 4;
+	const int MIN_SPHERE_SLICES = 6;  // the coarsest level of a chain
+	const int MIN_SPHERE_STACKS = 4;
+	const float LOD_TOLERANCE = 0.5f;  // pixels between the silhouette of a level and the true one
+
+	struct MeshDesc
+	{
+		int                 shape;
+		float               width, height, depth;  // box size, or the radius of a sphere in width
+		int                 slices, stacks;        // sphere tessellation
+	};
+
+	// the layout of D3DFVF_XYZ | D3DFVF_NORMAL
+	struct Vertex
+	{
+		float               x, y, z;
+		float               nx, ny, nz;
+	};
+
+	// triangle list
+	struct Geometry
+	{
+		std::vector<Vertex>         vertices;
+		std::vector<unsigned short> indices;
+
+		int getTriangleCount(void) const { return (int)indices.size() / 3; }
+	};
+
+	// centred on the origin, poles on the z axis; slices * (stacks - 1) + 2 vertices and
+	// slices * (stacks - 1) * 2 triangles
+	void generateSphere(float radius, int slices, int stacks, Geometry& out);
+	// centred on the origin, four vertices per face for flat normals (24), 12 triangles
+	void generateBox(float width, float height, float depth, Geometry& out);
+	void generate(const MeshDesc& desc, Geometry& out);
+
+	// the tessellations of desc, finest (desc itself) first: the slices and stacks of a sphere
+	// are halved per level down to MIN_SPHERE_SLICES / MIN_SPHERE_STACKS, a box has one level
+	int makeLods(const MeshDesc& desc, MeshDesc levels[MAX_MESH_LODS]);
+
+	struct MeshLods
+	{
+		int                 count;
+		int                 mesh[MAX_MESH_LODS];
+		float               maxRadius[MAX_MESH_LODS];  // on screen, within LOD_TOLERANCE up to it
+	};
+
+	// the coarsest level of lods that stays within LOD_TOLERANCE of the shape when it is drawn
+	// screenRadius pixels large
+	int selectLod(const MeshLods& lods, float screenRadius);
+
+	class CMeshCache {
+	public:
+		// the id of desc, generated on the first reference
+		int acquire(const MeshDesc& desc);
+		void release(int id);
+
+		// every level of makeLods(desc)
+		void acquireLods(const MeshDesc& desc, MeshLods& lods);
+		void releaseLods(MeshLods& lods);  // count is 0 afterwards
+
+		bool isLive(int id) const;
+		const MeshDesc& getDesc(int id) const { return m_entries[id].desc; }
+		const Geometry& getGeometry(int id) const { return m_entries[id].geometry; }
+		int getRefCount(int id) const { return m_entries[id].refs; }
+
+		int getCapacity(void) const { return (int)m_entries.size(); }  // ids are below this
+		int getMeshCount(void) const;  // live meshes
+		size_t getBytes(void) const;   // vertex and index data of the live meshes
+
+	private:
+		struct Entry
+		{
+			MeshDesc        desc;
+			Geometry        geometry;
+			int             refs;  // 0: free slot
+		};
+
+		std::vector<Entry>  m_entries;
+	};
+}
+
+#endif // __meshCacheH__
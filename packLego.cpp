@@ -0,0 +1,138 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// File: packLego.cpp
+//
+// Desc: Level pack builder. Generates the layouts of levels 1 to L of N tables (the yellow
+//       balls, and the blue ball where it shows up) over all cores and writes them as a level
+//       pack (levelPack.h) that headlessLego -pack and virtualLego -pack map and play.
+//
+//       usage: packLego [-tables N] [-levels L] [-balls B] [-seed S] [-threads T] [-verify] FILE
+//
+//       The tables are the games of headlessLego -seed S: table t is game t. -verify maps the
+//       written pack, compares every level with a fresh generateLevel on one thread and times
+//       both; the exit code is then the number of levels that differ (at most 255).
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "levelPack.h"
+#include "workPool.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// places every level of the pack both ways and counts the ones that differ
+static int verify(const sim::CLevelPack& pack)
+{
+	sim::CSpatialGrid grid;
+	sim::CPoissonDisk sampler;
+	std::vector<sim::Vec2> positions;
+	sim::CBall blue;
+	sim::initTableGrid(grid);
+	int ballNum = pack.getBallNum();
+	int levels = pack.getTables() * pack.getLevels();
+	int bad = 0;
+	double generateSeconds = 0, packSeconds = 0;
+	float sum = 0;
+
+	for (int t = 0; t < pack.getTables(); t++)
+	{
+		sim::CRandom table(pack.getTableSeed(t));
+		for (int l = 1; l <= pack.getLevels(); l++)
+		{
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			bool blueActivated = false;
+			bool placed = sim::generateLevel(table, l, ballNum, sim::getClassicGeometry(), positions, grid, sampler, blue, blueActivated);
+			std::chrono::steady_clock::time_point generated = std::chrono::steady_clock::now();
+
+			// what placeBalls reads of a packed level
+			sim::PackedLevel packed;
+			pack.getLevel(t, l, packed);
+			for (int i = 0; i < ballNum; i++)
+				sum += packed.positions[i].x + packed.positions[i].z;
+			std::chrono::steady_clock::time_point read = std::chrono::steady_clock::now();
+			generateSeconds += std::chrono::duration<double>(generated - start).count();
+			packSeconds += std::chrono::duration<double>(read - generated).count();
+
+			bool same = placed == ((packed.flags & sim::LEVEL_PLACED) != 0);
+			if (same && placed)
+			{
+				same = blueActivated == ((packed.flags & sim::LEVEL_BLUE) != 0) &&
+					memcmp(packed.positions, positions.data(), ballNum * sizeof(sim::Vec2)) == 0;
+				if (same && blueActivated)
+					same = blue.getCenter().x == packed.blue.x && blue.getCenter().z == packed.blue.z;
+			}
+			if (!same)
+			{
+				if (bad < 10)
+					printf("table %d level %d differs\n", t, l);
+				bad++;
+			}
+		}
+	}
+
+	printf("verified %d levels  differ %d  (checksum %g)\n", levels, bad, sum);
+	printf("per level: generate %.2f us  pack %.3f us\n", generateSeconds * 1e6 / levels, packSeconds * 1e6 / levels);
+	return bad;
+}
+
+int main(int argc, char* argv[])
+{
+	int tables = 1000;
+	int levels = 100;
+	int balls = BALLNUM;
+	unsigned long long seed = 1;
+	int threads = 0;  // one per core
+	bool check = false;
+	const char* path = NULL;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "-tables") && i + 1 < argc) tables = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-levels") && i + 1 < argc) levels = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-balls") && i + 1 < argc) balls = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-seed") && i + 1 < argc) seed = strtoull(argv[++i], 0, 10);
+		else if (!strcmp(argv[i], "-threads") && i + 1 < argc) threads = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-verify")) check = true;
+		else if (argv[i][0] != '-' && path == NULL) path = argv[i];
+		else
+		{
+			path = NULL;
+			break;
+		}
+	}
+	if (path == NULL || tables < 1 || levels < 1 || balls < 1)
+	{
+		printf("usage: packLego [-tables N] [-levels L] [-balls B] [-seed S] [-threads T] [-verify] FILE\n");
+		return 1;
+	}
+
+	sim::CWorkPool pool(threads);
+	sim::CLevelPackBuilder builder;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	builder.build(seed, tables, levels, balls, &pool);
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	if (!builder.save(path))
+	{
+		printf("could not write %s\n", path);
+		return 1;
+	}
+	int count = tables * levels;
+	printf("tables %d  levels %d  balls %d  failed layouts %d  %.1f MB\n", tables, levels, balls, builder.getFailed(),
+		builder.getData().size() / 1048576.0);
+	printf("time %.3f s  %.0f levels/s  workers %d\n", seconds, seconds > 0 ? count / seconds : 0.0,
+		pool.getWorkers());
+
+	if (!check)
+		return 0;
+	sim::CLevelPack pack;
+	if (!pack.open(path))
+	{
+		printf("could not map %s\n", path);
+		return 1;
+	}
+	return std::min(verify(pack), 255);
+}
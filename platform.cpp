@@ -0,0 +1,146 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// File: platform.cpp
+//
+// Desc: Steady and virtual clocks, the headless platform and the frame loop.
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "platform.h"
+#include <chrono>
+#include <thread>
+
+//
+// CSteadyClock
+//
+
+unsigned long long platform::CSteadyClock::now(void)
+{
+	return (unsigned long long)std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void platform::CSteadyClock::sleepUntil(unsigned long long nanos)
+{
+	unsigned long long t = now();
+	if (nanos > t)
+		std::this_thread::sleep_for(std::chrono::nanoseconds(nanos - t));
+}
+
+platform::IClock& platform::getSteadyClock(void)
+{
+	static CSteadyClock clock;
+	return clock;
+}
+
+//
+// CVirtualClock
+//
+
+platform::CVirtualClock::CVirtualClock(double warp)
+	: m_skipped(0)
+{
+	m_warp = warp;
+	m_base = 0;
+	m_realStart = getSteadyClock().now();
+}
+
+void platform::CVirtualClock::setWarp(double warp)
+{
+	m_base = now();
+	m_realStart = getSteadyClock().now();
+	m_skipped.store(0, std::memory_order_relaxed);
+	m_warp = warp < 0 ? 0 : warp;
+}
+
+void platform::CVirtualClock::advance(unsigned long long nanos)
+{
+	m_skipped.fetch_add(nanos, std::memory_order_relaxed);
+}
+
+unsigned long long platform::CVirtualClock::now(void)
+{
+	unsigned long long t = m_base + m_skipped.load(std::memory_order_relaxed);
+	if (m_warp > 0)
+		t += (unsigned long long)((getSteadyClock().now() - m_realStart) * m_warp);
+	return t;
+}
+
+// with a warp the wait is real, shortened by the warp; without, the clock jumps, and of two
+// threads that sleep at once the later wake up time wins
+void platform::CVirtualClock::sleepUntil(unsigned long long nanos)
+{
+	if (m_warp > 0)
+	{
+		unsigned long long t = now();
+		if (nanos > t)
+			std::this_thread::sleep_for(std::chrono::nanoseconds((long long)((nanos - t) / m_warp)));
+		return;
+	}
+	unsigned long long skipped = m_skipped.load(std::memory_order_relaxed);
+	while (m_base + skipped < nanos &&
+		!m_skipped.compare_exchange_weak(skipped, nanos - m_base, std::memory_order_relaxed))
+	{
+	}
+}
+
+//
+// CHeadlessPlatform
+//
+
+platform::CHeadlessPlatform::CHeadlessPlatform(double warp)
+	: m_clock(warp)
+{
+	m_width = m_height = 0;
+}
+
+bool platform::CHeadlessPlatform::createWindow(const char* title, int width, int height)
+{
+	m_title = title;
+	m_width = width;
+	m_height = height;
+	return true;
+}
+
+void platform::CHeadlessPlatform::close(void)
+{
+	Event e = { EVENT_QUIT, 0, 0, 0, 0 };
+	m_events.push_back(e);
+}
+
+bool platform::CHeadlessPlatform::pollEvent(Event& e)
+{
+	if (m_events.empty())
+		return false;
+	e = m_events.front();
+	m_events.pop_front();
+	return true;
+}
+
+//
+// Frame loop
+//
+
+int platform::runLoop(IPlatform& platform, IApplication& app, unsigned int frameMicros)
+{
+	IClock& clock = platform.getClock();
+	unsigned long long last = clock.now();
+	for (;;)
+	{
+		Event e;
+		while (platform.pollEvent(e))
+		{
+			if (e.type == EVENT_QUIT)
+				return e.key;
+			app.onEvent(e);
+		}
+
+		if (frameMicros > 0)
+			clock.sleepUntil(last + frameMicros * 1000ULL);
+		unsigned long long elapsed = clock.now() - last;
+		unsigned int micros = (unsigned int)(elapsed / 1000);
+		last += micros * 1000ULL;  // the nanoseconds left over go to the next frame
+		if (!app.frame(micros))
+			return 0;
+	}
+}
@@ -0,0 +1,153 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// File: platform.h
+//
+// Desc: Windowing, input events and a monotonic clock behind one interface, and the frame loop
+//       that runs on top of them. CWin32Platform (platformWin32.h) opens the window of the
+//       front end and reads the performance counter; CHeadlessPlatform has no window, takes
+//       its events from a queue the caller fills and keeps time on a CVirtualClock, so the
+//       same loop runs in a batch job as fast as the CPU allows or at any multiple of real
+//       time.
+//
+//       Clocks count nanoseconds. runLoop() hands the application whole microseconds per
+//       frame and carries the rest over to the next frame, the unit a replay records, so a
+//       loop on a virtual clock steps with exactly the floats a recording replays.
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __platformH__
+#define __platformH__
+
+#include <atomic>
+#include <deque>
+#include <string>
+
+namespace platform
+{
+	// key codes of EVENT_KEY_DOWN: the Win32 virtual keys, letters and digits are their
+	// upper case characters
+	enum { KEY_RETURN = 0x0d, KEY_ESCAPE = 0x1b, KEY_SPACE = 0x20 };
+
+	enum { BUTTON_LEFT = 1, BUTTON_RIGHT = 2 };
+
+	enum EventType { EVENT_QUIT, EVENT_KEY_DOWN, EVENT_MOUSE_MOVE };
+
+	struct Event
+	{
+		EventType           type;
+		int                 key;      // EVENT_KEY_DOWN; the exit code of EVENT_QUIT
+		int                 x, y;     // EVENT_MOUSE_MOVE, client pixels
+		unsigned int        buttons;  // EVENT_MOUSE_MOVE, BUTTON_ flags held down
+	};
+
+	//
+	// Clocks
+	//
+
+	class IClock {
+	public:
+		virtual ~IClock(void) {}
+
+		virtual unsigned long long now(void) = 0;  // nanoseconds, never goes back
+		virtual void sleepUntil(unsigned long long nanos) = 0;
+	};
+
+	// std::chrono::steady_clock
+	class CSteadyClock : public IClock {
+	public:
+		unsigned long long now(void);
+		void sleepUntil(unsigned long long nanos);
+	};
+	IClock& getSteadyClock(void);
+
+	// Time that moves warp times as fast as the steady clock. With a warp of 0 it only moves
+	// when a thread sleeps on it, straight to the time it waits for, so a loop that sleeps
+	// until its next frame runs as fast as the CPU allows. now() and sleepUntil() may be
+	// called from any thread.
+	class CVirtualClock : public IClock {
+	public:
+		explicit CVirtualClock(double warp = 0);
+
+		// the clock keeps its time, from now on it runs at the new rate; not while other
+		// threads use the clock
+		void setWarp(double warp);
+		double getWarp(void) const { return m_warp; }
+		void advance(unsigned long long nanos);
+
+		unsigned long long now(void);
+		void sleepUntil(unsigned long long nanos);
+
+	private:
+		double              m_warp;
+		unsigned long long  m_base;       // virtual time when the rate was set
+		unsigned long long  m_realStart;  // steady clock when the rate was set
+		std::atomic<unsigned long long>  m_skipped;  // time advanced by hand since then
+	};
+
+	//
+	// Platforms
+	//
+
+	class IPlatform {
+	public:
+		virtual ~IPlatform(void) {}
+
+		// one window of width x height client pixels; false when it could not be made
+		virtual bool createWindow(const char* title, int width, int height) = 0;
+		virtual void* getNativeWindow(void) = 0;  // HWND, NULL without a window
+		virtual void setTitle(const char* title) = 0;
+		// closes the window, runLoop() gets EVENT_QUIT once the pending events are read
+		virtual void close(void) = 0;
+
+		// the next pending event, false when there is none
+		virtual bool pollEvent(Event& e) = 0;
+		virtual IClock& getClock(void) = 0;
+	};
+
+	class CHeadlessPlatform : public IPlatform {
+	public:
+		explicit CHeadlessPlatform(double warp = 0);
+
+		bool createWindow(const char* title, int width, int height);
+		void* getNativeWindow(void) { return NULL; }
+		void setTitle(const char* title) { m_title = title; }
+		void close(void);
+
+		// input of a script or a bot, read by the next pollEvent() calls in order
+		void pushEvent(const Event& e) { m_events.push_back(e); }
+		bool pollEvent(Event& e);
+		IClock& getClock(void) { return m_clock; }
+		CVirtualClock& getVirtualClock(void) { return m_clock; }
+
+		const std::string& getTitle(void) const { return m_title; }
+		int getWidth(void) const { return m_width; }
+		int getHeight(void) const { return m_height; }
+
+	private:
+		CVirtualClock       m_clock;
+		std::deque<Event>   m_events;
+		std::string         m_title;
+		int                 m_width, m_height;
+	};
+
+	//
+	// Frame loop
+	//
+
+	class IApplication {
+	public:
+		virtual ~IApplication(void) {}
+
+		virtual void onEvent(const Event& e) = 0;
+		// micros: whole microseconds since the last frame; false ends the loop
+		virtual bool frame(unsigned int micros) = 0;
+	};
+
+	// Reads every pending event, then runs one frame, until EVENT_QUIT or a frame returns
+	// false. frameMicros > 0 sleeps on the platform clock until that much time has passed
+	// since the last frame, 0 runs the next frame right away. Returns the exit code of
+	// EVENT_QUIT, 0 when a frame ended the loop.
+	int runLoop(IPlatform& platform, IApplication& app, unsigned int frameMicros = 0);
+}
+
+#endif // __platformH__
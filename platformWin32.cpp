@@ -0,0 +1,163 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// File: platformWin32.cpp
+//
+// Desc: Win32 window, message pump and performance counter clock.
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "platformWin32.h"
+
+static const char WINDOW_CLASS[] = "Direct3D9App";
+
+//
+// CWin32Clock
+//
+
+platform::CWin32Clock::CWin32Clock(void)
+{
+	LARGE_INTEGER frequency;
+	::QueryPerformanceFrequency(&frequency);
+	m_frequency = (unsigned long long)frequency.QuadPart;
+}
+
+// whole seconds and the rest apart, so the counter times 1e9 does not overflow
+unsigned long long platform::CWin32Clock::now(void)
+{
+	LARGE_INTEGER counter;
+	::QueryPerformanceCounter(&counter);
+	unsigned long long c = (unsigned long long)counter.QuadPart;
+	return c / m_frequency * 1000000000ULL + c % m_frequency * 1000000000ULL / m_frequency;
+}
+
+void platform::CWin32Clock::sleepUntil(unsigned long long nanos)
+{
+	const unsigned long long TICK = 2000000;  // Sleep() may oversleep by a scheduler tick
+	for (unsigned long long t = now(); t < nanos; t = now())
+		::Sleep(nanos - t > TICK ? (DWORD)((nanos - t - TICK) / 1000000) + 1 : 0);
+}
+
+//
+// CWin32Platform
+//
+
+platform::CWin32Platform::CWin32Platform(void)
+{
+	m_hwnd = 0;
+}
+
+platform::CWin32Platform::~CWin32Platform(void)
+{
+	if (m_hwnd)
+		::DestroyWindow(m_hwnd);
+}
+
+bool platform::CWin32Platform::createWindow(const char* title, int width, int height)
+{
+	HINSTANCE hInstance = ::GetModuleHandle(0);
+
+	WNDCLASS wc;
+	wc.style         = CS_HREDRAW | CS_VREDRAW;
+	wc.lpfnWndProc   = windowProc;
+	wc.cbClsExtra    = 0;
+	wc.cbWndExtra    = 0;
+	wc.hInstance     = hInstance;
+	wc.hIcon         = LoadIcon(0, IDI_APPLICATION);
+	wc.hCursor       = LoadCursor(0, IDC_ARROW);
+	wc.hbrBackground = (HBRUSH)GetStockObject(WHITE_BRUSH);
+	wc.lpszMenuName  = 0;
+	wc.lpszClassName = WINDOW_CLASS;
+
+	if (!::RegisterClass(&wc))
+	{
+		::MessageBox(0, "RegisterClass() - FAILED", 0, 0);
+		return false;
+	}
+
+	// windowProc finds the platform through the creation parameter
+	m_hwnd = ::CreateWindow(WINDOW_CLASS, title, WS_EX_TOPMOST, 0, 0, width, height,
+		0 /*parent hwnd*/, 0 /* menu */, hInstance, this /*extra*/);
+	if (!m_hwnd)
+	{
+		::MessageBox(0, "CreateWindow() - FAILED", 0, 0);
+		return false;
+	}
+
+	::ShowWindow(m_hwnd, SW_SHOW);
+	::UpdateWindow(m_hwnd);
+	return true;
+}
+
+void platform::CWin32Platform::setTitle(const char* title)
+{
+	if (m_hwnd)
+		::SetWindowText(m_hwnd, title);
+}
+
+void platform::CWin32Platform::close(void)
+{
+	if (m_hwnd)
+		::DestroyWindow(m_hwnd);
+}
+
+// dispatches messages until windowProc has made an event of one, or the queue is empty
+bool platform::CWin32Platform::pollEvent(Event& e)
+{
+	MSG msg;
+	while (m_events.empty() && ::PeekMessage(&msg, 0, 0, 0, PM_REMOVE))
+	{
+		if (msg.message == WM_QUIT)
+		{
+			Event quit = { EVENT_QUIT, (int)msg.wParam, 0, 0, 0 };
+			m_events.push_back(quit);
+			break;
+		}
+		::TranslateMessage(&msg);
+		::DispatchMessage(&msg);
+	}
+
+	if (m_events.empty())
+		return false;
+	e = m_events.front();
+	m_events.pop_front();
+	return true;
+}
+
+LRESULT CALLBACK platform::CWin32Platform::windowProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
+{
+	if (msg == WM_NCCREATE)
+	{
+		CREATESTRUCT* create = (CREATESTRUCT*)lParam;
+		::SetWindowLongPtr(hwnd, GWLP_USERDATA, (LONG_PTR)create->lpCreateParams);
+	}
+	CWin32Platform* self = (CWin32Platform*)::GetWindowLongPtr(hwnd, GWLP_USERDATA);
+
+	switch (msg) {
+	case WM_DESTROY:
+		if (self != NULL)
+			self->m_hwnd = 0;
+		::PostQuitMessage(0);
+		break;
+
+	case WM_KEYDOWN:
+		if (self != NULL)
+		{
+			Event e = { EVENT_KEY_DOWN, (int)wParam, 0, 0, 0 };
+			self->m_events.push_back(e);
+		}
+		break;
+
+	case WM_MOUSEMOVE:
+		if (self != NULL)
+		{
+			unsigned int buttons = 0;
+			if (LOWORD(wParam) & MK_LBUTTON) buttons |= BUTTON_LEFT;
+			if (LOWORD(wParam) & MK_RBUTTON) buttons |= BUTTON_RIGHT;
+			Event e = { EVENT_MOUSE_MOVE, 0, LOWORD(lParam), HIWORD(lParam), buttons };
+			self->m_events.push_back(e);
+		}
+		break;
+	}
+
+	return ::DefWindowProc(hwnd, msg, wParam, lParam);
+}
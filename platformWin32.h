@@ -0,0 +1,54 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// File: platformWin32.h
+//
+// Desc: The Win32 platform of the front end. createWindow() registers the window class and
+//       opens the window d3d::InitD3D creates its device for; the window procedure turns the
+//       messages of the window into platform events, and pollEvent() pumps the message queue
+//       when none are left. The clock is QueryPerformanceCounter.
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __platformWin32H__
+#define __platformWin32H__
+
+#include "platform.h"
+#include <windows.h>
+
+namespace platform
+{
+	class CWin32Clock : public IClock {
+	public:
+		CWin32Clock(void);
+
+		unsigned long long now(void);
+		// sleeps while more than a scheduler tick is left, then yields
+		void sleepUntil(unsigned long long nanos);
+
+	private:
+		unsigned long long  m_frequency;  // counts per second
+	};
+
+	class CWin32Platform : public IPlatform {
+	public:
+		CWin32Platform(void);
+		~CWin32Platform(void);
+
+		bool createWindow(const char* title, int width, int height);
+		void* getNativeWindow(void) { return m_hwnd; }
+		void setTitle(const char* title);
+		void close(void);
+
+		bool pollEvent(Event& e);
+		IClock& getClock(void) { return m_clock; }
+
+	private:
+		static LRESULT CALLBACK windowProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam);
+
+		HWND                m_hwnd;
+		CWin32Clock         m_clock;
+		std::deque<Event>   m_events;  // translated by windowProc, not read yet
+	};
+}
+
+#endif // __platformWin32H__
@@ -0,0 +1,189 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// File: poissonDisk.cpp
+//
+// Desc: Poisson-disk point sets (dart throwing with a Bridson fallback).
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "poissonDisk.h"
+#include <algorithm>
+#include <cmath>
+
+// coordinates of an empty grid cell, far enough that its distance never counts
+static const float EMPTY = 1e15f;
+
+sim::CPoissonDisk::CPoissonDisk(void)
+{
+	m_xMin = m_zMin = m_xMax = m_zMax = 0;
+	m_minDist = 0;
+	m_stepCos = 1;
+	m_stepSin = 0;
+	m_invCell = 0;
+	m_cols = m_rows = 0;
+	m_accept = NULL;
+	m_acceptContext = NULL;
+}
+
+void sim::CPoissonDisk::reset(float xMin, float zMin, float xMax, float zMax, float minDist, const CRandom& random)
+{
+	m_random = random;
+	m_accept = NULL;
+	m_acceptContext = NULL;
+
+	m_xMin = xMin;
+	m_zMin = zMin;
+	m_xMax = xMax;
+	m_zMax = zMax;
+	m_minDist = minDist;
+	m_stepCos = std::cos(6.28318531f / POISSON_ATTEMPTS);
+	m_stepSin = std::sin(6.28318531f / POISSON_ATTEMPTS);
+
+	float cell = minDist / std::sqrt(2.0f);  // a cell can not hold two points
+	m_invCell = 1 / cell;
+	m_cols = std::max(1, (int)std::ceil((xMax - xMin) * m_invCell));
+	m_rows = std::max(1, (int)std::ceil((zMax - zMin) * m_invCell));
+
+	// two empty cells of border on every side, so the 5 x 5 block never needs clamping
+	int cells = (m_cols + 4) * (m_rows + 4);
+	m_cellX.assign(cells, EMPTY);
+	m_cellZ.assign(cells, EMPTY);
+	m_x.clear();
+	m_z.clear();
+	m_active.clear();
+}
+
+bool sim::CPoissonDisk::draw(float xMin, float zMin, float xMax, float zMax, float minDist, int count, const CRandom& random,
+	Accept accept, const void* context)
+{
+	reset(xMin, zMin, xMax, zMax, minDist, random);
+	m_accept = accept;
+	m_acceptContext = context;
+
+	int misses = 0;
+	while (size() < count && misses < DART_MISSES)
+	{
+		float x = m_random.uniform(xMin, xMax);
+		float z = m_random.uniform(zMin, zMax);
+		if (isFree(x, z) && isAccepted(x, z))
+		{
+			add(x, z);
+			misses = 0;
+		}
+		else
+		{
+			misses++;
+		}
+	}
+
+	// the area is getting full: complete the darts to a maximal set and pick from it
+	bool placed = size() >= count;
+	if (!placed)
+	{
+		fill();
+		placed = pick(count);
+	}
+	m_accept = NULL;  // the test does not outlive the call
+	m_acceptContext = NULL;
+	return placed;
+}
+
+int sim::CPoissonDisk::generate(float xMin, float zMin, float xMax, float zMax, float minDist, const CRandom& random)
+{
+	reset(xMin, zMin, xMax, zMax, minDist, random);
+	float x = m_random.uniform(xMin, xMax);
+	float z = m_random.uniform(zMin, zMax);
+	add(x, z);
+	fill();
+	return size();
+}
+
+void sim::CPoissonDisk::fill(void)
+{
+	while (!m_active.empty())
+	{
+		int a = (int)m_random.below((unsigned int)m_active.size());
+		float px = m_x[m_active[a]], pz = m_z[m_active[a]];
+
+		// candidates just outside minDist, evenly spaced around the active point from a random
+		// start angle (a tighter packing for fewer attempts than a random annulus)
+		float angle = m_random.uniform(0, 6.28318531f);
+		float radius = m_minDist * 1.0001f;
+		float dx = radius * std::cos(angle), dz = radius * std::sin(angle);
+		bool placed = false;
+		for (int k = 0; k < POISSON_ATTEMPTS && !placed; k++)
+		{
+			float x = px + dx;
+			float z = pz + dz;
+			float rx = dx * m_stepCos - dz * m_stepSin;
+			dz = dx * m_stepSin + dz * m_stepCos;
+			dx = rx;
+			if (x < m_xMin || x > m_xMax || z < m_zMin || z > m_zMax || !isFree(x, z) || !isAccepted(x, z))
+				continue;
+			add(x, z);
+			placed = true;
+		}
+
+		if (!placed)
+		{
+			m_active[a] = m_active.back();
+			m_active.pop_back();
+		}
+	}
+}
+
+int sim::CPoissonDisk::cellOf(float x, float z) const
+{
+	int c = std::min((int)((x - m_xMin) * m_invCell), m_cols - 1);
+	int r = std::min((int)((z - m_zMin) * m_invCell), m_rows - 1);
+	return (r + 2) * (m_cols + 4) + c + 2;
+}
+
+bool sim::CPoissonDisk::isFree(float x, float z) const
+{
+	int cell = cellOf(x, z);
+	if (m_cellX[cell] != EMPTY)
+		return false;  // the cell is narrower than minDist
+
+	// empty cells hold a point far away, so the block is tested without branches
+	const float* cx = m_cellX.data() + cell - 2 * (m_cols + 4) - 2;
+	const float* cz = m_cellZ.data() + cell - 2 * (m_cols + 4) - 2;
+	float d2 = m_minDist * m_minDist;
+	bool hit = false;
+	for (int j = 0; j < 5; j++, cx += m_cols + 4, cz += m_cols + 4)
+	{
+		for (int i = 0; i < 5; i++)
+		{
+			float dx = cx[i] - x;
+			float dz = cz[i] - z;
+			hit |= dx * dx + dz * dz < d2;
+		}
+	}
+	return !hit;
+}
+
+void sim::CPoissonDisk::add(float x, float z)
+{
+	int cell = cellOf(x, z);
+	m_cellX[cell] = x;
+	m_cellZ[cell] = z;
+	m_active.push_back(size());
+	m_x.push_back(x);
+	m_z.push_back(z);
+}
+
+// partial Fisher-Yates shuffle; the grid is not used afterwards, so it is not updated
+bool sim::CPoissonDisk::pick(int count)
+{
+	int n = size();
+	if (count > n)
+		return false;
+
+	for (int i = 0; i < count; i++)
+	{
+		int j = i + (int)m_random.below((unsigned int)(n - i));
+		std::swap(m_x[i], m_x[j]);
+		std::swap(m_z[i], m_z[j]);
+	}
+	return true;
+}
@@ -0,0 +1,97 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// File: poissonDisk.h
+//
+// Desc: Poisson-disk point sets over a rectangle (no two points closer than minDist), backed by
+//       a background grid with cells of minDist / sqrt(2). A cell holds at most one point, so
+//       testing a candidate looks at a fixed 5 x 5 block of cells whatever the number of
+//       points already placed.
+//
+//       sample() throws random darts while they land, which is O(count) for the sparse
+//       layouts of the game, and switches to Bridson's algorithm once the darts keep missing:
+//       Bridson grows the darts into a maximal set (no room left for another point) in time
+//       linear in its size, and the points are then picked from that set. A request for more
+//       points than the maximal set holds fails, the same way for the same seed, instead of
+//       retrying forever.
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __poissonDiskH__
+#define __poissonDiskH__
+
+#include "simRandom.h"
+#include <cstddef>
+#include <vector>
+
+namespace sim
+{
+	const int POISSON_ATTEMPTS = 12;  // Bridson candidates tried around a point before it is retired
+	const int DART_MISSES = 32;       // darts missing in a row before switching to Bridson
+
+	class CPoissonDisk {
+	public:
+		CPoissonDisk(void);
+
+		// places count points, the first count of getX/getZ; false when the area can not hold
+		// them. The points are drawn from a copy of random, so the same stream always gives
+		// the same points.
+		bool sample(float xMin, float zMin, float xMax, float zMax, float minDist, int count, const CRandom& random)
+		{
+			return draw(xMin, zMin, xMax, zMax, minDist, count, random, NULL, NULL);
+		}
+
+		// the same with points only where accept(x, z) is true, for a rectangle with places no
+		// point may take (the pieces of a table); a refused dart counts as a miss
+		template <class F> bool sample(float xMin, float zMin, float xMax, float zMax, float minDist, int count,
+			const CRandom& random, const F& accept)
+		{
+			return draw(xMin, zMin, xMax, zMax, minDist, count, random, &invoke<F>, &accept);
+		}
+
+		// moves count points picked at random to the front, false when there are fewer; after
+		// a failed sample() the set is maximal, so this picks a smaller layout from it
+		bool pick(int count);
+
+		// maximal set over the whole area (Bridson only), returns its size
+		int generate(float xMin, float zMin, float xMax, float zMax, float minDist, const CRandom& random);
+
+		int size(void) const { return (int)m_x.size(); }
+		float getX(int i) const { return m_x[i]; }
+		float getZ(int i) const { return m_z[i]; }
+
+	private:
+		typedef bool (*Accept)(const void* context, float x, float z);
+
+		template <class F> static bool invoke(const void* context, float x, float z)
+		{
+			return (*static_cast<const F*>(context))(x, z);
+		}
+
+		bool draw(float xMin, float zMin, float xMax, float zMax, float minDist, int count, const CRandom& random,
+			Accept accept, const void* context);
+		bool isAccepted(float x, float z) const { return m_accept == NULL || m_accept(m_acceptContext, x, z); }
+
+		void reset(float xMin, float zMin, float xMax, float zMax, float minDist, const CRandom& random);
+		void fill(void);  // Bridson from the current points
+
+		int cellOf(float x, float z) const;
+		bool isFree(float x, float z) const;
+		void add(float x, float z);
+
+		CRandom             m_random;
+		Accept              m_accept;  // NULL: every point of the rectangle
+		const void*         m_acceptContext;
+
+		float               m_xMin, m_zMin, m_xMax, m_zMax;
+		float               m_minDist;
+		float               m_stepCos, m_stepSin;  // rotation between two Bridson candidates
+		float               m_invCell;
+		int                 m_cols, m_rows;
+
+		std::vector<float>  m_x, m_z;   // points
+		std::vector<float>  m_cellX, m_cellZ;  // point in every grid cell
+		std::vector<int>    m_active;   // points that may still have room around them
+	};
+}
+
+#endif // __poissonDiskH__
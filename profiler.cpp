@@ -0,0 +1,251 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// File: profiler.cpp
+//
+// Desc: Per-thread zone rings, the Chrome trace writer and the frame time histogram.
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+std::atomic<bool> prof::g_enabled(false);
+
+// the events of one thread; only the owner writes events and head
+struct ThreadRing
+{
+	prof::Event                     events[prof::RING_EVENTS];
+	std::atomic<unsigned long long> head;     // events written since the thread started
+	std::atomic<unsigned long long> cleared;  // head at the last clear(), set by the reader
+	int                             tid;
+	char                            name[32];
+};
+
+// rings are never freed, a thread may end before the trace is written
+static std::mutex s_ringMutex;
+static std::vector<ThreadRing*> s_rings;
+static thread_local ThreadRing* t_ring = NULL;
+static thread_local char t_name[32];  // for the ring, made on the first recorded zone
+
+static ThreadRing* getRing(void)
+{
+	if (t_ring != NULL)
+		return t_ring;
+
+	ThreadRing* ring = new ThreadRing;
+	ring->head.store(0, std::memory_order_relaxed);
+	ring->cleared.store(0, std::memory_order_relaxed);
+	std::lock_guard<std::mutex> lock(s_ringMutex);
+	ring->tid = (int)s_rings.size() + 1;
+	if (t_name[0] != '\0')
+		memcpy(ring->name, t_name, sizeof(ring->name));
+	else
+		snprintf(ring->name, sizeof(ring->name), "thread %d", ring->tid);
+	s_rings.push_back(ring);
+	t_ring = ring;
+	return ring;
+}
+
+unsigned long long prof::steadyNanos(void)
+{
+	return (unsigned long long)std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static const unsigned long long s_startTicks = prof::now();
+static const unsigned long long s_startNanos = prof::steadyNanos();
+
+// the counter against the steady clock since the program started, at least 20 ms apart
+double prof::getTicksPerSecond(void)
+{
+#ifdef PROF_RDTSC
+	const unsigned long long MIN_NANOS = 20000000;
+	unsigned long long nanos = steadyNanos() - s_startNanos;
+	if (nanos < MIN_NANOS)
+		std::this_thread::sleep_for(std::chrono::nanoseconds(MIN_NANOS - nanos));
+	unsigned long long ticks = now() - s_startTicks;
+	nanos = steadyNanos() - s_startNanos;
+	return ticks * 1e9 / nanos;
+#else
+	return 1e9;
+#endif
+}
+
+long long prof::ticksToNanos(unsigned long long ticks)
+{
+	static const double nanosPerTick = 1e9 / getTicksPerSecond();
+	return (long long)(ticks * nanosPerTick);
+}
+
+void prof::setEnabled(bool enabled)
+{
+	g_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void prof::setThreadName(const char* name)
+{
+	snprintf(t_name, sizeof(t_name), "%s", name);
+	if (t_ring != NULL)
+	{
+		std::lock_guard<std::mutex> lock(s_ringMutex);
+		memcpy(t_ring->name, t_name, sizeof(t_name));
+	}
+}
+
+void prof::record(const char* name, unsigned long long begin, unsigned long long end)
+{
+	ThreadRing* ring = getRing();
+	unsigned long long head = ring->head.load(std::memory_order_relaxed);
+	Event& e = ring->events[head & (RING_EVENTS - 1)];
+	e.name = name;
+	e.begin = begin;
+	e.end = end;
+	ring->head.store(head + 1, std::memory_order_release);
+}
+
+void prof::clear(void)
+{
+	std::lock_guard<std::mutex> lock(s_ringMutex);
+	for (size_t i = 0; i < s_rings.size(); i++)
+		s_rings[i]->cleared.store(s_rings[i]->head.load(std::memory_order_acquire), std::memory_order_relaxed);
+}
+
+// the events a ring still holds; the owner may overwrite the oldest ones while they are copied,
+// so the head is read again afterwards and those are dropped
+static void copyRing(ThreadRing& ring, std::vector<prof::Event>& out)
+{
+	out.clear();
+	unsigned long long head = ring.head.load(std::memory_order_acquire);
+	unsigned long long first = std::max(ring.cleared.load(std::memory_order_relaxed),
+		head > (unsigned long long)prof::RING_EVENTS ? head - prof::RING_EVENTS : 0);
+	for (unsigned long long i = first; i < head; i++)
+		out.push_back(ring.events[i & (prof::RING_EVENTS - 1)]);
+
+	unsigned long long after = ring.head.load(std::memory_order_acquire);
+	if (after > (unsigned long long)prof::RING_EVENTS && after - prof::RING_EVENTS > first)
+	{
+		size_t lost = (size_t)std::min<unsigned long long>(after - prof::RING_EVENTS - first, out.size());
+		out.erase(out.begin(), out.begin() + lost);
+	}
+}
+
+long long prof::writeChromeTrace(const char* path)
+{
+	FILE* file = fopen(path, "w");
+	if (file == NULL)
+		return -1;
+
+	std::lock_guard<std::mutex> lock(s_ringMutex);
+	std::vector<std::vector<Event> > events(s_rings.size());
+	unsigned long long base = ~0ULL;
+	for (size_t i = 0; i < s_rings.size(); i++)
+	{
+		copyRing(*s_rings[i], events[i]);
+		for (size_t j = 0; j < events[i].size(); j++)
+			base = std::min(base, events[i][j].begin);
+	}
+	const double usPerTick = 1e6 / getTicksPerSecond();
+
+	long long written = 0;
+	fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	for (size_t i = 0; i < s_rings.size(); i++)
+	{
+		const ThreadRing& ring = *s_rings[i];
+		fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+			i == 0 ? "" : ",\n", ring.tid, ring.name);
+		for (size_t j = 0; j < events[i].size(); j++)
+		{
+			const Event& e = events[i][j];
+			fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}", e.name,
+				ring.tid, (e.begin - base) * usPerTick, (e.end - e.begin) * usPerTick);
+			written++;
+		}
+	}
+	fprintf(file, "\n]}\n");
+	bool ok = ferror(file) == 0;
+	fclose(file);
+	return ok ? written : -1;
+}
+
+//
+// CFrameHistogram
+//
+
+// a value below 2 * SUB_BUCKETS has a bucket of its own; above, the buckets of [2^e, 2^(e+1))
+// split it into SUB_BUCKETS equal parts
+int prof::CFrameHistogram::bucketOf(long long nanos)
+{
+	unsigned long long v = (unsigned long long)std::max(nanos, 0LL);
+	v = std::min(v, (1ULL << MAX_EXPONENT) - 1);
+	if (v < 2 * SUB_BUCKETS)
+		return (int)v;
+	int msb = 0;
+	while ((v >> (msb + 1)) != 0)
+		msb++;
+	int shift = msb - SUB_BITS;
+	return SUB_BUCKETS * (shift + 1) + (int)(v >> shift) - SUB_BUCKETS;
+}
+
+long long prof::CFrameHistogram::upperBound(int bucket)
+{
+	if (bucket < 2 * SUB_BUCKETS)
+		return bucket;
+	int shift = bucket / SUB_BUCKETS - 1;
+	long long sub = bucket % SUB_BUCKETS + SUB_BUCKETS;
+	return ((sub + 1) << shift) - 1;
+}
+
+prof::CFrameHistogram::CFrameHistogram(int window)
+{
+	m_window.resize(std::max(window, 1));
+	reset();
+}
+
+void prof::CFrameHistogram::reset(void)
+{
+	m_buckets.assign(SUB_BUCKETS * (MAX_EXPONENT - SUB_BITS + 1), 0);
+	m_next = 0;
+	m_count = 0;
+}
+
+void prof::CFrameHistogram::add(long long nanos)
+{
+	if (m_count == (int)m_window.size())
+		m_buckets[bucketOf(m_window[m_next])]--;  // falls out of the window
+	else
+		m_count++;
+	m_window[m_next] = nanos;
+	m_buckets[bucketOf(nanos)]++;
+	m_next = (m_next + 1) % (int)m_window.size();
+}
+
+long long prof::CFrameHistogram::getPercentile(double p) const
+{
+	if (m_count == 0)
+		return 0;
+	long long rank = std::max(1LL, (long long)std::ceil(p / 100 * m_count));
+	long long seen = 0;
+	for (size_t b = 0; b < m_buckets.size(); b++)
+	{
+		seen += m_buckets[b];
+		if (seen >= rank)
+			return upperBound((int)b);
+	}
+	return getMax();
+}
+
+long long prof::CFrameHistogram::getMax(void) const
+{
+	for (size_t b = m_buckets.size(); b-- > 0;)
+	{
+		if (m_buckets[b] != 0)
+			return upperBound((int)b);
+	}
+	return 0;
+}
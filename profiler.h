@@ -0,0 +1,134 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// File: profiler.h
+//
+// Desc: Scoped zone tracing and frame time histograms.
+//
+//       PROF_ZONE("name") at the top of a block records the time the block took, with the name
+//       (a string literal) and the thread it ran on. A zone writes into a ring buffer of its own
+//       thread, so recording takes no lock and no atomic read-modify-write: two reads of the
+//       time stamp counter, one event store and a release store of the ring head. Each ring
+//       keeps the last RING_EVENTS events; writeChromeTrace() copies what the rings hold into
+//       the Trace Event format of chrome://tracing and Perfetto.
+//
+//       Zones are recorded after setEnabled(true); until then a zone costs one relaxed load.
+//       Built with LEGO_PROFILE=0 (cmake -DLEGO_PROFILE=OFF) PROF_ZONE expands to nothing.
+//
+//       CFrameHistogram keeps the durations of the last frames in log-linear buckets (about
+//       3% wide, as an HDR histogram) and answers percentile queries at any time.
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __profilerH__
+#define __profilerH__
+
+#include <atomic>
+#include <vector>
+
+#ifndef LEGO_PROFILE
+#define LEGO_PROFILE 1
+#endif
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define PROF_RDTSC 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define PROF_RDTSC 1
+#endif
+
+namespace prof
+{
+	const int RING_EVENTS = 1 << 16;  // per thread, a power of two
+
+	struct Event
+	{
+		const char*         name;
+		unsigned long long  begin, end;  // ticks of now()
+	};
+
+	unsigned long long steadyNanos(void);
+
+	// the time stamp counter where there is one, nanoseconds of the steady clock elsewhere
+	inline unsigned long long now(void)
+	{
+#ifdef PROF_RDTSC
+		return __rdtsc();
+#else
+		return steadyNanos();
+#endif
+	}
+	double getTicksPerSecond(void);  // against the steady clock, waits until 20 ms after start up
+	long long ticksToNanos(unsigned long long ticks);  // at the rate of the first call
+
+	void setEnabled(bool enabled);
+	extern std::atomic<bool> g_enabled;
+	inline bool isEnabled(void) { return g_enabled.load(std::memory_order_relaxed); }
+
+	// names the ring of the calling thread in the trace
+	void setThreadName(const char* name);
+	void record(const char* name, unsigned long long begin, unsigned long long end);
+
+	// the events of every ring, oldest first per thread; events a thread overwrote while they
+	// were copied are left out. Returns the number of events written, -1 when the file could
+	// not be opened.
+	long long writeChromeTrace(const char* path);
+	void clear(void);  // drops the recorded events of every thread
+
+	class CZone {
+	public:
+		explicit CZone(const char* name) : m_begin(0)
+		{
+			m_name = isEnabled() ? name : 0;
+			if (m_name != 0)
+				m_begin = now();
+		}
+		~CZone(void)
+		{
+			if (m_name != 0)
+				record(m_name, m_begin, now());
+		}
+
+	private:
+		CZone(const CZone&);
+		CZone& operator=(const CZone&);
+
+		const char*         m_name;  // 0: not recorded
+		unsigned long long  m_begin;
+	};
+
+	// durations of the last window frames; one thread adds and queries
+	class CFrameHistogram {
+	public:
+		enum { SUB_BITS = 5, SUB_BUCKETS = 1 << SUB_BITS, MAX_EXPONENT = 40 };
+
+		explicit CFrameHistogram(int window = 1024);
+
+		void add(long long nanos);
+		void reset(void);
+
+		int getCount(void) const { return m_count; }
+		// the upper bound of the bucket that holds the p-th percentile (0 < p <= 100), 0 when empty
+		long long getPercentile(double p) const;
+		long long getMax(void) const;
+
+	private:
+		static int bucketOf(long long nanos);
+		static long long upperBound(int bucket);
+
+		std::vector<int>        m_buckets;
+		std::vector<long long>  m_window;  // ring of the samples in the histogram
+		int                     m_next;
+		int                     m_count;
+	};
+}
+
+#define PROF_CONCAT2(a, b) a##b
+#define PROF_CONCAT(a, b) PROF_CONCAT2(a, b)
+#if LEGO_PROFILE
+#define PROF_ZONE(name) prof::CZone PROF_CONCAT(profZone, __LINE__)(name)
+#else
+#define PROF_ZONE(name) ((void)0)
+#endif
+
+#endif // __profilerH__
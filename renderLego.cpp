@@ -0,0 +1,284 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// File: renderLego.cpp
+//
+// Desc: Headless render driver. Plays games with a paddle that chases the red ball, records
+//       every frame through CTableScene into a CRenderList and submits it to the recording
+//       backend, then reports the device calls of the sorted, batched submission against the
+//       per-object draw paths it replaced.
+//
+//       usage: renderLego [-games N] [-balls B] [-seed S] [-frames F] [-turn R] [-zoom Z]
+//                         [-nocull] [-raster] [-size WxH] [-threads T] [-every N] [-ppm PREFIX]
+//                         [-trace FILE] [-v]
+//
+//       The scene culls against the camera of Setup() and picks the levels of detail of the
+//       balls for a viewport of -size, unless -nocull. -turn R turns the table by R radians per
+//       frame, as dragging with the right button does, and -zoom Z moves the eye Z times
+//       closer to the table, so parts of it leave the screen.
+//       -raster: every N-th frame (-every, 50 by default) is also drawn by the software
+//       rasterizer on T threads (0: one per core), and its frame rate is reported.
+//       -ppm PREFIX: saves those frames as PREFIXg_f.ppm.
+//       -trace FILE: records the profiler zones and writes the last of them to FILE as a Chrome
+//       trace; prints the p50 / p99 / p99.9 time of record to HUD over the last TRACE_FRAMES
+//       frames.
+//
+//       Every frame is checked (render::checkSubmission, which testLego runs under ctest):
+//       each mesh and material pair is drawn by exactly one batch, every command is drawn
+//       once, the HUD goes out in one drawText call, and the submission takes fewer device
+//       calls than the per-object draws. Without GDI the HUD is laid out in a fixed pitch atlas
+//       of the height of the front end font. The scene takes its meshes from the cache again
+//       for every game, as the front end would on a new level, and the cache has to stay the
+//       same size. The exit code is the number of frames and games that failed a check.
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "hudText.h"
+#include "profiler.h"
+#include "renderList.h"
+#include "simCore.h"
+#include "simThread.h"
+#include "softRaster.h"
+#include "tableScene.h"
+#include "workPool.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+const float FRAME_DT = 16 * sim::GAME_TIME_PER_MS;
+const int TRACE_FRAMES = 1 << 16;  // frame times in the -trace histogram
+
+// the right button drag of WndProc: a turn about y, then a tilt about x
+static void orbit(render::Matrix& world, float angle)
+{
+	float tilt = 1.2f * std::sin(angle / 3);
+	float cy = std::cos(angle), sy = std::sin(angle), cx = std::cos(tilt), sx = std::sin(tilt);
+	render::Matrix y = { { { cy, 0, -sy, 0 }, { 0, 1, 0, 0 }, { sy, 0, cy, 0 }, { 0, 0, 0, 1 } } };
+	render::Matrix x = { { { 1, 0, 0, 0 }, { 0, cx, sx, 0 }, { 0, -sx, cx, 0 }, { 0, 0, 0, 1 } } };
+	render::multiply(world, y, x);
+}
+
+// 24 pixel characters, 13 pixels apart
+static void buildHudAtlas(render::CGlyphAtlas& atlas)
+{
+	int advances[render::GLYPH_COUNT];
+	for (int i = 0; i < render::GLYPH_COUNT; i++)
+		advances[i] = 13;
+	atlas.build(16, 24, advances);
+}
+
+int main(int argc, char* argv[])
+{
+	int games = 20;
+	int balls = BALLNUM;
+	unsigned long long seed = 1;
+	long maxFrames = 20000;  // per game
+	float turn = 0, zoom = 1;
+	bool cull = true;
+	bool verbose = false;
+	bool raster = false;
+	int width = 1024, height = 768;  // the window of virtualLego
+	int threads = 0;
+	long every = 50;
+	const char* ppm = NULL;
+	const char* trace = NULL;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "-games") && i + 1 < argc) games = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-balls") && i + 1 < argc) balls = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-seed") && i + 1 < argc) seed = strtoull(argv[++i], 0, 10);
+		else if (!strcmp(argv[i], "-frames") && i + 1 < argc) maxFrames = atol(argv[++i]);
+		else if (!strcmp(argv[i], "-turn") && i + 1 < argc) turn = (float)atof(argv[++i]);
+		else if (!strcmp(argv[i], "-zoom") && i + 1 < argc) zoom = std::max(0.1f, (float)atof(argv[++i]));
+		else if (!strcmp(argv[i], "-nocull")) cull = false;
+		else if (!strcmp(argv[i], "-raster")) raster = true;
+		else if (!strcmp(argv[i], "-size") && i + 1 < argc && sscanf(argv[++i], "%dx%d", &width, &height) == 2) {}
+		else if (!strcmp(argv[i], "-threads") && i + 1 < argc) threads = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-every") && i + 1 < argc) every = std::max(1L, atol(argv[++i]));
+		else if (!strcmp(argv[i], "-ppm") && i + 1 < argc) ppm = argv[++i];
+		else if (!strcmp(argv[i], "-trace") && i + 1 < argc) trace = argv[++i];
+		else if (!strcmp(argv[i], "-v")) verbose = true;
+		else
+		{
+			printf("usage: renderLego [-games N] [-balls B] [-seed S] [-frames F] [-turn R] [-zoom Z]\n"
+				"                  [-nocull] [-raster] [-size WxH] [-threads T] [-every N] [-ppm PREFIX]\n"
+				"                  [-trace FILE] [-v]\n");
+			return 1;
+		}
+	}
+
+	render::CGlyphAtlas atlas;
+	render::CHudText hud;
+	buildHudAtlas(atlas);
+	hud.setAtlas(&atlas);
+	long long hudDraws = 0;
+
+	render::CMeshCache cache;
+	render::CTableScene scene;
+	render::CRenderList list;
+	render::CRecordingBackend backend;
+	render::Matrix world;
+	render::setIdentity(world);
+	scene.setup(list, cache);
+	render::Matrix view, proj;
+	render::CTableScene::getCamera((float)width / height, view, proj);
+	for (int i = 0; i < 3; i++)
+		view.m[3][i] /= zoom;  // the eye is on the line through the origin
+	if (cull)
+		scene.setView(view, proj, height);
+	const int meshes = cache.getMeshCount();
+	const size_t bytes = cache.getBytes();
+
+	sim::CWorkPool pool(threads);
+	render::CSoftBackend soft(width, height);
+	soft.setPool(pool.getWorkers() > 1 ? &pool : NULL);
+	soft.setMeshes(&cache);
+	soft.setCamera(view, proj);
+	soft.setLight(scene.getLight());
+	long long rasterFrames = 0;
+	double geometrySeconds = 0, rasterSeconds = 0;
+
+	sim::CRandom master(seed);
+	sim::Snapshot frame;
+	long long frames = 0, commands = 0, legacy = 0, failed = 0;
+	long long objects = 0, culled = 0, triangles = 0;
+	double seconds = 0;
+	prof::CFrameHistogram frameTimes(TRACE_FRAMES);
+	prof::setEnabled(trace != NULL);
+
+	for (int g = 0; g < games; g++)
+	{
+		sim::CGame game(balls);
+		if (!game.setup(master.at((unsigned long long)g)))
+			continue;
+		scene.setup(list, cache);
+		if (cache.getMeshCount() != meshes || cache.getBytes() != bytes)
+		{
+			if (failed++ < 10)
+				printf("game %d: %d meshes, %zu bytes in the cache\n", g, cache.getMeshCount(), cache.getBytes());
+		}
+
+		long f = 0;
+		for (; !game.isOver() && f < maxFrames; f++)
+		{
+			if (!game.isLaunched())
+				game.launch();
+			float dx = game.getRedBall().getCenter().x - game.getWhiteBall().getCenter().x;
+			game.movePaddle(std::min(std::max(dx, -0.05f), 0.05f));
+			game.step(FRAME_DT);
+			frame.capture(game, f, 0);
+
+			if (turn != 0)
+				orbit(world, turn * (frames + f));
+
+			// what Display() does between BeginScene and the HUD
+			std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+			unsigned long long ticks = prof::now();
+			backend.beginFrame();
+			list.clear();
+			render::SceneStats drawn;
+			{
+				PROF_ZONE("record");
+				drawn = scene.record(frame, world, list);
+			}
+			{
+				PROF_ZONE("sort");
+				list.sort();
+			}
+			{
+				PROF_ZONE("submit");
+				render::submit(list, backend);
+			}
+			{
+				PROF_ZONE("hud");
+				render::HudState state = { frame.life, frame.destroyNum, frame.level, frame.win, frame.defeated,
+					drawn.objects, drawn.objects - drawn.culled, drawn.triangles };
+				hud.update(state);
+				hud.submit(backend);
+			}
+			if (trace != NULL)
+				frameTimes.add(prof::ticksToNanos(prof::now() - ticks));
+			seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+			int legacyCalls = render::CTableScene::countLegacyCalls(frame);
+			hudDraws += 4 + (frame.win || frame.defeated ? 1 : 0);
+			if (!render::checkSubmission(list, backend, legacyCalls))
+			{
+				if (failed++ < 10)
+					printf("game %d frame %ld: bad submission\n", g, f);
+			}
+			commands += list.getCommandCount();
+			legacy += legacyCalls;
+			objects += drawn.objects;
+			culled += drawn.culled;
+			triangles += drawn.triangles;
+
+			if (raster && f % every == 0)
+			{
+				PROF_ZONE("raster");
+				std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+				soft.beginFrame();
+				render::submit(list, soft);
+				std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
+				soft.endFrame();
+				std::chrono::steady_clock::time_point t3 = std::chrono::steady_clock::now();
+				geometrySeconds += std::chrono::duration<double>(t2 - t1).count();
+				rasterSeconds += std::chrono::duration<double>(t3 - t2).count();
+				rasterFrames++;
+
+				if (ppm != NULL)
+				{
+					char path[512];
+					snprintf(path, sizeof(path), "%s%d_%ld.ppm", ppm, g, f);
+					if (!soft.writePPM(path))
+						printf("could not write %s\n", path);
+				}
+			}
+		}
+		frames += f;
+
+		if (verbose)
+			printf("game %d: level %d frames %ld, last frame %d commands in %d batches\n", g, game.getLevel(), f,
+				list.getCommandCount(), list.getBatchCount());
+	}
+
+	const render::RenderStats& s = backend.getStats();
+	double n = frames > 0 ? (double)frames : 1.0;
+	printf("frames %lld  objects %.1f per frame, %.1f culled, %.0f triangles\n", frames, objects / n, culled / n,
+		triangles / n);
+	printf("mesh cache         %d meshes, %.1f KB\n", cache.getMeshCount(), cache.getBytes() / 1024.0);
+	printf("per-object draws   %8.1f device calls per frame\n", legacy / n);
+	printf("sorted batches     %8.1f device calls per frame  (%.1f materials, %.1f instanced draws, %.1f instances)\n",
+		render::countD3DCalls(s) / n, s.materials / n, s.draws / n, s.instances / n);
+	printf("with instancing    %8.1f device calls per frame\n", (s.materials + s.draws) / n);
+	printf("hud                %8.1f DrawText calls per frame before, %.1f draws of %.1f glyphs now, laid out in %.2f%% of the frames\n",
+		hudDraws / n, s.texts / n, s.glyphs / n, 100.0 * hud.getLayoutCount() / n);
+	printf("record, sort and submit %.3f us per frame\n", 1e6 * seconds / n);
+	if (rasterFrames > 0)
+	{
+		const render::RasterStats& r = soft.getStats();
+		double rf = (double)rasterFrames;
+		printf("software raster    %lld frames %dx%d on %d thread(s), %.0f triangles, %.0f drawn, %.0f tile bins per frame\n",
+			rasterFrames, width, height, pool.getWorkers(), r.triangles / rf, r.rasterized / rf, r.binned / rf);
+		printf("                   vertices and setup %.2f ms, tiles %.2f ms per frame, %.1f frames/s (%.1f tile passes/s)\n",
+			1e3 * geometrySeconds / rf, 1e3 * rasterSeconds / rf, rf / (geometrySeconds + rasterSeconds),
+			rf / rasterSeconds);
+	}
+	if (trace != NULL)
+	{
+		prof::setEnabled(false);
+		printf("record to hud over the last %d frames: p50 %.2f us  p99 %.2f us  p99.9 %.2f us  max %.2f us\n",
+			frameTimes.getCount(), frameTimes.getPercentile(50) * 1e-3, frameTimes.getPercentile(99) * 1e-3,
+			frameTimes.getPercentile(99.9) * 1e-3, frameTimes.getMax() * 1e-3);
+		long long events = prof::writeChromeTrace(trace);
+		if (events < 0)
+			printf("could not write %s\n", trace);
+		else
+			printf("trace %s: %lld zones\n", trace, events);
+	}
+	printf("%lld failed check(s)\n", failed);
+	return (int)std::min(failed, 255LL);
+}
@@ -0,0 +1,351 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// File: renderList.cpp
+//
+// Desc: Sorted render command list, batch submission and the recording backend.
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "renderList.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <set>
+#include <utility>
+
+// sort key: mesh in the top 16 bits, material in the next 16, draw index in the low 32
+static const int MESH_SHIFT = 48;
+static const int MATERIAL_SHIFT = 32;
+static const unsigned long long INDEX_MASK = 0xffffffffull;
+
+render::Material render::makeMaterial(const Color& color, float power)
+{
+	Material m;
+	m.diffuse = color;
+	m.ambient = color;
+	m.specular = color;
+	m.emissive.r = m.emissive.g = m.emissive.b = 0;
+	m.emissive.a = 1;
+	m.power = power;
+	return m;
+}
+
+void render::setIdentity(Matrix& out)
+{
+	for (int r = 0; r < 4; r++)
+		for (int c = 0; c < 4; c++)
+			out.m[r][c] = r == c ? 1.0f : 0.0f;
+}
+
+void render::setTranslation(Matrix& out, float x, float y, float z)
+{
+	setIdentity(out);
+	out.m[3][0] = x;
+	out.m[3][1] = y;
+	out.m[3][2] = z;
+}
+
+void render::multiply(Matrix& out, const Matrix& a, const Matrix& b)
+{
+	for (int r = 0; r < 4; r++)
+		for (int c = 0; c < 4; c++)
+			out.m[r][c] = a.m[r][0] * b.m[0][c] + a.m[r][1] * b.m[1][c] + a.m[r][2] * b.m[2][c] + a.m[r][3] * b.m[3][c];
+}
+
+// the rotation rows of a translation are the identity, so only the last row changes
+void render::translate(Matrix& out, float x, float y, float z, const Matrix& world)
+{
+	for (int r = 0; r < 3; r++)
+		for (int c = 0; c < 4; c++)
+			out.m[r][c] = world.m[r][c];
+	for (int c = 0; c < 4; c++)
+		out.m[3][c] = x * world.m[0][c] + y * world.m[1][c] + z * world.m[2][c] + world.m[3][c];
+}
+
+static void normalize3(float v[3])
+{
+	float length = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+	if (length > 0)
+	{
+		v[0] /= length;
+		v[1] /= length;
+		v[2] /= length;
+	}
+}
+
+static void cross3(float out[3], const float a[3], const float b[3])
+{
+	out[0] = a[1] * b[2] - a[2] * b[1];
+	out[1] = a[2] * b[0] - a[0] * b[2];
+	out[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+void render::setLookAtLH(Matrix& out, const float eye[3], const float at[3], const float up[3])
+{
+	float z[3] = { at[0] - eye[0], at[1] - eye[1], at[2] - eye[2] };
+	normalize3(z);
+	float x[3], y[3];
+	cross3(x, up, z);
+	normalize3(x);
+	cross3(y, z, x);
+
+	setIdentity(out);
+	for (int r = 0; r < 3; r++)
+	{
+		out.m[r][0] = x[r];
+		out.m[r][1] = y[r];
+		out.m[r][2] = z[r];
+	}
+	out.m[3][0] = -(x[0] * eye[0] + x[1] * eye[1] + x[2] * eye[2]);
+	out.m[3][1] = -(y[0] * eye[0] + y[1] * eye[1] + y[2] * eye[2]);
+	out.m[3][2] = -(z[0] * eye[0] + z[1] * eye[1] + z[2] * eye[2]);
+}
+
+void render::setPerspectiveFovLH(Matrix& out, float fovY, float aspect, float zNear, float zFar)
+{
+	float yScale = 1 / std::tan(fovY / 2);
+	memset(&out, 0, sizeof(out));
+	out.m[0][0] = yScale / aspect;
+	out.m[1][1] = yScale;
+	out.m[2][2] = zFar / (zFar - zNear);
+	out.m[2][3] = 1;
+	out.m[3][2] = -zNear * zFar / (zFar - zNear);
+}
+
+//
+// Visibility
+//
+
+// the planes of the clip volume of D3D (-w <= x <= w, -w <= y <= w, 0 <= z <= w) in the space
+// before viewProj: column j of viewProj gives clip coordinate j of a point
+void render::setFrustum(Frustum& out, const Matrix& view, const Matrix& proj, int viewportHeight)
+{
+	Matrix viewProj;
+	multiply(viewProj, view, proj);
+	float col[4][4];
+	for (int j = 0; j < 4; j++)
+	{
+		for (int i = 0; i < 4; i++)
+			col[j][i] = viewProj.m[i][j];
+	}
+
+	static const int AXIS[6] = { 0, 0, 1, 1, 2, 2 };
+	static const float SIGN[6] = { 1, -1, 1, -1, 1, -1 };
+	for (int p = 0; p < 6; p++)
+	{
+		float* plane = out.plane[p];
+		for (int i = 0; i < 4; i++)
+		{
+			// w + x, w - x, w + y, w - y, z and w - z
+			float w = p == 4 ? 0 : col[3][i];
+			plane[i] = w + SIGN[p] * col[AXIS[p]][i];
+		}
+		float length = std::sqrt(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+		for (int i = 0; i < 4; i++)
+			plane[i] /= length;
+	}
+
+	for (int i = 0; i < 4; i++)
+		out.depth[i] = col[3][i];
+	out.pixels = proj.m[1][1] * viewportHeight / 2;
+}
+
+static void placeCenter(float out[3], const float center[3], const render::Matrix& world)
+{
+	for (int j = 0; j < 3; j++)
+		out[j] = center[0] * world.m[0][j] + center[1] * world.m[1][j] + center[2] * world.m[2][j] + world.m[3][j];
+}
+
+static float planeDistance(const float plane[4], const float p[3])
+{
+	return plane[0] * p[0] + plane[1] * p[1] + plane[2] * p[2] + plane[3];
+}
+
+bool render::isVisible(const Frustum& frustum, const BoundingSphere& bound, const Matrix& world)
+{
+	float c[3];
+	placeCenter(c, bound.center, world);
+	for (int p = 0; p < 6; p++)
+	{
+		if (planeDistance(frustum.plane[p], c) < -bound.radius)
+			return false;
+	}
+	return true;
+}
+
+// the box stays a box under a rigid world: its extent along a plane normal is the sum of its
+// half sizes along the rotated axes
+bool render::isVisible(const Frustum& frustum, const BoundingBox& bound, const Matrix& world)
+{
+	float center[3], half[3], c[3];
+	for (int i = 0; i < 3; i++)
+	{
+		center[i] = (bound.min[i] + bound.max[i]) / 2;
+		half[i] = (bound.max[i] - bound.min[i]) / 2;
+	}
+	placeCenter(c, center, world);
+	for (int p = 0; p < 6; p++)
+	{
+		const float* plane = frustum.plane[p];
+		float extent = 0;
+		for (int i = 0; i < 3; i++)
+			extent += half[i] * std::fabs(plane[0] * world.m[i][0] + plane[1] * world.m[i][1] + plane[2] * world.m[i][2]);
+		if (planeDistance(plane, c) < -extent)
+			return false;
+	}
+	return true;
+}
+
+float render::getScreenRadius(const Frustum& frustum, const BoundingSphere& bound, const Matrix& world)
+{
+	float c[3];
+	placeCenter(c, bound.center, world);
+	float depth = planeDistance(frustum.depth, c);
+	return depth > 0 ? bound.radius * frustum.pixels / depth : 0;
+}
+
+//
+// CRenderList
+//
+
+int render::CRenderList::addMaterial(const Material& material)
+{
+	for (size_t i = 0; i < m_materials.size(); i++)
+	{
+		if (memcmp(&m_materials[i], &material, sizeof(Material)) == 0)
+			return (int)i;
+	}
+	assert(m_materials.size() < MAX_MATERIALS);
+	m_materials.push_back(material);
+	return (int)m_materials.size() - 1;
+}
+
+void render::CRenderList::clear(void)
+{
+	m_keys.clear();
+	m_transforms.clear();
+	m_sorted.clear();
+	m_batches.clear();
+}
+
+void render::CRenderList::draw(int mesh, int material, const Matrix& world)
+{
+	assert(mesh >= 0 && mesh < MAX_MESHES && material >= 0 && material < (int)m_materials.size());
+	m_keys.push_back((unsigned long long)mesh << MESH_SHIFT | (unsigned long long)material << MATERIAL_SHIFT |
+		(unsigned long long)m_transforms.size());
+	m_transforms.push_back(world);
+}
+
+void render::CRenderList::sort(void)
+{
+	// the draw index in the low bits keeps equal mesh and material in draw order
+	std::sort(m_keys.begin(), m_keys.end());
+
+	m_sorted.resize(m_keys.size());
+	m_batches.clear();
+	for (size_t i = 0; i < m_keys.size(); i++)
+	{
+		unsigned long long key = m_keys[i];
+		int mesh = (int)(key >> MESH_SHIFT);
+		int material = (int)(key >> MATERIAL_SHIFT & 0xffff);
+		m_sorted[i] = m_transforms[(size_t)(key & INDEX_MASK)];
+
+		if (m_batches.empty() || m_batches.back().mesh != mesh || m_batches.back().material != material)
+		{
+			Batch b = { mesh, material, (int)i, 0 };
+			m_batches.push_back(b);
+		}
+		m_batches.back().count++;
+	}
+}
+
+void render::submit(const CRenderList& list, IRenderBackend& backend)
+{
+	const Matrix* transforms = list.getTransforms();
+	int material = -1;
+	for (int i = 0; i < list.getBatchCount(); i++)
+	{
+		const Batch& b = list.getBatch(i);
+		if (b.material != material)
+		{
+			material = b.material;
+			backend.setMaterial(material, list.getMaterial(material));
+		}
+		backend.drawInstances(b.mesh, transforms + b.first, b.count);
+	}
+}
+
+//
+// CRecordingBackend
+//
+
+render::CRecordingBackend::CRecordingBackend(void)
+{
+	m_material = -1;
+	resetStats();
+}
+
+void render::CRecordingBackend::setMaterial(int id, const Material&)
+{
+	Call call = { -1, id, 0 };
+	m_calls.push_back(call);
+	m_material = id;
+	m_stats.materials++;
+}
+
+void render::CRecordingBackend::drawInstances(int mesh, const Matrix*, int count)
+{
+	Call call = { mesh, m_material, count };
+	m_calls.push_back(call);
+	m_stats.draws++;
+	m_stats.instances += count;
+}
+
+void render::CRecordingBackend::drawText(const GlyphQuad*, int count)
+{
+	Call call = { -2, m_material, count };
+	m_calls.push_back(call);
+	m_stats.texts++;
+	m_stats.glyphs += count;
+}
+
+void render::CRecordingBackend::resetStats(void)
+{
+	m_stats.materials = 0;
+	m_stats.draws = 0;
+	m_stats.instances = 0;
+	m_stats.texts = 0;
+	m_stats.glyphs = 0;
+}
+
+bool render::checkSubmission(const CRenderList& list, const CRecordingBackend& backend, int legacyCalls)
+{
+	const std::vector<CRecordingBackend::Call>& calls = backend.getCalls();
+	std::set<std::pair<int, int> > drawn;
+	int instances = 0, materials = 0, texts = 0, current = -1;
+	for (size_t i = 0; i < calls.size(); i++)
+	{
+		if (calls[i].mesh == -2)
+		{
+			texts++;
+			continue;
+		}
+		if (calls[i].mesh < 0)
+		{
+			if (calls[i].material == current)
+				return false;  // redundant state change
+			current = calls[i].material;
+			materials++;
+			continue;
+		}
+		if (!drawn.insert(std::make_pair(calls[i].mesh, calls[i].material)).second)
+			return false;  // the pair was split over several batches
+		instances += calls[i].count;
+	}
+	RenderStats frame = RenderStats();
+	frame.materials = materials;
+	frame.draws = (long long)drawn.size();
+	frame.instances = instances;
+	return instances == list.getCommandCount() && texts == 1 && countD3DCalls(frame) < legacyCalls;
+}
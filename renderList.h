@@ -0,0 +1,217 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// File: renderList.h
+//
+// Desc: Device-free render command list. The draw paths record what they would draw, a mesh id,
+//       a material id and a world matrix, into a flat list instead of calling the device.
+//       sort() orders the list by mesh and then material and merges the runs of identical
+//       mesh and material into instanced batches, and submit() replays the batches on a
+//       backend, setting a material only when it changes.
+//
+//       A backend implements IRenderBackend: the Direct3D 9 front end (d3dBackend.h), or
+//       CRecordingBackend, which only counts and logs the calls so the batching can be checked
+//       without a device.
+//
+//       Matrices are row major with row vectors, the layout and the multiplication order of
+//       D3DXMATRIX, and Material has the layout of D3DMATERIAL9, so the Direct3D backend
+//       passes them on as they are.
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __renderListH__
+#define __renderListH__
+
+#include <vector>
+
+namespace render
+{
+	struct Color
+	{
+		float               r, g, b, a;
+	};
+
+	struct Matrix
+	{
+		float               m[4][4];
+	};
+
+	struct Material
+	{
+		Color               diffuse, ambient, specular, emissive;
+		float               power;
+	};
+
+	// a D3DLIGHT_POINT
+	struct PointLight
+	{
+		Color               diffuse, specular, ambient;
+		float               position[3];  // world space
+		float               range;
+		float               attenuation0, attenuation1, attenuation2;
+	};
+
+	// ambient, diffuse and specular of color, no emission, as CSphere::create made them
+	Material makeMaterial(const Color& color, float power);
+
+	void setIdentity(Matrix& out);
+	void setTranslation(Matrix& out, float x, float y, float z);
+	void multiply(Matrix& out, const Matrix& a, const Matrix& b);  // a then b, out may not alias
+	// translation (x, y, z) then world, without the full product
+	void translate(Matrix& out, float x, float y, float z, const Matrix& world);
+	// the matrices of D3DXMatrixLookAtLH and D3DXMatrixPerspectiveFovLH
+	void setLookAtLH(Matrix& out, const float eye[3], const float at[3], const float up[3]);
+	void setPerspectiveFovLH(Matrix& out, float fovY, float aspect, float zNear, float zFar);
+
+	//
+	// Visibility
+	//
+
+	// d3d::BoundingSphere and d3d::BoundingBox, in the local space of a mesh
+	struct BoundingSphere
+	{
+		float               center[3];
+		float               radius;
+	};
+
+	struct BoundingBox
+	{
+		float               min[3];
+		float               max[3];
+	};
+
+	// the clip volume of a camera as world space planes, and what a length at a view depth
+	// covers on screen
+	struct Frustum
+	{
+		float               plane[6][4];  // a x + b y + c z + d >= 0 inside, (a, b, c) of length 1
+		float               depth[4];     // the view depth of a point is (x, y, z, 1) . depth
+		float               pixels;       // on screen per unit of length at depth 1
+	};
+
+	void setFrustum(Frustum& out, const Matrix& view, const Matrix& proj, int viewportHeight);
+	// bound placed by world; world may rotate and translate, but not scale
+	bool isVisible(const Frustum& frustum, const BoundingSphere& bound, const Matrix& world);
+	bool isVisible(const Frustum& frustum, const BoundingBox& bound, const Matrix& world);
+	// the projected radius of bound in pixels, 0 when its centre is not in front of the eye
+	float getScreenRadius(const Frustum& frustum, const BoundingSphere& bound, const Matrix& world);
+
+	//
+	// Command list
+	//
+
+	// a run of commands with the same mesh and material, drawn as count instances
+	struct Batch
+	{
+		int                 mesh;
+		int                 material;
+		int                 first;  // into getTransforms()
+		int                 count;
+	};
+
+	class CRenderList {
+	public:
+		enum { MAX_MESHES = 1 << 16, MAX_MATERIALS = 1 << 16 };
+
+		// materials are kept across frames; an identical material gets the same id back
+		int addMaterial(const Material& material);
+		const Material& getMaterial(int id) const { return m_materials[id]; }
+		int getMaterialCount(void) const { return (int)m_materials.size(); }
+
+		// drops the commands of the last frame, keeps the storage and the materials
+		void clear(void);
+		void draw(int mesh, int material, const Matrix& world);
+
+		// orders the commands and builds the batches; commands with the same mesh and
+		// material keep the order they were drawn in
+		void sort(void);
+
+		int getCommandCount(void) const { return (int)m_keys.size(); }
+		int getBatchCount(void) const { return (int)m_batches.size(); }
+		const Batch& getBatch(int i) const { return m_batches[i]; }
+		const Matrix* getTransforms(void) const { return m_sorted.data(); }  // in batch order
+
+	private:
+		std::vector<unsigned long long> m_keys;  // mesh, material, draw index
+		std::vector<Matrix>     m_transforms;  // in draw order
+		std::vector<Matrix>     m_sorted;
+		std::vector<Batch>      m_batches;
+		std::vector<Material>   m_materials;
+	};
+
+	//
+	// Backends
+	//
+
+	// a character of screen space text, textured from the glyph atlas of the backend
+	struct GlyphQuad
+	{
+		float               x0, y0, x1, y1;  // pixels, top left origin
+		float               u0, v0, u1, v1;
+		unsigned int        color;           // 0xAARRGGBB
+	};
+
+	class IRenderBackend {
+	public:
+		virtual ~IRenderBackend(void) {}
+
+		virtual void setMaterial(int id, const Material& material) = 0;
+		// count copies of mesh with the current material, one per world matrix
+		virtual void drawInstances(int mesh, const Matrix* worlds, int count) = 0;
+		// the HUD over the scene, every quad in one draw
+		virtual void drawText(const GlyphQuad* quads, int count) = 0;
+	};
+
+	// replays the batches of a sorted list
+	void submit(const CRenderList& list, IRenderBackend& backend);
+
+	struct RenderStats
+	{
+		long long           materials;  // setMaterial calls
+		long long           draws;      // drawInstances calls
+		long long           instances;
+		long long           texts;      // drawText calls
+		long long           glyphs;
+	};
+
+	// null backend: counts the calls and keeps a log of the last frame
+	class CRecordingBackend : public IRenderBackend {
+	public:
+		struct Call
+		{
+			int             mesh;      // -1 for setMaterial, -2 for drawText
+			int             material;  // current material id
+			int             count;
+		};
+
+		CRecordingBackend(void);
+
+		void setMaterial(int id, const Material& material);
+		void drawInstances(int mesh, const Matrix* worlds, int count);
+		void drawText(const GlyphQuad* quads, int count);
+
+		void beginFrame(void) { m_calls.clear(); }
+		const std::vector<Call>& getCalls(void) const { return m_calls; }
+		const RenderStats& getStats(void) const { return m_stats; }  // since construction
+		void resetStats(void);
+
+	private:
+		std::vector<Call>   m_calls;
+		RenderStats         m_stats;
+		int                 m_material;
+	};
+
+	// device calls of the Direct3D 9 backend: a material per batch, then SetTransform and
+	// DrawSubset per instance (no instancing in the fixed function pipeline)
+	inline long long countD3DCalls(const RenderStats& s)
+	{
+		return s.materials + 2 * s.instances;
+	}
+
+	// false when the log of the last frame of backend breaks a batching rule: a redundant
+	// material change, a mesh and material pair split over several batches, a command of list
+	// not drawn once, not exactly one drawText, or no fewer device calls than legacyCalls (the
+	// per-object draws of the frame)
+	bool checkSubmission(const CRenderList& list, const CRecordingBackend& backend, int legacyCalls);
+}
+
+#endif // __renderListH__
@@ -0,0 +1,288 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// File: replay.cpp
+//
+// Desc: Varint/delta encoded input replays and their headless playback.
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "replay.h"
+#include <cstdio>
+#include <cstring>
+
+static const char REPLAY_MAGIC[4] = { 'V', 'B', 'R', 'P' };
+
+enum { EVENT_MOVE, EVENT_LAUNCH, EVENT_DT, EVENT_END };
+enum { FLAG_DYNAMIC = 1, FLAG_CONTINUOUS = 2, FLAG_EVENTS = 4, FLAG_FRICTION = 8 };
+
+static unsigned long long zigzag(long long value)
+{
+	return ((unsigned long long)value << 1) ^ (unsigned long long)(value >> 63);
+}
+
+static long long unzigzag(unsigned long long value)
+{
+	return (long long)(value >> 1) ^ -(long long)(value & 1);
+}
+
+//
+// CReplayWriter
+//
+
+sim::CReplayWriter::CReplayWriter(void)
+{
+	m_micros = 0;
+	m_frames = 0;
+	m_total = 0;
+}
+
+void sim::CReplayWriter::begin(const CGame& game, unsigned long long seed)
+{
+	m_data.assign(REPLAY_MAGIC, REPLAY_MAGIC + 4);
+	putVarint(REPLAY_VERSION);
+	putVarint(seed);
+	putVarint((unsigned long long)game.getBallNum());
+	putVarint((game.isDynamic() ? FLAG_DYNAMIC : 0) | (game.isContinuous() ? FLAG_CONTINUOUS : 0) |
+		(game.isEventDriven() ? FLAG_EVENTS : 0) | (game.hasFriction() ? FLAG_FRICTION : 0));
+	m_micros = 0;
+	m_frames = 0;
+	m_total = 0;
+}
+
+void sim::CReplayWriter::movePaddle(int pixels)
+{
+	event(EVENT_MOVE);
+	putSigned(pixels);
+}
+
+void sim::CReplayWriter::launch(int microradians)
+{
+	event(EVENT_LAUNCH);
+	putSigned(microradians);
+}
+
+void sim::CReplayWriter::step(unsigned int micros)
+{
+	if (micros != m_micros)
+	{
+		event(EVENT_DT);
+		putSigned((long long)micros - (long long)m_micros);
+		m_micros = micros;
+	}
+	m_frames++;
+	m_total++;
+}
+
+void sim::CReplayWriter::end(const CGame& game)
+{
+	event(EVENT_END);
+	putVarint((unsigned long long)game.getDestroyNum());
+	putVarint((unsigned long long)game.getLife());
+	putVarint((unsigned long long)game.getLevel());
+}
+
+void sim::CReplayWriter::event(int type)
+{
+	putVarint((unsigned long long)m_frames << 2 | (unsigned long long)type);
+	m_frames = 0;
+}
+
+void sim::CReplayWriter::putVarint(unsigned long long value)
+{
+	while (value >= 0x80)
+	{
+		m_data.push_back((unsigned char)(value | 0x80));
+		value >>= 7;
+	}
+	m_data.push_back((unsigned char)value);
+}
+
+void sim::CReplayWriter::putSigned(long long value)
+{
+	putVarint(zigzag(value));
+}
+
+bool sim::CReplayWriter::save(const char* path) const
+{
+	FILE* file = fopen(path, "wb");
+	if (file == NULL)
+		return false;
+	bool ok = fwrite(m_data.data(), 1, m_data.size(), file) == m_data.size();
+	return fclose(file) == 0 && ok;
+}
+
+//
+// CReplayPlayer
+//
+
+sim::CReplayPlayer::CReplayPlayer(void)
+{
+	m_events = 0;
+	m_seed = 0;
+	m_ballNum = 0;
+	m_dynamic = false;
+	m_continuous = true;
+	m_eventDriven = false;
+	m_friction = false;
+	m_expected.destroyNum = m_expected.life = m_expected.level = 0;
+	m_expected.frames = 0;
+	m_micros = 0;
+}
+
+bool sim::CReplayPlayer::load(const char* path)
+{
+	FILE* file = fopen(path, "rb");
+	if (file == NULL)
+		return false;
+
+	m_data.clear();
+	unsigned char buffer[4096];
+	size_t read;
+	while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+		m_data.insert(m_data.end(), buffer, buffer + read);
+	fclose(file);
+	return parse();
+}
+
+bool sim::CReplayPlayer::open(const unsigned char* data, size_t size)
+{
+	m_data.assign(data, data + size);
+	return parse();
+}
+
+// checks the whole stream once, so play() only has to follow it
+bool sim::CReplayPlayer::parse(void)
+{
+	if (m_data.size() < 4 || memcmp(m_data.data(), REPLAY_MAGIC, 4) != 0)
+		return false;
+
+	size_t pos = 4;
+	unsigned long long version, ballNum, flags;
+	if (!getVarint(pos, version) || version != REPLAY_VERSION ||
+		!getVarint(pos, m_seed) || !getVarint(pos, ballNum) || !getVarint(pos, flags) ||
+		ballNum == 0 || ballNum > 100000)
+	{
+		return false;
+	}
+	m_ballNum = (int)ballNum;
+	m_dynamic = (flags & FLAG_DYNAMIC) != 0;
+	m_continuous = (flags & FLAG_CONTINUOUS) != 0;
+	m_eventDriven = (flags & FLAG_EVENTS) != 0;
+	m_friction = (flags & FLAG_FRICTION) != 0;
+	m_events = pos;
+
+	long long micros = 0;
+	m_micros = 0;
+	m_expected.frames = 0;
+	for (;;)
+	{
+		unsigned long long head, value;
+		long long delta;
+		if (!getVarint(pos, head))
+			return false;
+		m_expected.frames += (long long)(head >> 2);
+		m_micros += (unsigned long long)micros * (head >> 2);
+
+		switch (head & 3)
+		{
+		case EVENT_MOVE:
+		case EVENT_LAUNCH:
+			if (!getSigned(pos, delta))
+				return false;
+			break;
+		case EVENT_DT:
+			if (!getSigned(pos, delta))
+				return false;
+			micros += delta;
+			if (micros < 0 || micros > 0xffffffffll)
+				return false;
+			break;
+		case EVENT_END:
+			if (!getVarint(pos, value))
+				return false;
+			m_expected.destroyNum = (int)value;
+			if (!getVarint(pos, value))
+				return false;
+			m_expected.life = (int)value;
+			if (!getVarint(pos, value))
+				return false;
+			m_expected.level = (int)value;
+			return pos == m_data.size();
+		}
+	}
+}
+
+bool sim::CReplayPlayer::play(CGame& game, ReplayResult& result) const
+{
+	result.destroyNum = result.life = result.level = 0;
+	result.frames = 0;
+	if (m_events == 0)
+		return false;
+
+	game.setDynamic(m_dynamic);
+	game.setContinuous(m_continuous);
+	game.setEventDriven(m_eventDriven);
+	game.setFriction(m_friction);
+	if (!game.setup(m_seed))
+		return false;
+
+	size_t pos = m_events;
+	long long micros = 0;
+	float delta = 0;
+	for (;;)
+	{
+		unsigned long long head;
+		long long value = 0;
+		getVarint(pos, head);
+		for (unsigned long long f = head >> 2; f > 0; f--)
+			game.step(delta);
+		result.frames += (long long)(head >> 2);
+
+		int type = (int)(head & 3);
+		if (type == EVENT_END)
+			break;
+		getSigned(pos, value);
+		if (type == EVENT_MOVE)
+		{
+			game.movePaddle((float)value * PADDLE_STEP);
+		}
+		else if (type == EVENT_LAUNCH)
+		{
+			game.launch((float)value * 1e-6f);
+		}
+		else
+		{
+			micros += value;
+			delta = deltaFromMicros((unsigned int)micros);
+		}
+	}
+
+	result.destroyNum = game.getDestroyNum();
+	result.life = game.getLife();
+	result.level = game.getLevel();
+	return true;
+}
+
+bool sim::CReplayPlayer::getVarint(size_t& pos, unsigned long long& value) const
+{
+	value = 0;
+	for (int shift = 0; shift < 64; shift += 7)
+	{
+		if (pos >= m_data.size())
+			return false;
+		unsigned char byte = m_data[pos++];
+		value |= (unsigned long long)(byte & 0x7f) << shift;
+		if ((byte & 0x80) == 0)
+			return true;
+	}
+	return false;
+}
+
+bool sim::CReplayPlayer::getSigned(size_t& pos, long long& value) const
+{
+	unsigned long long raw;
+	if (!getVarint(pos, raw))
+		return false;
+	value = unzigzag(raw);
+	return true;
+}
@@ -0,0 +1,128 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// File: replay.h
+//
+// Desc: Input replays. A game is fully determined by its seed, its settings, the player input
+//       (mouse moves in pixels, space presses) and the frame steps, so a replay stores only
+//       those and re-simulates the rest.
+//
+//       Format, all integers as LEB128 varints (7 bits per byte, low bits first):
+//
+//           "VBRP" version seed ballNum flags
+//           event*  END destroyNum life level
+//
+//       An event is one varint frames << 2 | type followed by its payload, where frames
+//       counts the steps since the previous event. Steps are not stored one by one: a run of
+//       steps with the same frame time costs nothing until the next event.
+//
+//           MOVE    zigzag mouse dx in pixels
+//           LAUNCH  zigzag launch angle in microradians
+//           DT      zigzag change of the frame time in microseconds
+//           END     the final state the player checks
+//
+//       Frame times are kept in whole microseconds and turned into game time by
+//       deltaFromMicros, live and in the player alike, so a replay steps with the exact
+//       floats of the recorded game.
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __replayH__
+#define __replayH__
+
+#include "simCore.h"
+#include <vector>
+
+namespace sim
+{
+	const int REPLAY_VERSION = 3;  // 2: layouts that could touch the walls, 1: the old friction rules
+
+	// game time of a frame of micros microseconds
+	inline float deltaFromMicros(unsigned int micros)
+	{
+		return (float)(micros / 1000.0) * GAME_TIME_PER_MS;
+	}
+
+	// what a replay is checked against
+	struct ReplayResult
+	{
+		int                 destroyNum;
+		int                 life;
+		int                 level;
+		long long           frames;
+	};
+
+	//
+	// Recording
+	//
+
+	class CReplayWriter {
+	public:
+		CReplayWriter(void);
+
+		// header of a game that was just set up from seed
+		void begin(const CGame& game, unsigned long long seed);
+
+		// the input as the game received it, before the step of its frame
+		void movePaddle(int pixels);
+		void launch(int microradians = 0);
+		void step(unsigned int micros);
+
+		void end(const CGame& game);  // after the last step
+
+		const std::vector<unsigned char>& getData(void) const { return m_data; }
+		bool save(const char* path) const;
+
+	private:
+		void event(int type);
+		void putVarint(unsigned long long value);
+		void putSigned(long long value);
+
+		std::vector<unsigned char>  m_data;
+		unsigned int        m_micros;  // frame time of the last step
+		long long           m_frames;  // steps since the last event
+		long long           m_total;
+	};
+
+	//
+	// Playback
+	//
+
+	class CReplayPlayer {
+	public:
+		CReplayPlayer(void);
+
+		bool load(const char* path);
+		bool open(const unsigned char* data, size_t size);  // the data is copied
+
+		unsigned long long getSeed(void) const { return m_seed; }
+		int getBallNum(void) const { return m_ballNum; }
+		bool isDynamic(void) const { return m_dynamic; }
+		bool isContinuous(void) const { return m_continuous; }
+		bool isEventDriven(void) const { return m_eventDriven; }
+		bool hasFriction(void) const { return m_friction; }
+		const ReplayResult& getExpected(void) const { return m_expected; }  // END record
+		double getSeconds(void) const { return m_micros * 1e-6; }  // recorded play time
+
+		// re-simulates the replay on game (constructed with getBallNum() balls), as fast as
+		// it runs; false when the data is corrupt or the layout could not be set up
+		bool play(CGame& game, ReplayResult& result) const;
+
+	private:
+		bool parse(void);
+		bool getVarint(size_t& pos, unsigned long long& value) const;
+		bool getSigned(size_t& pos, long long& value) const;
+
+		std::vector<unsigned char>  m_data;
+		size_t              m_events;  // offset of the first event
+		unsigned long long  m_seed;
+		int                 m_ballNum;
+		bool                m_dynamic;
+		bool                m_continuous;
+		bool                m_eventDriven;
+		bool                m_friction;
+		ReplayResult        m_expected;
+		unsigned long long  m_micros;
+	};
+}
+
+#endif // __replayH__
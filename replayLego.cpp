@@ -0,0 +1,117 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// File: replayLego.cpp
+//
+// Desc: Headless replay player. Re-simulates recorded games (virtualLego -record, headlessLego
+//       -record) as fast as they run and checks the final destroyNum, life and level against
+//       the recording. Replays are spread over the work pool, one game per task, so a batch of
+//       thousands of sessions doubles as a regression and a throughput workload.
+//
+//       usage: replayLego [-threads T] [-v] file...   (T = 0: one per core)
+//
+//       The exit code is the number of replays that failed or diverged (at most 255).
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "replay.h"
+#include "workPool.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+struct Job {
+	const char*         path;
+	bool                loaded;
+	bool                played;
+	sim::ReplayResult   expected;
+	sim::ReplayResult   result;
+	double              gameSeconds;  // recorded play time
+};
+
+int main(int argc, char* argv[])
+{
+	int threads = 0;
+	bool verbose = false;
+	std::vector<Job> jobs;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "-threads") && i + 1 < argc) threads = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-v")) verbose = true;
+		else if (argv[i][0] != '-')
+		{
+			Job job = {};
+			job.path = argv[i];
+			jobs.push_back(job);
+		}
+		else
+		{
+			jobs.clear();
+			break;
+		}
+	}
+	if (jobs.empty())
+	{
+		printf("usage: replayLego [-threads T] [-v] file...\n");
+		return 1;
+	}
+
+	sim::CWorkPool pool(threads);
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	auto run = [&](int begin, int end, int) {
+		for (int i = begin; i < end; i++)
+		{
+			Job& job = jobs[i];
+			sim::CReplayPlayer player;
+			job.loaded = player.load(job.path);
+			if (!job.loaded)
+				continue;
+			job.expected = player.getExpected();
+			job.gameSeconds = player.getSeconds();
+
+			// the contact solver stays on this worker, replays run side by side instead
+			sim::CGame game(player.getBallNum());
+			job.played = player.play(game, job.result);
+		}
+	};
+	pool.parallelFor((int)jobs.size(), 1, run);
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	int bad = 0;
+	long long frames = 0;
+	double gameSeconds = 0;
+	for (size_t i = 0; i < jobs.size(); i++)
+	{
+		const Job& job = jobs[i];
+		const sim::ReplayResult& e = job.expected;
+		const sim::ReplayResult& r = job.result;
+		bool match = job.played && r.destroyNum == e.destroyNum && r.life == e.life && r.level == e.level &&
+			r.frames == e.frames;
+
+		if (!job.loaded)
+			printf("%s: not a replay\n", job.path);
+		else if (!job.played)
+			printf("%s: could not set the game up\n", job.path);
+		else if (!match)
+			printf("%s: DIVERGED  score %d/%d  life %d/%d  level %d/%d  (replayed/recorded)\n", job.path,
+				r.destroyNum, e.destroyNum, r.life, e.life, r.level, e.level);
+		else if (verbose)
+			printf("%s: ok  score %d  life %d  level %d  frames %lld\n", job.path, r.destroyNum, r.life, r.level, r.frames);
+
+		if (!match)
+			bad++;
+		frames += r.frames;
+		gameSeconds += job.gameSeconds;
+	}
+
+	printf("replays %d  diverged or failed %d  workers %d\n", (int)jobs.size(), bad, pool.getWorkers());
+	printf("frames %lld  time %.3f s  %.0f frames/s  %.0fx real time\n", frames, seconds,
+		seconds > 0 ? frames / seconds : 0.0, seconds > 0 ? gameSeconds / seconds : 0.0);
+	return std::min(bad, 255);
+}
@@ -0,0 +1,207 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// File: shotEvaluator.cpp
+//
+// Desc: Monte Carlo evaluation of launches from the current table.
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "shotEvaluator.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+sim::ShotSettings::ShotSettings(void)
+{
+	rollouts = 32;
+	giveUpAfter = 8;
+	maxFrames = 4000;
+	dt = 16 * GAME_TIME_PER_MS;
+	paddleStep = 0.05f;
+	angleNoise = 0.02f;
+	positionNoise = 0.02f;
+}
+
+sim::CShotEvaluator::CShotEvaluator(void)
+{
+	m_pool = NULL;
+}
+
+bool sim::CShotEvaluator::evaluate(const CGame& game, const ShotCandidate* candidates, int count,
+	const CRandom& random, ShotResult* results)
+{
+	if (game.isOver() || game.isLaunched())
+		return false;
+
+	int workers = m_pool != NULL ? m_pool->getWorkers() : 1;
+	if ((int)m_scratch.size() < workers)
+		m_scratch.resize(workers);
+
+	auto run = [&](int begin, int end, int worker) {
+		for (int c = begin; c < end; c++)
+			evaluateOne(game, candidates[c], random.stream((unsigned long long)c), m_scratch[worker].game, results[c]);
+	};
+	if (m_pool != NULL)
+		m_pool->parallelFor(count, 1, run);
+	else
+		run(0, count, 0);
+	return true;
+}
+
+void sim::CShotEvaluator::evaluateOne(const CGame& game, const ShotCandidate& candidate, const CRandom& random,
+	CGame& scratch, ShotResult& result) const
+{
+	int destroyed = 0, blue = 0, lifeLoss = 0;
+	int r;
+
+	for (r = 0; r < m_settings.rollouts; r++)
+	{
+		// hopeless: every rollout so far lost the ball without touching a yellow one
+		if (m_settings.giveUpAfter > 0 && r == m_settings.giveUpAfter && lifeLoss == r && destroyed == 0)
+			break;
+
+		CRandom stream = random.stream((unsigned long long)r);
+		Outcome outcome;
+		rollout(game, candidate, stream, scratch, outcome);
+		destroyed += outcome.destroyed;
+		blue += outcome.blue;
+		lifeLoss += outcome.lifeLoss;
+	}
+
+	float inv = r > 0 ? 1.0f / r : 0.0f;
+	result.destroyed = destroyed * inv;
+	result.blue = blue * inv;
+	result.lifeLoss = lifeLoss * inv;
+	result.rollouts = r;
+}
+
+void sim::CShotEvaluator::rollout(const CGame& game, const ShotCandidate& candidate, CRandom& random,
+	CGame& scratch, Outcome& outcome) const
+{
+	// assignment reuses the storage of the scratch game; the rollouts already run on the
+	// pool, so the contact solver of the copy stays on this thread
+	scratch = game;
+	scratch.setPool(NULL);
+
+	const int level = game.getLevel();
+	const int destroyed = game.getDestroyNum();
+	const int life = game.getLife();
+	const bool blue = !game.getBlueBall().isNull();
+	const float reach = 2 * (float)M_RADIUS + 0.05f;  // paddle contact, with a margin
+	const float strip = WALL_Z_MIN - 2 * (float)M_RADIUS;  // nothing but the paddle below this line
+
+	outcome.destroyed = 0;
+	outcome.blue = false;
+	outcome.lifeLoss = false;
+
+	float x = candidate.x + random.uniform(-m_settings.positionNoise, m_settings.positionNoise);
+	x = std::min(std::max(x, -PADDLE_X_MAX + 0.001f), PADDLE_X_MAX - 0.001f);
+	scratch.movePaddle(x - scratch.getWhiteBall().getCenter().x);
+	scratch.launch(candidate.angle + random.uniform(-m_settings.angleNoise, m_settings.angleNoise));
+
+	const CBall& red = scratch.getRedBall();
+	const CBall& white = scratch.getWhiteBall();
+	bool left = false;  // the red ball went up past the strip
+
+	for (int frame = 0; frame < m_settings.maxFrames; frame++)
+	{
+		// the paddle chases the red ball
+		float dx = red.getCenter().x - white.getCenter().x;
+		scratch.movePaddle(std::min(std::max(dx, -m_settings.paddleStep), m_settings.paddleStep));
+		scratch.step(m_settings.dt);
+
+		// the level ended: all balls cleared, or the last life was lost
+		if (scratch.isOver() || scratch.getLevel() != level)
+		{
+			outcome.lifeLoss = scratch.isOver() || scratch.getDestroyNum() != scratch.getBallNum() * level;
+			break;
+		}
+		if (blue && scratch.getBlueBall().isNull())
+			outcome.blue = true;
+
+		// back on the paddle: lost, or stopped by friction without costing a life (the blue
+		// ball gave one on the way)
+		if (!scratch.isLaunched())
+		{
+			outcome.lifeLoss = scratch.getLife() < life + (outcome.blue ? 1 : 0);
+			break;
+		}
+
+		Vec2 p = red.getCenter();
+		float vx = red.getVelocity_X(), vz = red.getVelocity_Z();
+		if (p.z > strip)
+		{
+			left = true;
+			continue;
+		}
+		if (!left)
+			continue;
+		if (vz > 0)
+			break;  // back on the paddle
+
+		// falling through the empty strip: without a wall bounce on the way the paddle has to
+		// cover the gap before the ball leaves the table, and both distances are linear in time
+		// (in the path length under friction, its closed form gives the time)
+		if (scratch.isDynamic() || vz == 0)
+			continue;
+		float frames = (p.z - TABLE_BOTTOM_Z) / (-vz * BALL_TIME_SCALE * m_settings.dt);
+		float xEnd = p.x + vx * BALL_TIME_SCALE * m_settings.dt * frames;
+		if (scratch.hasFriction())
+		{
+			CBallMotion path;
+			path.start(0, p.x, p.z, vx, vz, FRICTION);
+			double t = path.getTimeAt((p.z - TABLE_BOTTOM_Z) * path.getSpeed() / -vz);
+			if (t == DBL_MAX)
+				continue;  // it stops on the table
+			frames = (float)(t / m_settings.dt);
+		}
+		float w = white.getCenter().x;
+		if ((p.x - w) * (xEnd - w) <= 0)
+			continue;
+		float t;
+		int piece;
+		if (scratch.getGeometry().sweep(p.x, p.z, red.getRadius(), xEnd - p.x, TABLE_BOTTOM_Z - p.z, t, piece))
+		{
+			int kind = scratch.getGeometry().get(piece).kind;
+			if (kind == OBSTACLE_BOX || kind == OBSTACLE_SEGMENT)
+				continue;  // it bounces on the way
+		}
+		if (std::fabs(p.x - w) > reach && std::fabs(xEnd - w) > reach + m_settings.paddleStep * frames)
+		{
+			outcome.lifeLoss = true;
+			break;
+		}
+	}
+
+	outcome.destroyed = scratch.getDestroyNum() - destroyed;
+}
+
+void sim::CShotEvaluator::makeGrid(int positions, int angles, float maxAngle, std::vector<ShotCandidate>& candidates)
+{
+	candidates.clear();
+	for (int i = 0; i < positions; i++)
+	{
+		float x = positions > 1 ? -PADDLE_X_MAX + 0.01f + (2 * PADDLE_X_MAX - 0.02f) * i / (positions - 1) : 0.0f;
+		for (int j = 0; j < angles; j++)
+		{
+			ShotCandidate c = { x, angles > 1 ? -maxAngle + 2 * maxAngle * j / (angles - 1) : 0.0f };
+			candidates.push_back(c);
+		}
+	}
+}
+
+int sim::CShotEvaluator::best(const ShotResult* results, int count, float penalty)
+{
+	int best = -1;
+	float bestScore = 0;
+	for (int i = 0; i < count; i++)
+	{
+		float score = results[i].destroyed + results[i].blue - penalty * results[i].lifeLoss;
+		if (best < 0 || score > bestScore)
+		{
+			best = i;
+			bestScore = score;
+		}
+	}
+	return best;
+}
@@ -0,0 +1,104 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// File: shotEvaluator.h
+//
+// Desc: Monte Carlo evaluation of launches from the current table. Every candidate (paddle
+//       position and launch angle) is played a number of times on a copy of the game, with
+//       a little noise on the aim and a paddle that chases the red ball at a limited speed,
+//       until the red ball comes back to the paddle or is lost. The evaluator reports the
+//       expected yellow balls destroyed, the chance to pick up the blue ball and the chance
+//       to lose a life for every candidate; it backs difficulty tuning and the assist mode.
+//
+//       Candidates are spread over the work pool, a candidate runs all of its rollouts on
+//       one worker. Every worker owns a scratch game that is assigned from the table before
+//       each rollout, so the rollouts reuse its storage and do not allocate. Rollout r of
+//       candidate c draws from random.stream(c).stream(r): the results do not depend on the
+//       number of workers or the schedule.
+//
+//       A rollout stops as soon as its outcome is known (the red ball is under the paddle or
+//       back on it), and a candidate whose first rollouts all lose a life without hitting
+//       anything is given up.
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __shotEvaluatorH__
+#define __shotEvaluatorH__
+
+#include "simCore.h"
+#include "simRandom.h"
+#include "workPool.h"
+#include <vector>
+
+namespace sim
+{
+	struct ShotCandidate
+	{
+		float           x;      // paddle position at launch
+		float           angle;  // launch angle, see CGame::launch
+	};
+
+	struct ShotResult
+	{
+		float           destroyed;  // expected yellow balls destroyed
+		float           blue;       // probability to pick up the blue ball
+		float           lifeLoss;   // probability to lose the red ball
+		int             rollouts;   // rollouts played (fewer when the candidate was given up)
+	};
+
+	struct ShotSettings
+	{
+		int             rollouts;       // per candidate
+		int             giveUpAfter;    // rollouts before a hopeless candidate is given up, 0: never
+		int             maxFrames;      // per rollout
+		float           dt;             // frame time in game units
+		float           paddleStep;     // paddle travel per frame
+		float           angleNoise;     // the launch angle is off by up to this
+		float           positionNoise;  // the paddle is off by up to this at launch
+
+		ShotSettings(void);
+	};
+
+	class CShotEvaluator {
+	public:
+		CShotEvaluator(void);
+
+		void setPool(CWorkPool* pool) { m_pool = pool; }  // NULL: single threaded
+		ShotSettings& getSettings(void) { return m_settings; }
+
+		// plays every candidate from the table of game, which must be waiting for a launch;
+		// results receives one entry per candidate. False when there is nothing to launch.
+		bool evaluate(const CGame& game, const ShotCandidate* candidates, int count, const CRandom& random,
+			ShotResult* results);
+
+		// positions x angles candidates over the paddle range and [-maxAngle, maxAngle]
+		static void makeGrid(int positions, int angles, float maxAngle, std::vector<ShotCandidate>& candidates);
+
+		// candidate with the highest destroyed + blue - penalty * lifeLoss
+		static int best(const ShotResult* results, int count, float penalty);
+
+	private:
+		struct Outcome
+		{
+			int         destroyed;
+			bool        blue;
+			bool        lifeLoss;
+		};
+
+		struct Scratch
+		{
+			CGame       game;
+			char        pad[64];  // keeps the hot ends of two scratch games off one cache line
+		};
+
+		void evaluateOne(const CGame& game, const ShotCandidate& candidate, const CRandom& random,
+			CGame& scratch, ShotResult& result) const;
+		void rollout(const CGame& game, const ShotCandidate& candidate, CRandom& random,
+			CGame& scratch, Outcome& outcome) const;
+
+		CWorkPool*              m_pool;
+		ShotSettings            m_settings;
+		std::vector<Scratch>    m_scratch;  // per worker
+	};
+}
+
+#endif // __shotEvaluatorH__
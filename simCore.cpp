@@ -0,0 +1,907 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// File: simCore.cpp
+//
+// Desc: Device-free simulation core of Virtual Billiard (physics and game rules).
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "simCore.h"
+#include "levelPack.h"
+#include "profiler.h"
+#include "sweepTest.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdlib>
+
+//
+// CBall
+//
+
+sim::CBall::CBall(void)
+{
+	center_x = 0;
+	center_z = 0;
+	m_velocity_x = 0;
+	m_velocity_z = 0;
+	m_alive = false;
+}
+
+bool sim::CBall::hasIntersected(float x, float z, float radius)
+{
+	float dx = x - center_x;
+	float dz = z - center_z;
+	float distance = std::sqrt(dx * dx + dz * dz);  // distance between the two centers
+
+	if (distance < (this->getRadius() + radius))
+	{
+		// the balls overlap, push this ball back along the collision normal
+		float nx = 0, nz = 0;
+		if (distance > 0)
+		{
+			nx = dx / distance;
+			nz = dz / distance;
+		}
+
+		float overlap = (this->getRadius() + radius) - distance;
+
+		this->setCenter(center_x - nx * (overlap / 2), center_z - nz * (overlap / 2));
+		return true;
+	}
+	return false;
+}
+
+bool sim::CBall::hitBy(float x, float z, float radius)
+{
+	if (hasIntersected(x, z, radius))
+	{
+		// collision normal (this -> ball)
+		float dx = x - center_x;
+		float dz = z - center_z;
+		float len = std::sqrt(dx * dx + dz * dz);
+		float nx = 0, nz = 0;
+		if (len > 0)
+		{
+			nx = dx / len;
+			nz = dz / len;
+		}
+
+		// reflect the velocity of this ball, the partner is at rest and keeps its velocity
+		float v1_dot_n = m_velocity_x * nx + m_velocity_z * nz;
+		this->setPower(m_velocity_x - 2 * v1_dot_n * nx, m_velocity_z - 2 * v1_dot_n * nz);
+		return true;
+	}
+	return false;
+}
+
+void sim::CBall::ballUpdate(float timeDiff, float friction, float xLimit, float zLimit)
+{
+	PROF_ZONE("ballUpdate");
+	// same step as CBallStore::integrate
+	ballStepDecay(center_x, center_z, m_velocity_x, m_velocity_z, getRadius(), decayTravel(friction, timeDiff),
+		decayFactor(friction, timeDiff), xLimit, zLimit);
+}
+
+//
+// CWall
+//
+
+sim::CWall::CWall(void)
+{
+	m_x = 0;
+	m_z = 0;
+	m_width = 0;
+	m_depth = 0;
+}
+
+bool sim::CWall::hasIntersected(const CBall& ball) const
+{
+	Vec2 p = ball.getCenter();
+	return boxOverlaps(p.x, p.z, ball.getRadius(), m_x, m_z, m_width, m_depth);
+}
+
+void sim::CWall::hitBy(CBall& ball) const
+{
+	Vec2 p = ball.getCenter();
+	float vx = ball.getVelocity_X(), vz = ball.getVelocity_Z();
+	hitBox(p.x, p.z, vx, vz, ball.getRadius(), m_x, m_z, m_width, m_depth);
+	ball.setCenter(p.x, p.z);
+	ball.setPower(vx, vz);
+}
+
+bool sim::CWall::sweep(const CBall& ball, float dx, float dz, float& t) const
+{
+	// the box hasIntersected tests, shrunk by the slop so the sweep ends inside it
+	float grow = ball.getRadius() - CONTACT_SLOP;
+	Vec2 p = ball.getCenter();
+	return sweepBox(p.x, p.z, dx, dz, m_x - (m_width / 2 + grow), m_z - (m_depth / 2 + grow),
+		m_x + (m_width / 2 + grow), m_z + (m_depth / 2 + grow), t);
+}
+
+//
+// Layout helpers
+//
+
+// distance test between two balls
+bool sim::isColliding(float x1, float z1, float x2, float z2)
+{
+	float dx = x1 - x2;
+	float dz = z1 - z2;
+	return (dx * dx + dz * dz) < (4 * M_RADIUS * M_RADIUS);  // squared distance against squared sum of radii
+}
+
+void sim::initTableGrid(CSpatialGrid& grid)
+{
+	grid.init(WALL_X_MIN, WALL_Z_MIN, WALL_X_MAX, WALL_Z_MAX, 2 * (float)M_RADIUS);
+}
+
+bool sim::generateRandomPositions(std::vector<Vec2>& spherePos, int count, const CStaticGeometry& geometry,
+	const CRandom& random, CSpatialGrid& grid, CPoissonDisk& sampler)
+{
+	PROF_ZONE("generateRandomPositions");
+	spherePos.clear();
+	grid.clear();
+
+	// the placement area, cut down to the limits of a smaller table; the grid covers it
+	const float r = (float)M_RADIUS;
+	float xMin = std::max(WALL_X_MIN, r - geometry.getLimitX());
+	float xMax = std::min(WALL_X_MAX, geometry.getLimitX() - r);
+	float zMax = std::min(WALL_Z_MAX, geometry.getLimitZ() - r);
+	if (xMin >= xMax || WALL_Z_MIN >= zMax)
+		return false;
+
+	// no ball on a piece of the table, nor over a pocket or a drain
+	auto clear = [&geometry, r](float x, float z) {
+		return geometry.findOverlap(x, z, r) < 0 && !geometry.isDrained(x, z);
+	};
+
+	// ask for a spare position for the blue ball first, without it if the area is too full
+	float minDist = 2 * r;
+	if (!sampler.sample(xMin, WALL_Z_MIN, xMax, zMax, minDist, count + 1, random, clear) && !sampler.pick(count))
+		return false;
+
+	for (int i = 0; i < count; ++i)
+	{
+		Vec2 pos = { sampler.getX(i), sampler.getZ(i) };
+		spherePos.push_back(pos);
+		grid.insert(i, pos.x, pos.z);
+	}
+	return true;
+}
+
+bool sim::generateLevel(const CRandom& table, int level, int count, const CStaticGeometry& geometry,
+	std::vector<Vec2>& spherePos, CSpatialGrid& grid, CPoissonDisk& sampler, CBall& blueBall, bool& blueActivated)
+{
+	// one stream per purpose and per level, so the layout does not shift the blue ball roll
+	CRandom layout = table.stream(STREAM_LAYOUT).stream((unsigned long long)level);
+	CRandom blue = table.stream(STREAM_BLUE).stream((unsigned long long)level);
+
+	if (!generateRandomPositions(spherePos, count, geometry, layout, grid, sampler))
+		return false;
+	blueActivated = SetupBlueBall(blueBall, sampler, count, blue);
+	return true;
+}
+
+bool sim::SetupBlueBall(CBall& blueBall, const CPoissonDisk& sampler, int count, CRandom& random)
+{
+	blueBall.destroy();
+
+	// the blue ball shows up in one out of three layouts
+	if (random.below(3) != 0 || sampler.size() <= count)
+		return false;
+	blueBall.create();
+
+	blueBall.setCenter(sampler.getX(count), sampler.getZ(count));
+	blueBall.setPower(0, 0);
+	return true;
+}
+
+//
+// CGame
+//
+
+sim::CGame::CGame(int ballNum)
+{
+	m_ballNum = ballNum;
+	m_spaceActivate = 0;
+	m_life = LIFENUM;
+	m_scoreBase = 0;
+	m_level = 1;
+	m_speed = 2;
+	m_win = false;
+	m_defeated = false;
+	m_failed = false;
+	m_blueActivated = false;
+	m_continuous = true;
+	m_dynamic = false;
+	m_geometry = &getClassicGeometry();
+	m_pack = NULL;
+	m_packTable = 0;
+	m_friction = false;
+	m_substeps = 1;
+	m_eventDriven = false;
+	m_time = 0;
+	m_redVelocity.x = m_redVelocity.z = 0;
+	m_paddleAt = m_redVelocity;
+	m_redAlive = false;
+	m_pathLength = 0;
+	m_redStamp = m_paddleStamp = 0;
+	m_eventCount = 0;
+	initTableGrid(m_grid);
+	m_candidates.reserve(ballNum);  // ball indices, so the broad phase never grows it in a step
+	m_events.reserve(256);
+}
+
+bool sim::CGame::setup(unsigned long long seed)
+{
+	return setup(CRandom(seed));
+}
+
+bool sim::CGame::setup(const CRandom& table)
+{
+	m_random = table;
+	m_spaceActivate = 0;
+	m_scoreBase = 0;
+	m_struck.assign(m_ballNum, false);
+	m_win = false;
+	m_defeated = false;
+	m_failed = false;
+	m_life = LIFENUM;
+	m_level = 1;
+	m_speed = 2;
+
+	bool placed = placeBalls();
+
+	m_red.create();
+	m_red.setCenter(0, -3.5f + 0.06f + 3 * m_red.getRadius());
+	m_red.setPower(0, 0);
+
+	m_white.create();
+	m_white.setCenter(0, PADDLE_Z);
+
+	m_time = 0;
+	m_eventCount = 0;
+	scheduleRed();
+	return placed;
+}
+
+void sim::CGame::setLevelPack(const CLevelPack* pack, int table)
+{
+	m_pack = pack;
+	m_packTable = table;
+}
+
+bool sim::CGame::placeBalls(void)
+{
+	// a packed level is copied as it is, without generating or allocating anything
+	PackedLevel packed;
+	if (m_pack != NULL && m_geometry == &getClassicGeometry() && m_pack->getLevel(m_packTable, m_level, packed))
+	{
+		if (!(packed.flags & LEVEL_PLACED))
+		{
+			m_failed = true;
+			return false;
+		}
+		m_balls.clear();
+		m_balls.reserve(m_ballNum);
+		m_grid.clear();
+		for (int i = 0; i < m_ballNum; ++i)
+		{
+			m_balls.add(packed.positions[i].x, packed.positions[i].z, (float)M_RADIUS);
+			m_grid.insert(i, packed.positions[i].x, packed.positions[i].z);
+		}
+		m_scoreBase += m_struck.count();
+		m_struck.assign(m_ballNum, false);
+
+		m_blueActivated = (packed.flags & LEVEL_BLUE) != 0;
+		m_blue.destroy();
+		if (m_blueActivated)
+		{
+			m_blue.create();
+			m_blue.setCenter(packed.blue.x, packed.blue.z);
+			m_blue.setPower(0, 0);
+		}
+		return true;
+	}
+
+	// the layout grid doubles as the broad phase of the yellow balls (same ids); on failure
+	// the game is over and keeps the balls it had
+	if (!generateLevel(m_random, m_level, m_ballNum, *m_geometry, m_spherePos, m_grid, m_sampler, m_blue, m_blueActivated))
+	{
+		m_failed = true;
+		return false;
+	}
+
+	m_balls.clear();
+	m_balls.reserve(m_ballNum);
+	for (int i = 0; i < m_ballNum; ++i)
+		m_balls.add(m_spherePos[i].x, m_spherePos[i].z, (float)M_RADIUS);
+	m_scoreBase += m_struck.count();
+	m_struck.assign(m_ballNum, false);
+	return true;
+}
+
+// called every time a life is lost, puts a new red ball on top of the white ball
+void sim::CGame::resetGame(void)
+{
+	m_red.create();
+	m_red.setCenter(m_white.getCenter().x, m_white.getCenter().z + m_white.getRadius() * 2);
+	m_red.setPower(0, 0);
+	m_spaceActivate = 0;
+}
+
+// level up once at least half of the balls were destroyed in this level
+bool sim::CGame::checkLevelUp(int destroyNum) const
+{
+	const int score_per_level = m_ballNum / 2;
+
+	// the score is not reset on level up, so the bar is scaled by level
+	return destroyNum >= m_level * score_per_level;
+}
+
+void sim::CGame::levelUp(void)
+{
+	PROF_ZONE("levelUp");
+	m_life = LIFENUM;
+	m_level++;
+	m_speed += 1.5f;
+
+	resetGame();
+	placeBalls();
+}
+
+// sub-steps so that the fastest ball moves at most one radius per sub-step
+int sim::CGame::substepCount(float timeDelta) const
+{
+	if (!m_continuous)
+		return 1;
+
+	float speed = 0;
+	if (!m_red.isNull())
+	{
+		float vx = m_red.getVelocity_X();
+		float vz = m_red.getVelocity_Z();
+		speed = std::sqrt(vx * vx + vz * vz);
+	}
+	if (m_dynamic)
+		speed = std::max(speed, m_balls.maxSpeed());
+
+	float distance = BALL_TIME_SCALE * timeDelta * speed;
+	int count = (int)std::ceil(distance / m_red.getRadius());
+	if (count < 1)
+		count = 1;
+	if (count > MAX_SUBSTEPS)
+		count = MAX_SUBSTEPS;
+	return count;
+}
+
+// earliest time of impact of the red ball moving by (dx, dz)
+bool sim::CGame::sweepRed(float dx, float dz, float& tHit)
+{
+	Vec2 p = m_red.getCenter();
+	float r = m_red.getRadius();
+	bool hit = false;
+	float t;
+	int j;
+
+	tHit = 1;
+	if (m_geometry->sweep(p.x, p.z, r, dx, dz, t, j))
+	{
+		tHit = t;
+		hit = true;
+	}
+
+	Vec2 w = m_white.getCenter();
+	if (sweepCircle(p.x, p.z, dx, dz, w.x, w.z, r + m_white.getRadius() - CONTACT_SLOP, t) && t < tHit)
+	{
+		tHit = t;
+		hit = true;
+	}
+
+	if (!m_blue.isNull())
+	{
+		Vec2 b = m_blue.getCenter();
+		if (sweepCircle(p.x, p.z, dx, dz, b.x, b.z, r + m_blue.getRadius() - CONTACT_SLOP, t) && t < tHit)
+		{
+			tHit = t;
+			hit = true;
+		}
+	}
+
+	// yellow balls around the swept segment
+	float reach = 0.5f * std::max(std::fabs(dx), std::fabs(dz)) + r + (float)M_RADIUS;
+	m_grid.query(p.x + 0.5f * dx, p.z + 0.5f * dz, reach, [&](int id) {
+		float tb;
+		if (sweepCircle(p.x, p.z, dx, dz, m_balls.getX(id), m_balls.getZ(id),
+			r + m_balls.getRadius(id) - CONTACT_SLOP, tb) && tb < tHit)
+		{
+			tHit = tb;
+			hit = true;
+		}
+	});
+	return hit;
+}
+
+// moves the red ball for timeDiff, stopping at every contact to resolve it
+void sim::CGame::advanceRed(float timeDiff)
+{
+	float friction = m_friction ? FRICTION : 0;
+	float remaining = timeDiff;
+
+	for (int i = 0; i < MAX_SWEEP_HITS && remaining > 0; i++)
+	{
+		float step = remaining;
+		float t;
+		bool moving = m_red.getVelocity_X() != 0 || m_red.getVelocity_Z() != 0;
+		float travel = decayTravel(friction, remaining);
+		if (m_continuous && moving && !m_red.isNull() &&
+			sweepRed(BALL_TIME_SCALE * travel * m_red.getVelocity_X(),
+				BALL_TIME_SCALE * travel * m_red.getVelocity_Z(), t))
+		{
+			step = travelTime(friction, travel * t);
+		}
+
+		m_red.ballUpdate(step, friction, m_geometry->getLimitX(), m_geometry->getLimitZ());
+		remaining -= step;
+		resolveContacts();
+	}
+}
+
+void sim::CGame::step(float timeDelta)
+{
+	PROF_ZONE("step");
+	if (m_eventDriven && !m_dynamic)
+	{
+		stepEvents(timeDelta);
+		return;
+	}
+
+	m_time += timeDelta;
+	m_substeps = substepCount(timeDelta);
+	float timeDiff = timeDelta / m_substeps;
+
+	for (int i = 0; i < m_substeps; i++)
+	{
+		advanceRed(timeDiff);
+		if (m_dynamic)
+			advanceBalls(timeDiff);
+	}
+
+	applyLevelRules();
+}
+
+// drained: the red ball reached a pocket or a drain, where the event driven mode stops it on
+// the edge
+void sim::CGame::resolveContacts(bool drained)
+{
+	int j;
+
+	// the red ball fell off the table or into a pocket: destroy it and take a life
+	Vec2 c = m_red.getCenter();
+	if ((drained && !m_red.isNull()) || m_geometry->isDrained(c.x, c.z))
+	{
+		m_red.destroy();
+		if (m_life == 1)
+			m_life--;
+		if (m_life > 1)
+		{
+			m_life--;
+			resetGame();
+		}
+	}
+	else if (m_friction && m_spaceActivate != 0 && !m_win && !m_red.isNull() &&
+		m_red.getVelocity_X() == 0 && m_red.getVelocity_Z() == 0)
+	{
+		resetGame();  // friction stopped it: back on the paddle for another launch, no life lost
+	}
+
+	{
+		PROF_ZONE("wallCollision");
+		c = m_red.getCenter();
+		float vx = m_red.getVelocity_X(), vz = m_red.getVelocity_Z();
+		m_geometry->hitBy(c.x, c.z, vx, vz, m_red.getRadius());
+		m_red.setCenter(c.x, c.z);
+		m_red.setPower(vx, vz);
+	}
+
+	// the white ball (paddle) hits the red ball
+	m_red.hitBy(m_white);
+
+	// blue ball gives an extra life
+	if (!m_blue.isNull())
+	{
+		if (m_red.hasIntersected(m_blue))
+		{
+			m_blue.destroy();
+			m_life++;
+		}
+	}
+
+	// yellow balls near the red ball; the reach also covers the push back of earlier hits
+	PROF_ZONE("ballCollision");
+	Vec2 red = m_red.getCenter();
+	m_candidates.clear();
+	m_grid.query(red.x, red.z, 2 * m_red.getRadius() + (float)M_RADIUS, [&](int id) {
+		m_candidates.push_back(id);
+	});
+	std::sort(m_candidates.begin(), m_candidates.end());  // same order as a scan over all balls
+
+	for (size_t c = 0; c < m_candidates.size(); c++)
+	{
+		j = m_candidates[c];
+		float vx = m_red.getVelocity_X();
+		float vz = m_red.getVelocity_Z();
+		if (m_red.hitBy(m_balls.getX(j), m_balls.getZ(j), m_balls.getRadius(j)))
+		{
+			if (m_dynamic)
+			{
+				strike(j, vx, vz);
+			}
+			else
+			{
+				m_balls.destroy(j);
+				m_grid.remove(j);
+				m_struck.set(j);
+			}
+		}
+	}
+}
+
+// dynamic mode: the struck ball takes the velocity (vx, vz) the red ball had along the contact
+// normal. The red ball itself keeps the reflection of hitBy, so the player's ball never stalls.
+void sim::CGame::strike(int j, float vx, float vz)
+{
+	Vec2 red = m_red.getCenter();
+	float x = m_balls.getX(j), z = m_balls.getZ(j);
+	float dx = x - red.x;
+	float dz = z - red.z;
+	float d = std::sqrt(dx * dx + dz * dz);
+	float nx = 0, nz = 0;
+	if (d > 0)
+	{
+		nx = dx / d;
+		nz = dz / d;
+	}
+
+	float bvx = m_balls.getVelocity_X(j), bvz = m_balls.getVelocity_Z(j);
+	float approach = (vx - bvx) * nx + (vz - bvz) * nz;
+	if (approach > 0)
+		m_balls.setPower(j, bvx + approach * nx, bvz + approach * nz);
+
+	// hitBy moved the red ball back by half of the overlap, the struck ball takes the other half
+	float overlap = m_red.getRadius() + m_balls.getRadius(j) - d;
+	if (overlap > 0)
+	{
+		m_balls.setCenter(j, x + overlap * nx, z + overlap * nz);
+		m_grid.move(j, x + overlap * nx, z + overlap * nz);
+	}
+
+	m_struck.set(j);
+}
+
+// dynamic mode: moves the yellow balls, bounces them off the walls, the paddle and the blue
+// ball, drains the ones that left the table and resolves the ball to ball contacts
+void sim::CGame::advanceBalls(float timeDiff)
+{
+	PROF_ZONE("advanceBalls");
+
+	m_balls.integrate(timeDiff, m_friction ? FRICTION : 0, m_geometry->getLimitX(), m_geometry->getLimitZ());
+
+	// without friction the damping of the original ballUpdate, for the yellow balls only
+	if (!m_friction)
+	{
+		float rate = 1 - DYNAMIC_DAMPING * timeDiff;
+		m_balls.damp(std::max(rate, 0.0f));
+	}
+
+	m_balls.forEachAlive([&](int i) {
+		if (!m_struck.test(i))
+			return;
+
+		// the table, then the paddle and the blue ball
+		float x = m_balls.getX(i), z = m_balls.getZ(i);
+		float vx = m_balls.getVelocity_X(i), vz = m_balls.getVelocity_Z(i);
+		bool drained = m_geometry->hitBy(x, z, vx, vz, m_balls.getRadius(i));
+		m_balls.setCenter(i, x, z);
+		m_balls.setPower(i, vx, vz);
+		if (drained)
+		{
+			m_balls.destroy(i);
+			m_grid.remove(i);
+			return;
+		}
+
+		// the paddle and the blue ball do not move
+		CBall ball;
+		ball.setCenter(m_balls.getX(i), m_balls.getZ(i));
+		ball.setPower(m_balls.getVelocity_X(i), m_balls.getVelocity_Z(i));
+		bool hit = ball.hitBy(m_white);
+		if (!m_blue.isNull())
+			hit |= ball.hitBy(m_blue);
+		if (hit)
+		{
+			m_balls.setCenter(i, ball.getCenter().x, ball.getCenter().z);
+			m_balls.setPower(i, ball.getVelocity_X(), ball.getVelocity_Z());
+		}
+
+		m_grid.move(i, m_balls.getX(i), m_balls.getZ(i));
+	});
+
+	m_solver.solve(m_balls, m_grid, (float)M_RADIUS);
+
+	// balls set moving by another ball are struck as well
+	m_balls.forEachAlive([&](int i) {
+		if (m_balls.getVelocity_X(i) != 0 || m_balls.getVelocity_Z(i) != 0)
+			m_struck.set(i);
+	});
+}
+
+void sim::CGame::applyLevelRules(void)
+{
+	// every ball of this level is gone (the score accumulates over levels)
+	if (getDestroyNum() == m_ballNum * m_level)
+	{
+		levelUp();
+	}
+	else if (m_life == 0)
+	{
+		if (checkLevelUp(getDestroyNum()))
+		{
+			if (m_level == 5)  // already at the last level
+			{
+				m_win = true;
+				m_red.setPower(0, 0);
+			}
+			else
+			{
+				levelUp();
+			}
+		}
+		else
+		{
+			m_defeated = true;
+		}
+	}
+}
+
+//
+// Event driven mode
+//
+
+// the earliest contact on top of the heap; kind and target break ties
+static bool laterEvent(const sim::SimEvent& a, const sim::SimEvent& b)
+{
+	if (a.time != b.time)
+		return a.time > b.time;
+	if (a.kind != b.kind)
+		return a.kind > b.kind;
+	return a.target > b.target;
+}
+
+void sim::CGame::stepEvents(float timeDelta)
+{
+	double end = m_time + timeDelta;
+	m_substeps = 1;
+	syncEvents();
+
+	// a ball pinned between the paddle and a wall is resolved at most MAX_STEP_CONTACTS times
+	for (int contacts = 0; !m_events.empty() && contacts < MAX_STEP_CONTACTS;)
+	{
+		SimEvent e = m_events.front();
+		if (!isStale(e) && e.time > end)
+			break;
+		std::pop_heap(m_events.begin(), m_events.end(), laterEvent);
+		m_events.pop_back();
+		if (isStale(e))
+			continue;
+
+		// the sweeps stop CONTACT_SLOP inside the contact, so resolveContacts sees it
+		moveRed(e.time);
+		if (e.kind == EVENT_REST)
+			m_red.setPower(0, 0);
+		resolveContacts(e.kind == EVENT_EXIT);
+		m_eventCount++;
+		contacts++;
+		scheduleRed();
+	}
+
+	moveRed(end);
+	applyLevelRules();
+	syncEvents();
+}
+
+// predictions are redone when the path of the red ball changed outside of a contact (launch,
+// a lost life, level up, win) or the paddle moved since they were made
+void sim::CGame::syncEvents(void)
+{
+	if (m_red.isNull() == m_redAlive || m_red.getVelocity_X() != m_redVelocity.x ||
+		m_red.getVelocity_Z() != m_redVelocity.z)
+	{
+		scheduleRed();
+		return;
+	}
+
+	Vec2 w = m_white.getCenter();
+	if (w.x != m_paddleAt.x || w.z != m_paddleAt.z)
+	{
+		// the paddle may have moved onto the ball, the sweeps only see contacts ahead
+		Vec2 r = m_red.getCenter();
+		if (m_pathLength == 0 || !isColliding(r.x, r.z, w.x, w.z))
+		{
+			schedulePaddle();
+			return;
+		}
+		resolveContacts();
+		scheduleRed();
+	}
+}
+
+// the red ball starts a new path here: every prediction so far is stale
+void sim::CGame::scheduleRed(void)
+{
+	m_events.clear();
+	m_redStamp++;
+	Vec2 p = m_red.getCenter();
+	m_redVelocity.x = m_red.getVelocity_X();
+	m_redVelocity.z = m_red.getVelocity_Z();
+	m_redAlive = !m_red.isNull();
+	m_redPath.start(m_time, p.x, p.z, m_redVelocity.x, m_redVelocity.z, m_friction ? FRICTION : 0);
+
+	// a path that ends on the table ends with the ball at rest
+	float rest = m_redPath.getRestDistance();
+	m_pathLength = m_redAlive ? std::min(EVENT_HORIZON, rest) : 0;
+	if (m_pathLength == 0)
+	{
+		// too slow to move at all, ballStep would stop it
+		if (m_redAlive && (m_redVelocity.x != 0 || m_redVelocity.z != 0))
+			pushEvent(m_time, EVENT_REST, 0);
+		m_paddleAt = m_white.getCenter();
+		return;
+	}
+
+	// a contact pushed the ball into a wall (the paddle against a side wall): resolved right
+	// away, as the next sub-step of the stepped mode would
+	float r = m_red.getRadius();
+	int wall = m_geometry->findOverlap(p.x, p.z, r);
+	if (wall >= 0)
+	{
+		pushEvent(m_time, EVENT_WALL, wall);
+		schedulePaddle();
+		return;
+	}
+	if (m_geometry->isDrained(p.x, p.z))  // or past the edge of a pocket or a drain
+	{
+		pushEvent(m_time, EVENT_EXIT, 0);
+		schedulePaddle();
+		return;
+	}
+
+	// the path as t in [0, 1] over its length, the nearest static contact on it
+	float speed = m_redPath.getSpeed();
+	float dx = m_pathLength * m_redVelocity.x / speed, dz = m_pathLength * m_redVelocity.z / speed;
+	float tHit = 1, t;
+	int kind = -1, target = 0;
+
+	if (m_geometry->sweep(p.x, p.z, r, dx, dz, t, target))
+	{
+		tHit = t;
+		int piece = m_geometry->get(target).kind;
+		kind = piece == OBSTACLE_BOX || piece == OBSTACLE_SEGMENT ? EVENT_WALL : EVENT_EXIT;
+	}
+
+	if (!m_blue.isNull())
+	{
+		Vec2 b = m_blue.getCenter();
+		if (sweepCircle(p.x, p.z, dx, dz, b.x, b.z, r + m_blue.getRadius() - CONTACT_SLOP, t) && t < tHit)
+		{
+			tHit = t;
+			kind = EVENT_BLUE;
+			target = 0;
+		}
+	}
+
+	// yellow balls around the path up to that contact
+	float hx = 0.5f * tHit * dx, hz = 0.5f * tHit * dz;
+	float reach = std::max(std::fabs(hx), std::fabs(hz)) + r + (float)M_RADIUS;
+	m_grid.query(p.x + hx, p.z + hz, reach, [&](int id) {
+		float tb;
+		if (sweepCircle(p.x, p.z, dx, dz, m_balls.getX(id), m_balls.getZ(id),
+			r + m_balls.getRadius(id) - CONTACT_SLOP, tb) && (tb < tHit || (tb == tHit && kind == EVENT_BALL && id < target)))
+		{
+			tHit = tb;
+			kind = EVENT_BALL;
+			target = id;
+		}
+	});
+
+	if (kind >= 0)
+		pushEvent(m_redPath.getTimeAt(tHit * m_pathLength), kind, target);
+	else if (m_pathLength == rest)
+		pushEvent(m_redPath.getRestTime(), EVENT_REST, 0);
+	schedulePaddle();
+}
+
+// the paddle only moves between steps, so its contact is predicted from where the ball is now
+void sim::CGame::schedulePaddle(void)
+{
+	m_paddleStamp++;
+	m_paddleAt = m_white.getCenter();
+	if (m_pathLength == 0)
+		return;
+
+	// the rest of the path, at most EVENT_HORIZON long
+	Vec2 p = m_red.getCenter();
+	float covered = m_redPath.getDistance(m_time);
+	float length = std::min(EVENT_HORIZON, m_redPath.getRestDistance() - covered);
+	float scale = length / m_redPath.getSpeed();
+	float vx, vz, t;
+	m_redPath.getStartVelocity(vx, vz);
+	if (length > 0 && sweepCircle(p.x, p.z, scale * vx, scale * vz, m_paddleAt.x, m_paddleAt.z,
+		m_red.getRadius() + m_white.getRadius() - CONTACT_SLOP, t))
+	{
+		pushEvent(m_redPath.getTimeAt(covered + t * length), EVENT_PADDLE, 0);
+	}
+}
+
+void sim::CGame::pushEvent(double time, int kind, int target)
+{
+	SimEvent e = { time, kind, target, m_redStamp, m_paddleStamp };
+	m_events.push_back(e);
+	std::push_heap(m_events.begin(), m_events.end(), laterEvent);
+}
+
+bool sim::CGame::isStale(const SimEvent& e) const
+{
+	return e.stamp != m_redStamp || (e.kind == EVENT_PADDLE && e.paddleStamp != m_paddleStamp);
+}
+
+// the red ball at time on its path; a ball at rest stays where it is (it rides the paddle)
+void sim::CGame::moveRed(double time)
+{
+	if (m_pathLength > 0)
+	{
+		float x, z;
+		m_redPath.getPosition(time, x, z);
+		m_redPath.getVelocity(time, m_redVelocity.x, m_redVelocity.z);
+		m_red.setCenter(x, z);
+		m_red.setPower(m_redVelocity.x, m_redVelocity.z);
+	}
+	m_time = time;
+}
+
+double sim::CGame::getNextEventTime(void)
+{
+	while (!m_events.empty() && isStale(m_events.front()))
+	{
+		std::pop_heap(m_events.begin(), m_events.end(), laterEvent);
+		m_events.pop_back();
+	}
+	return m_events.empty() ? DBL_MAX : m_events.front().time;
+}
+
+void sim::CGame::movePaddle(float dx)
+{
+	if (m_life > 0 && m_win == false)
+	{
+		Vec2 white = m_white.getCenter();
+		Vec2 red = m_red.getCenter();
+		float x = white.x + dx;
+
+		if (x > -PADDLE_X_MAX && x < PADDLE_X_MAX)
+		{
+			m_white.setCenter(x, white.z);
+			if (m_spaceActivate == 0)  // the red ball rides on the paddle until it is launched
+				m_red.setCenter(red.x + dx, red.z);
+		}
+	}
+}
+
+void sim::CGame::launch(float angle)
+{
+	if (m_spaceActivate == 0 && m_win == false)
+	{
+		m_red.setPower(m_speed * std::sin(angle), m_speed * std::cos(angle));
+		m_spaceActivate = 1;  // only the first space launches the ball
+	}
+}
@@ -0,0 +1,337 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// File: simCore.h
+//
+// Desc: Device-free simulation core of Virtual Billiard. Holds the ball/wall physics and the
+//       game rules that used to live inside virtualLego.cpp, so they can run without a window
+//       or a Direct3D device (headless drivers, servers, tools).
+//
+//       The table is simulated on the x-z plane. Every ball rests on the table at height
+//       M_RADIUS, so the y coordinate is a rendering concern only.
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __simCoreH__
+#define __simCoreH__
+
+#include "ballMotion.h"
+#include "ballStore.h"
+#include "spatialGrid.h"
+#include "staticGeometry.h"
+#include "contactSolver.h"
+#include "poissonDisk.h"
+#include "simRandom.h"
+#include <vector>
+
+#define BALLNUM 20  // number of yellow balls
+#define LIFENUM 2  // number of lives
+#define M_RADIUS 0.15   // sphere radius
+#define DECREASE_RATE 0.9982
+
+namespace sim
+{
+	//
+	// Table constants
+	//
+
+	// area in which yellow/blue balls are placed (wall thickness already taken into account)
+	const float WALL_X_MIN = -2.8f, WALL_X_MAX = 2.8f;
+	const float WALL_Z_MIN = -2.6f, WALL_Z_MAX = 3.3f;  // z min is higher to keep the red and white balls free
+
+	const float TABLE_BOTTOM_Z = -3.5f;  // the red ball is lost once it falls below this line
+	const float PADDLE_Z = -3.5f + 0.06f + 1 * (float)M_RADIUS;  // z of the white ball (paddle)
+	const float PADDLE_STEP = 0.007f;  // world units per mouse pixel
+	const float PADDLE_X_MAX = 3 - (float)M_RADIUS - 0.06f;  // the paddle stays strictly inside +-PADDLE_X_MAX
+	const float GAME_TIME_PER_MS = 0.0007f;  // game time per millisecond of a frame of the front end
+	// decay rate of the velocity per game time: DECREASE_RATE once per 16 ms frame of the front end
+	const float FRICTION = (1 - (float)DECREASE_RATE) / (16 * GAME_TIME_PER_MS);
+	const float DYNAMIC_DAMPING = (1 - (float)DECREASE_RATE) * 400;  // dynamic mode without friction
+
+	const int MAX_SUBSTEPS = 64;    // cap of the adaptive sub-steps per step
+	const int MAX_SWEEP_HITS = 4;   // contacts resolved per sub-step
+	const float EVENT_HORIZON = 16; // event driven mode: length of the swept path, crosses the table
+	const int MAX_STEP_CONTACTS = 256;  // event driven mode: contacts resolved per step
+
+	//
+	// Math
+	//
+
+	struct Vec2
+	{
+		float x, z;
+	};
+
+	//
+	// Ball
+	//
+
+	class CBall {
+	private:
+		float               center_x, center_z;
+		float               m_velocity_x;
+		float               m_velocity_z;
+		bool                m_alive;
+
+	public:
+		CBall(void);
+
+		void create(void) { m_alive = true; }
+		void destroy(void) { m_alive = false; }
+		bool isNull() const { return !m_alive; }
+
+		// pushes this ball out of the other ball on contact
+		bool hasIntersected(float x, float z, float radius);
+		bool hasIntersected(CBall& ball) { return hasIntersected(ball.center_x, ball.center_z, ball.getRadius()); }
+
+		// reflects this ball off the other ball (at rest) on contact
+		bool hitBy(float x, float z, float radius);
+		bool hitBy(CBall& ball) { return hitBy(ball.center_x, ball.center_z, ball.getRadius()); }
+		// xLimit, zLimit: the clamp of ballStep, CStaticGeometry::setLimits
+		void ballUpdate(float timeDiff, float friction = 0, float xLimit = BALL_LIMIT_X, float zLimit = BALL_LIMIT_Z);
+
+		float getVelocity_X() const { return m_velocity_x; }
+		float getVelocity_Z() const { return m_velocity_z; }
+		void setPower(float vx, float vz)
+		{
+			m_velocity_x = vx;
+			m_velocity_z = vz;
+		}
+
+		void setCenter(float x, float z)
+		{
+			center_x = x;
+			center_z = z;
+		}
+		Vec2 getCenter(void) const
+		{
+			Vec2 org = { center_x, center_z };
+			return org;
+		}
+		float getRadius(void) const { return (float)(M_RADIUS); }
+	};
+
+	//
+	// Wall (axis aligned box), the contact of an OBSTACLE_BOX of CStaticGeometry
+	//
+
+	class CWall {
+	private:
+		float               m_x;
+		float               m_z;
+		float               m_width;
+		float               m_depth;
+
+	public:
+		CWall(void);
+
+		void create(float iwidth, float idepth)
+		{
+			m_width = iwidth;
+			m_depth = idepth;
+		}
+		void setPosition(float x, float z)
+		{
+			m_x = x;
+			m_z = z;
+		}
+
+		bool hasIntersected(const CBall& ball) const;
+		void hitBy(CBall& ball) const;
+		bool sweep(const CBall& ball, float dx, float dz, float& t) const;  // time of impact along (dx, dz)
+
+		float getX(void) const { return m_x; }
+		float getZ(void) const { return m_z; }
+		float getWidth(void) const { return m_width; }
+		float getDepth(void) const { return m_depth; }
+	};
+
+	//
+	// Contact of the red ball in event driven mode
+	//
+
+	enum EventKind { EVENT_WALL, EVENT_PADDLE, EVENT_BLUE, EVENT_BALL, EVENT_EXIT, EVENT_REST };
+
+	struct SimEvent
+	{
+		double              time;         // game time of the contact
+		int                 kind;         // EventKind
+		int                 target;       // wall or yellow ball index
+		unsigned int        stamp;        // path of the red ball it was predicted on
+		unsigned int        paddleStamp;  // EVENT_PADDLE: paddle position it was predicted for
+	};
+
+	//
+	// Layout helpers
+	//
+
+	bool isColliding(float x1, float z1, float x2, float z2);
+
+	// places count balls on a Poisson-disk layout of the placement area (WALL_X_MIN..WALL_Z_MAX
+	// inside the limits of geometry), off its solid pieces, pockets and drains; grid receives
+	// ball i under id i. The sampler keeps one more position clear of the balls and of the
+	// pieces when the area allows it (see SetupBlueBall). False when the area can not hold
+	// count balls.
+	bool generateRandomPositions(std::vector<Vec2>& spherePos, int count, const CStaticGeometry& geometry,
+		const CRandom& random, CSpatialGrid& grid, CPoissonDisk& sampler);
+	// the blue ball takes the spare position of the layout, count is the number of yellow balls;
+	// the position passed the same tests of the table as the yellow balls
+	bool SetupBlueBall(CBall& blueBall, const CPoissonDisk& sampler, int count, CRandom& random);
+
+	// the layout of a level as CGame places it on geometry: the yellow balls and the blue ball
+	// roll on streams of the table stream per purpose and per level. False when the balls do
+	// not fit, the blue ball is then left as it was.
+	bool generateLevel(const CRandom& table, int level, int count, const CStaticGeometry& geometry,
+		std::vector<Vec2>& spherePos, CSpatialGrid& grid, CPoissonDisk& sampler, CBall& blueBall, bool& blueActivated);
+
+	// grid over the placement area, one cell per ball diameter
+	void initTableGrid(CSpatialGrid& grid);
+
+	class CLevelPack;
+
+	//
+	// Game
+	//
+
+	class CGame {
+	public:
+		CGame(int ballNum = BALLNUM);
+
+		bool setup(unsigned long long seed);  // Setup() without the device work, false when the balls do not fit
+		bool setup(const CRandom& table);     // same on a table stream split from a master seed
+		void step(float timeDelta);     // non-rendering part of Display()
+
+		// continuous collision (swept tests and sub-steps), on by default
+		void setContinuous(bool continuous) { m_continuous = continuous; }
+		bool isContinuous(void) const { return m_continuous; }
+		int getSubsteps(void) const { return m_substeps; }  // sub-steps of the last step
+
+		// Event driven mode: between contacts the red ball moves on a straight line past static
+		// targets, so step() computes when it meets a wall, the paddle, the blue ball, a yellow
+		// ball or the bottom of the table, jumps there, resolves the contact with the rules of
+		// the stepped mode and predicts the next one. A step costs the contacts in it, whatever
+		// its length. Predictions go into a priority queue and are dropped when they come up
+		// after the path they were made for changed. Not with dynamic mode; off by default.
+		// Set before setup(), as the other modes.
+		void setEventDriven(bool eventDriven) { m_eventDriven = eventDriven; }
+		bool isEventDriven(void) const { return m_eventDriven; }
+		double getTime(void) const { return m_time; }  // game time since setup
+		double getNextEventTime(void);  // DBL_MAX when no contact is ahead
+		long long getEventCount(void) const { return m_eventCount; }  // contacts resolved
+
+		// friction: the balls slow down on the closed form path of ballMotion.h in every mode,
+		// and a launched red ball that comes to rest goes back on the paddle to be launched
+		// again, without losing a life; off by default, the balls keep their speed and the
+		// dynamic mode damps the yellow balls per sub-step as the original ballUpdate did
+		void setFriction(bool friction) { m_friction = friction; }
+		bool hasFriction(void) const { return m_friction; }
+
+		// the fixed pieces of the table, getClassicGeometry() unless set; NULL goes back to it.
+		// The geometry is shared by copies of the game and has to outlive them. Set before
+		// setup().
+		void setGeometry(const CStaticGeometry* geometry) { m_geometry = geometry != NULL ? geometry : &getClassicGeometry(); }
+		const CStaticGeometry& getGeometry(void) const { return *m_geometry; }
+
+		// levels from a pack (levelPack.h) instead of generating them, for table `table` of the
+		// pack; the game has to be set up on pack->getTableSeed(table). Levels the pack does not
+		// hold are generated. The pack is shared by copies of the game and has to outlive them.
+		// NULL (the default) generates every level. The layouts of a pack are those of the
+		// classic table, so a game on other geometry generates its levels. Set before setup().
+		void setLevelPack(const CLevelPack* pack, int table = 0);
+		const CLevelPack* getLevelPack(void) const { return m_pack; }
+
+		// dynamic mode: a struck yellow ball scores once, starts moving and collides with the
+		// other balls until it drains off the bottom of the table; off by default
+		void setDynamic(bool dynamic) { m_dynamic = dynamic; }
+		bool isDynamic(void) const { return m_dynamic; }
+		void setPool(CWorkPool* pool) { m_solver.setPool(pool); }  // threads of the contact solver
+		int getContacts(void) const { return m_solver.getContacts(); }  // ball contacts of the last sub-step
+
+		// player input
+		void movePaddle(float dx);      // WM_MOUSEMOVE, dx in world units
+		void launch(float angle = 0);   // VK_SPACE, angle in radians off straight up (positive x)
+
+		bool isWin(void) const { return m_win; }
+		bool isDefeated(void) const { return m_defeated; }
+		bool isFailed(void) const { return m_failed; }  // a level layout could not hold the balls
+		bool isOver(void) const { return m_win || m_defeated || m_failed; }
+
+		int getLife(void) const { return m_life; }
+		int getLevel(void) const { return m_level; }
+		int getDestroyNum(void) const { return m_scoreBase + m_struck.count(); }
+		int getBallNum(void) const { return m_ballNum; }
+		float getSpeed(void) const { return m_speed; }
+		bool isLaunched(void) const { return m_spaceActivate != 0; }
+		bool isBlueActivated(void) const { return m_blueActivated; }
+
+		const CBallStore& getBalls(void) const { return m_balls; }  // yellow balls
+		const CBall& getRedBall(void) const { return m_red; }
+		const CBall& getWhiteBall(void) const { return m_white; }
+		const CBall& getBlueBall(void) const { return m_blue; }
+
+	private:
+		void resetGame(void);
+		bool checkLevelUp(int destroyNum) const;
+		void levelUp(void);
+		bool placeBalls(void);
+		int substepCount(float timeDelta) const;
+		void advanceRed(float timeDiff);
+		bool sweepRed(float dx, float dz, float& t);
+		void resolveContacts(bool drained = false);
+		void strike(int j, float vx, float vz);
+		void advanceBalls(float timeDiff);
+		void applyLevelRules(void);
+
+		void stepEvents(float timeDelta);
+		void syncEvents(void);
+		void scheduleRed(void);
+		void schedulePaddle(void);
+		void pushEvent(double time, int kind, int target);
+		bool isStale(const SimEvent& e) const;
+		void moveRed(double time);
+
+		const CStaticGeometry*  m_geometry;
+		const CLevelPack*   m_pack;
+		int                 m_packTable;
+		CBallStore          m_balls;  // yellow balls
+		CSpatialGrid        m_grid;   // live yellow balls, id = index in m_balls
+		CBall               m_white;
+		CBall               m_red;
+		CBall               m_blue;
+		std::vector<Vec2>   m_spherePos;  // layout of the yellow balls
+		CPoissonDisk        m_sampler;
+		std::vector<int>    m_candidates;  // broad phase scratch
+		CBitSet             m_struck;  // yellow balls scored in this level
+		CContactSolver      m_solver;
+
+		int                 m_ballNum;
+
+		CRandom             m_random;  // table stream
+		int                 m_spaceActivate;
+		int                 m_life;
+		int                 m_scoreBase;  // balls destroyed in the levels before this one
+		int                 m_level;
+		float               m_speed;  // launch speed of the red ball
+		bool                m_win;
+		bool                m_defeated;
+		bool                m_failed;
+		bool                m_blueActivated;  // blue ball (extra life) present
+		bool                m_continuous;
+		bool                m_dynamic;
+		bool                m_friction;
+		int                 m_substeps;
+
+		// event driven mode
+		bool                m_eventDriven;
+		std::vector<SimEvent>  m_events;  // heap, the earliest contact on top
+		double              m_time;
+		CBallMotion         m_redPath;      // of the red ball since its last contact
+		Vec2                m_redVelocity;  // velocity the path left the red ball with
+		bool                m_redAlive;
+		Vec2                m_paddleAt;     // white ball position of the paddle prediction
+		float               m_pathLength;   // of the predicted path, 0 at rest
+		unsigned int        m_redStamp, m_paddleStamp;
+		long long           m_eventCount;
+	};
+}
+
+#endif // __simCoreH__
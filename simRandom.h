@@ -0,0 +1,93 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// File: simRandom.h
+//
+// Desc: Counter-based random engine for the simulation. Value number i of a stream is the
+//       SplitMix64 finalizer applied to key + (i + 1) * golden gamma, so a stream is just a
+//       (key, counter) pair: it can be copied, jumped anywhere and split into child streams
+//       without touching any shared state.
+//
+//       Everything random takes a CRandom explicitly. One master seed gives a stream per
+//       table (stream(table)), per purpose below it (stream(STREAM_LAYOUT)) and per level or
+//       worker below that, so parallel layout generation and Monte Carlo runs are
+//       reproducible bit for bit whatever the thread schedule. Nothing uses std::rand any more.
+//
+//       Header only: the engine is a few multiplies and is inlined into the hot loops.
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __simRandomH__
+#define __simRandomH__
+
+#include <chrono>
+
+namespace sim
+{
+	const unsigned long long GOLDEN_GAMMA = 0x9e3779b97f4a7c15ull;
+
+	// SplitMix64 finalizer
+	inline unsigned long long mix64(unsigned long long z)
+	{
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+		return z ^ (z >> 31);
+	}
+
+	// purposes of the child streams below a table
+	enum {
+		STREAM_LAYOUT = 1,  // yellow ball layout
+		STREAM_BLUE = 2,    // blue ball (extra life) roll
+		STREAM_PLAYER = 3,  // scripted players and rollouts
+		STREAM_COURSE = 4   // pieces of a generated table (CStaticGeometry::makeCourse)
+	};
+
+	class CRandom {
+	public:
+		explicit CRandom(unsigned long long seed = 0)
+		{
+			m_key = mix64(seed);
+			m_counter = 0;
+		}
+
+		// independent child stream, the same id always gives the same stream
+		CRandom stream(unsigned long long id) const
+		{
+			CRandom child;
+			child.m_key = mix64(m_key ^ mix64(id * GOLDEN_GAMMA + 0x632be59bd9b4e019ull));
+			child.m_counter = 0;
+			return child;
+		}
+
+		// value number counter of the stream, without moving it
+		unsigned long long at(unsigned long long counter) const
+		{
+			return mix64(m_key + (counter + 1) * GOLDEN_GAMMA);
+		}
+
+		unsigned long long next64(void) { return at(m_counter++); }
+		unsigned int next(void) { return (unsigned int)(next64() >> 32); }
+
+		float uniform(void) { return (next() >> 8) * (1.0f / 16777216.0f); }  // [0, 1)
+		float uniform(float a, float b) { return a + uniform() * (b - a); }   // [a, b)
+
+		// [0, n), multiply-shift instead of a modulo
+		unsigned int below(unsigned int n) { return (unsigned int)(((unsigned long long)next() * n) >> 32); }
+
+		unsigned long long getCounter(void) const { return m_counter; }
+		void setCounter(unsigned long long counter) { m_counter = counter; }
+
+	private:
+		unsigned long long  m_key;
+		unsigned long long  m_counter;
+	};
+
+	// seed for interactive games, differs between two runs started in the same second
+	inline unsigned long long clockSeed(void)
+	{
+		unsigned long long t = (unsigned long long)std::chrono::high_resolution_clock::now().time_since_epoch().count();
+		unsigned long long s = (unsigned long long)std::chrono::system_clock::now().time_since_epoch().count();
+		return mix64(t ^ mix64(s));
+	}
+}
+
+#endif // __simRandomH__
@@ -0,0 +1,283 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// File: simThread.cpp
+//
+// Desc: Fixed tick simulation thread with triple buffered render snapshots.
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "simThread.h"
+#include "profiler.h"
+#include <algorithm>
+#include <cmath>
+
+// a ball that moved farther than this in one snapshot was placed, not moved (reset, level up)
+static const float TELEPORT_DISTANCE = 1.0f;
+
+//
+// Snapshot
+//
+
+sim::Snapshot::Snapshot(void)
+{
+	tick = 0;
+	time = 0;
+	red.x = red.z = 0;
+	white = blue = red;
+	redAlive = blueAlive = false;
+	life = 0;
+	level = 0;
+	destroyNum = 0;
+	launched = false;
+	win = false;
+	defeated = false;
+}
+
+void sim::Snapshot::capture(const CGame& game, long long tick, double time)
+{
+	this->tick = tick;
+	this->time = time;
+
+	red = game.getRedBall().getCenter();
+	white = game.getWhiteBall().getCenter();
+	blue = game.getBlueBall().getCenter();
+	redAlive = !game.getRedBall().isNull();
+	blueAlive = !game.getBlueBall().isNull();
+
+	// the columns keep their capacity, so this only allocates on the first capture
+	const CBallStore& balls = game.getBalls();
+	int count = balls.size();
+	x.resize(count);
+	z.resize(count);
+	for (int i = 0; i < count; i++)
+	{
+		x[i] = balls.getX(i);
+		z[i] = balls.getZ(i);
+	}
+	live = balls.getLive();
+
+	life = game.getLife();
+	level = game.getLevel();
+	destroyNum = game.getDestroyNum();
+	launched = game.isLaunched();
+	win = game.isWin();
+	defeated = game.isDefeated();
+}
+
+static float blend(float a, float b, float alpha)
+{
+	return a + (b - a) * alpha;
+}
+
+static sim::Vec2 blend(sim::Vec2 a, sim::Vec2 b, float alpha)
+{
+	if (std::fabs(b.x - a.x) + std::fabs(b.z - a.z) > TELEPORT_DISTANCE)
+		return b;
+	sim::Vec2 r = { blend(a.x, b.x, alpha), blend(a.z, b.z, alpha) };
+	return r;
+}
+
+void sim::interpolate(const Snapshot& a, const Snapshot& b, float alpha, Snapshot& out)
+{
+	out = b;
+	out.red = blend(a.red, b.red, alpha);
+	out.white = blend(a.white, b.white, alpha);
+	out.blue = blend(a.blue, b.blue, alpha);
+
+	// the yellow balls only move when they are placed for a new level
+	if (a.x.size() == b.x.size())
+	{
+		for (size_t i = 0; i < b.x.size(); i++)
+		{
+			Vec2 pa = { a.x[i], a.z[i] };
+			Vec2 pb = { b.x[i], b.z[i] };
+			Vec2 p = blend(pa, pb, alpha);
+			out.x[i] = p.x;
+			out.z[i] = p.z;
+		}
+	}
+}
+
+//
+// CSimThread
+//
+
+sim::CSimThread::CSimThread(int ballNum, int tickHz)
+	: m_game(ballNum)
+{
+	m_sampled = false;
+	m_inputHead = 0;
+	m_inputTail = 0;
+	m_quit = false;
+	m_ticks = 0;
+	m_dropped = 0;
+	m_clock = &platform::getSteadyClock();
+	m_start = m_clock->now();
+	// whole microseconds per tick, so a replay steps with the same floats
+	m_tickMicros = 1000000 / tickHz;
+	m_tickSeconds = m_tickMicros * 1e-6;
+	m_tickDelta = deltaFromMicros(m_tickMicros);
+	m_recorder = NULL;
+}
+
+sim::CSimThread::~CSimThread(void)
+{
+	stop();
+}
+
+bool sim::CSimThread::start(unsigned long long seed)
+{
+	stop();
+
+	if (!m_game.setup(seed))
+		return false;
+	if (m_recorder != NULL)
+		m_recorder->begin(m_game, seed);
+	m_inputHead = 0;
+	m_inputTail = 0;
+	m_quit = false;
+	m_ticks = 0;
+	m_dropped = 0;
+	m_start = m_clock->now();
+
+	// no thread runs yet, so every slot can be written directly
+	for (int i = 0; i < 3; i++)
+		m_snapshots.slot(i).capture(m_game, 0, 0);
+	m_snapshots.publish();
+	m_sampled = false;
+
+	m_thread = std::thread(&CSimThread::run, this);
+	return true;
+}
+
+void sim::CSimThread::stop(void)
+{
+	if (!m_thread.joinable())
+		return;
+	m_quit.store(true, std::memory_order_release);
+	m_thread.join();
+}
+
+double sim::CSimThread::now(void) const
+{
+	return (m_clock->now() - m_start) * 1e-9;
+}
+
+bool sim::CSimThread::movePaddle(int pixels)
+{
+	return pushInput(INPUT_MOVE, pixels);
+}
+
+bool sim::CSimThread::launch(void)
+{
+	return pushInput(INPUT_LAUNCH, 0);
+}
+
+bool sim::CSimThread::pushInput(int type, int pixels)
+{
+	unsigned int head = m_inputHead.load(std::memory_order_relaxed);
+	if (head - m_inputTail.load(std::memory_order_acquire) >= INPUT_QUEUE_SIZE)
+		return false;  // full, the sim thread is far behind
+
+	Input& in = m_input[head & (INPUT_QUEUE_SIZE - 1)];
+	in.type = type;
+	in.pixels = pixels;
+	m_inputHead.store(head + 1, std::memory_order_release);
+	return true;
+}
+
+void sim::CSimThread::drainInput(void)
+{
+	unsigned int tail = m_inputTail.load(std::memory_order_relaxed);
+	unsigned int head = m_inputHead.load(std::memory_order_acquire);
+	for (; tail != head; tail++)
+	{
+		const Input& in = m_input[tail & (INPUT_QUEUE_SIZE - 1)];
+		if (in.type == INPUT_MOVE)
+		{
+			m_game.movePaddle((float)in.pixels * PADDLE_STEP);
+			if (m_recorder != NULL)
+				m_recorder->movePaddle(in.pixels);
+		}
+		else
+		{
+			m_game.launch();
+			if (m_recorder != NULL)
+				m_recorder->launch();
+		}
+	}
+	m_inputTail.store(tail, std::memory_order_release);
+}
+
+void sim::CSimThread::run(void)
+{
+	prof::setThreadName("sim");
+	double last = now();
+	double simTime = 0;     // time of the last tick, follows the clock
+	double accumulator = 0;
+	long long tick = 0;
+
+	while (!m_quit.load(std::memory_order_acquire))
+	{
+		unsigned long long clock = m_clock->now();
+		double t = (clock - m_start) * 1e-9;
+		accumulator += t - last;
+		last = t;
+
+		int ticks = 0;
+		while (accumulator >= m_tickSeconds && ticks < MAX_CATCHUP_TICKS)
+		{
+			drainInput();
+			m_game.step(m_tickDelta);
+			if (m_recorder != NULL)
+				m_recorder->step(m_tickMicros);
+
+			tick++;
+			simTime += m_tickSeconds;
+			accumulator -= m_tickSeconds;
+			ticks++;
+
+			m_snapshots.back().capture(m_game, tick, simTime);
+			m_snapshots.publish();
+		}
+		m_ticks.store(tick, std::memory_order_relaxed);
+
+		if (accumulator >= m_tickSeconds)
+		{
+			// the simulation can not keep up: drop the backlog instead of spiralling, the game
+			// runs slower than real time but every tick still uses the same step
+			long long dropped = (long long)(accumulator / m_tickSeconds);
+			m_dropped.fetch_add(dropped, std::memory_order_relaxed);
+			accumulator -= dropped * m_tickSeconds;
+			simTime += dropped * m_tickSeconds;
+		}
+
+		// at least a nanosecond, so a virtual clock that jumps to the wake up time always moves
+		m_clock->sleepUntil(clock + (unsigned long long)((m_tickSeconds - accumulator) * 1e9) + 1);
+	}
+}
+
+bool sim::CSimThread::sample(Snapshot& out)
+{
+	while (m_snapshots.update())
+	{
+		if (m_sampled)
+			m_prev = m_curr;
+		m_curr = m_snapshots.front();
+		if (!m_sampled)
+			m_prev = m_curr;
+		m_sampled = true;
+	}
+	if (!m_sampled)
+		return false;
+
+	// render one tick in the past, so there are two snapshots around the render time
+	double renderTime = now() - m_tickSeconds;
+	double span = m_curr.time - m_prev.time;
+	float alpha = 1;
+	if (span > 0)
+		alpha = (float)std::min(std::max((renderTime - m_prev.time) / span, 0.0), 1.0);
+
+	interpolate(m_prev, m_curr, alpha, out);
+	return true;
+}
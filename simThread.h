@@ -0,0 +1,174 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// File: simThread.h
+//
+// Desc: Runs a CGame on its own thread at a fixed tick rate. The thread advances the game with
+//       an accumulator (the same step every tick, whatever the render frame rate) and publishes
+//       a Snapshot of the game after each tick through a lock-free triple buffer. The render
+//       thread samples the two most recent snapshots and interpolates the ball positions, so a
+//       slow frame does not change the physics and slow physics does not stall the frame.
+//
+//       Player input goes the other way through a single producer/single consumer queue and
+//       is applied at the start of the next tick. The sim thread can record the input it
+//       applies and its ticks into a CReplayWriter.
+//
+//       The ticks follow a platform::IClock, the steady clock unless setClock() gives another:
+//       on a CVirtualClock the thread runs as many times faster as the clock does.
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __simThreadH__
+#define __simThreadH__
+
+#include "platform.h"
+#include "replay.h"
+#include "simCore.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace sim
+{
+	const int SIM_TICK_HZ = 120;          // default simulation rate
+	const int MAX_CATCHUP_TICKS = 8;      // ticks run back to back before the backlog is dropped
+	const int INPUT_QUEUE_SIZE = 1024;    // power of two
+
+	//
+	// Game state as seen by the renderer
+	//
+
+	struct Snapshot
+	{
+		long long                   tick;
+		double                      time;  // seconds on the CSimThread clock
+
+		Vec2                        red, white, blue;
+		bool                        redAlive, blueAlive;
+		std::vector<float>          x, z;  // yellow balls
+		std::vector<int>            live;  // indices of the live yellow balls, in no order
+
+		int                         life;
+		int                         level;
+		int                         destroyNum;
+		bool                        launched;
+		bool                        win;
+		bool                        defeated;
+
+		Snapshot(void);
+
+		void capture(const CGame& game, long long tick, double time);
+	};
+
+	// positions of a and b blended by alpha (0 = a, 1 = b), everything else taken from b
+	void interpolate(const Snapshot& a, const Snapshot& b, float alpha, Snapshot& out);
+
+	//
+	// Lock-free triple buffer, one writer and one reader. The writer fills back() and
+	// publishes it; the reader picks up the latest published slot with update(). Neither
+	// side ever waits, and a slot is never touched by both threads at once.
+	//
+
+	template <class T> class CTripleBuffer {
+	public:
+		CTripleBuffer(void) : m_back(0), m_middle(1), m_front(2) {}
+
+		// writer side
+		T& back(void) { return m_slot[m_back]; }
+		void publish(void) { m_back = m_middle.exchange(m_back | FRESH, std::memory_order_acq_rel) & INDEX; }
+
+		// reader side, returns false when nothing new was published since the last call
+		bool update(void)
+		{
+			if (!(m_middle.load(std::memory_order_relaxed) & FRESH))
+				return false;
+			m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & INDEX;
+			return true;
+		}
+		const T& front(void) const { return m_slot[m_front]; }
+
+		// only while no thread uses the buffer
+		T& slot(int i) { return m_slot[i]; }
+
+	private:
+		enum { INDEX = 3, FRESH = 4 };
+
+		T                   m_slot[3];
+		int                 m_back;
+		char                m_pad0[64];
+		std::atomic<int>    m_middle;  // slot index, FRESH when published and not read yet
+		char                m_pad1[64];
+		int                 m_front;
+	};
+
+	//
+	// Simulation thread
+	//
+
+	class CSimThread {
+	public:
+		CSimThread(int ballNum = BALLNUM, int tickHz = SIM_TICK_HZ);
+		~CSimThread(void);
+
+		// sets the game up and publishes its first snapshot before the thread starts,
+		// so sample() has a state to return as soon as start() returns; false when the
+		// game could not be set up (the thread is not started)
+		bool start(unsigned long long seed);
+		void stop(void);
+		bool isRunning(void) const { return m_thread.joinable(); }
+		CGame& getGame(void) { return m_game; }  // for settings before start(), the thread owns it after
+
+		// records the game from start() on, NULL: no recording. Set it before start() and
+		// read it after stop(), the sim thread writes it in between.
+		void setRecorder(CReplayWriter* recorder) { m_recorder = recorder; }
+		// the clock of the ticks, before start(); NULL: the steady clock
+		void setClock(platform::IClock* clock) { m_clock = clock != NULL ? clock : &platform::getSteadyClock(); }
+
+		// player input, from the window thread
+		bool movePaddle(int pixels);  // mouse dx, PADDLE_STEP world units per pixel
+		bool launch(void);
+
+		// render side: interpolated state one tick behind now, false before start()
+		bool sample(Snapshot& out);
+
+		double now(void) const;  // seconds since start()
+		double getTickSeconds(void) const { return m_tickSeconds; }
+		long long getTicks(void) const { return m_ticks.load(std::memory_order_relaxed); }
+		long long getDroppedTicks(void) const { return m_dropped.load(std::memory_order_relaxed); }
+
+	private:
+		enum { INPUT_MOVE, INPUT_LAUNCH };
+
+		struct Input
+		{
+			int             type;
+			int             pixels;
+		};
+
+		void run(void);
+		bool pushInput(int type, int pixels);
+		void drainInput(void);
+
+		CGame                       m_game;  // owned by the sim thread once started
+		CTripleBuffer<Snapshot>     m_snapshots;
+		Snapshot                    m_prev, m_curr;  // render side
+		bool                        m_sampled;
+
+		Input                       m_input[INPUT_QUEUE_SIZE];
+		std::atomic<unsigned int>   m_inputHead;  // written by the window thread
+		std::atomic<unsigned int>   m_inputTail;  // written by the sim thread
+
+		std::thread                 m_thread;
+		std::atomic<bool>           m_quit;
+		std::atomic<long long>      m_ticks;
+		std::atomic<long long>      m_dropped;
+		platform::IClock*           m_clock;
+		unsigned long long          m_start;  // nanoseconds of m_clock
+
+		double                      m_tickSeconds;
+		unsigned int                m_tickMicros;
+		float                       m_tickDelta;  // game time per tick
+		CReplayWriter*              m_recorder;
+	};
+}
+
+#endif // __simThreadH__
@@ -0,0 +1,427 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// File: softRaster.cpp
+//
+// Desc: Tiled software rasterizer with per-vertex point lighting.
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "softRaster.h"
+#include "profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RASTER_SSE 1
+#include <emmintrin.h>
+#endif
+
+static const float SUBPIXEL = 16;  // vertices are snapped to 1/16 pixel
+
+render::CSoftBackend::CSoftBackend(int width, int height)
+{
+	m_width = std::max(1, width);
+	m_height = std::max(1, height);
+	m_stride = (m_width + 3) & ~3;
+	m_tilesX = (m_width + RASTER_TILE - 1) / RASTER_TILE;
+	m_tilesY = (m_height + RASTER_TILE - 1) / RASTER_TILE;
+	m_color.assign((size_t)m_stride * m_height, 0);
+	m_depth.assign((size_t)m_stride * m_height, 1.0f);
+	m_bins.resize((size_t)m_tilesX * m_tilesY);
+	m_clearColor = 0x00afafaf;  // Display()
+
+	m_pool = NULL;
+	m_cache = NULL;
+	setIdentity(m_view);
+	setIdentity(m_proj);
+	PointLight none = {};
+	setLight(none);
+	Color white = { 1, 1, 1, 1 };
+	m_material = makeMaterial(white, 5.0f);
+	m_stats.triangles = m_stats.rasterized = m_stats.binned = 0;
+}
+
+void render::CSoftBackend::setCamera(const Matrix& view, const Matrix& proj)
+{
+	m_view = view;
+	m_proj = proj;
+	setLight(m_light);  // the light is kept in view space
+}
+
+void render::CSoftBackend::setLight(const PointLight& light)
+{
+	m_light = light;
+	const float* p = light.position;
+	for (int c = 0; c < 3; c++)
+		m_lightView[c] = p[0] * m_view.m[0][c] + p[1] * m_view.m[1][c] + p[2] * m_view.m[2][c] + m_view.m[3][c];
+}
+
+void render::CSoftBackend::beginFrame(void)
+{
+	m_triangles.clear();
+	for (size_t i = 0; i < m_bins.size(); i++)
+		m_bins[i].clear();
+}
+
+void render::CSoftBackend::setMaterial(int, const Material& material)
+{
+	m_material = material;
+}
+
+void render::CSoftBackend::drawInstances(int mesh, const Matrix* worlds, int count)
+{
+	if (m_cache == NULL || !m_cache->isLive(mesh))
+		return;
+	const Geometry& g = m_cache->getGeometry(mesh);
+	m_vertices.resize(g.vertices.size());
+
+	for (int i = 0; i < count; i++)
+	{
+		Matrix worldView;
+		multiply(worldView, worlds[i], m_view);
+		for (size_t v = 0; v < g.vertices.size(); v++)
+			light(g.vertices[v], worldView, m_vertices[v]);
+
+		for (size_t t = 0; t < g.indices.size(); t += 3)
+			clipTriangle(m_vertices[g.indices[t]], m_vertices[g.indices[t + 1]], m_vertices[g.indices[t + 2]]);
+		m_stats.triangles += g.getTriangleCount();
+	}
+}
+
+// the fixed function vertex pipeline in view space, D3DRS_LOCALVIEWER on
+void render::CSoftBackend::light(const Vertex& v, const Matrix& wv, ClipVertex& out) const
+{
+	float p[3], n[3];
+	for (int c = 0; c < 3; c++)
+	{
+		p[c] = v.x * wv.m[0][c] + v.y * wv.m[1][c] + v.z * wv.m[2][c] + wv.m[3][c];
+		n[c] = v.nx * wv.m[0][c] + v.ny * wv.m[1][c] + v.nz * wv.m[2][c];
+	}
+	const Matrix& P = m_proj;
+	out.x = p[0] * P.m[0][0] + p[1] * P.m[1][0] + p[2] * P.m[2][0] + P.m[3][0];
+	out.y = p[0] * P.m[0][1] + p[1] * P.m[1][1] + p[2] * P.m[2][1] + P.m[3][1];
+	out.z = p[0] * P.m[0][2] + p[1] * P.m[1][2] + p[2] * P.m[2][2] + P.m[3][2];
+	out.w = p[0] * P.m[0][3] + p[1] * P.m[1][3] + p[2] * P.m[2][3] + P.m[3][3];
+
+	float ambient = 0, diffuse = 0, specular = 0;  // scales of the light colours
+	float l[3] = { m_lightView[0] - p[0], m_lightView[1] - p[1], m_lightView[2] - p[2] };
+	float d = std::sqrt(l[0] * l[0] + l[1] * l[1] + l[2] * l[2]);
+	float attenuation = m_light.attenuation0 + m_light.attenuation1 * d + m_light.attenuation2 * d * d;
+	if (d <= m_light.range && d > 0 && attenuation > 0)
+	{
+		attenuation = 1 / attenuation;
+		ambient = attenuation;
+		for (int c = 0; c < 3; c++)
+			l[c] /= d;
+		float nl = n[0] * l[0] + n[1] * l[1] + n[2] * l[2];
+		if (nl > 0)
+		{
+			diffuse = nl * attenuation;
+
+			// half vector of the light and the eye directions
+			float e = std::sqrt(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+			float h[3];
+			for (int c = 0; c < 3; c++)
+				h[c] = l[c] - (e > 0 ? p[c] / e : 0);
+			float hl = std::sqrt(h[0] * h[0] + h[1] * h[1] + h[2] * h[2]);
+			float nh = hl > 0 ? (n[0] * h[0] + n[1] * h[1] + n[2] * h[2]) / hl : 0;
+			if (nh > 0)
+				specular = std::pow(nh, m_material.power) * attenuation;
+		}
+	}
+
+	const Material& m = m_material;
+	const PointLight& li = m_light;
+	out.r = m.emissive.r + m.ambient.r * li.ambient.r * ambient + m.diffuse.r * li.diffuse.r * diffuse +
+		m.specular.r * li.specular.r * specular;
+	out.g = m.emissive.g + m.ambient.g * li.ambient.g * ambient + m.diffuse.g * li.diffuse.g * diffuse +
+		m.specular.g * li.specular.g * specular;
+	out.b = m.emissive.b + m.ambient.b * li.ambient.b * ambient + m.diffuse.b * li.diffuse.b * diffuse +
+		m.specular.b * li.specular.b * specular;
+	out.r = std::min(std::max(out.r, 0.0f), 1.0f);
+	out.g = std::min(std::max(out.g, 0.0f), 1.0f);
+	out.b = std::min(std::max(out.b, 0.0f), 1.0f);
+}
+
+// a point of the edge from a (inside) to b (outside) on the near plane z = 0
+template <class V> static V nearPoint(const V& a, const V& b)
+{
+	float t = a.z / (a.z - b.z);
+	V v;
+	v.x = a.x + (b.x - a.x) * t;
+	v.y = a.y + (b.y - a.y) * t;
+	v.z = 0;
+	v.w = a.w + (b.w - a.w) * t;
+	v.r = a.r + (b.r - a.r) * t;
+	v.g = a.g + (b.g - a.g) * t;
+	v.b = a.b + (b.b - a.b) * t;
+	return v;
+}
+
+void render::CSoftBackend::clipTriangle(const ClipVertex& a, const ClipVertex& b, const ClipVertex& c)
+{
+	// outside one of the side planes as a whole
+	if ((a.x > a.w && b.x > b.w && c.x > c.w) || (a.x < -a.w && b.x < -b.w && c.x < -c.w) ||
+		(a.y > a.w && b.y > b.w && c.y > c.w) || (a.y < -a.w && b.y < -b.w && c.y < -c.w) ||
+		(a.z > a.w && b.z > b.w && c.z > c.w))
+	{
+		return;
+	}
+
+	int inside = (a.z >= 0) + (b.z >= 0) + (c.z >= 0);
+	if (inside == 3)
+	{
+		setupTriangle(a, b, c);
+		return;
+	}
+	if (inside == 0)
+		return;
+
+	// one plane clips a triangle into a triangle or a quad; the order of the corners is kept
+	const ClipVertex* in[3] = { &a, &b, &c };
+	ClipVertex poly[4];
+	int n = 0;
+	for (int i = 0; i < 3; i++)
+	{
+		const ClipVertex& p = *in[i];
+		const ClipVertex& q = *in[(i + 1) % 3];
+		if (p.z >= 0)
+			poly[n++] = p;
+		if ((p.z >= 0) != (q.z >= 0))
+			poly[n++] = p.z >= 0 ? nearPoint(p, q) : nearPoint(q, p);
+	}
+	for (int i = 1; i + 1 < n; i++)
+		setupTriangle(poly[0], poly[i], poly[i + 1]);
+}
+
+void render::CSoftBackend::setupTriangle(const ClipVertex& a, const ClipVertex& b, const ClipVertex& c)
+{
+	const ClipVertex* v[3] = { &a, &b, &c };
+	float x[3], y[3], z[3], iw[3], r[3], g[3], bl[3];
+	for (int i = 0; i < 3; i++)
+	{
+		iw[i] = 1 / v[i]->w;
+		// Direct3D 9 viewport, pixel centres on integer coordinates
+		x[i] = std::floor(((v[i]->x * iw[i] + 1) * 0.5f * m_width) * SUBPIXEL + 0.5f) / SUBPIXEL;
+		y[i] = std::floor(((1 - v[i]->y * iw[i]) * 0.5f * m_height) * SUBPIXEL + 0.5f) / SUBPIXEL;
+		z[i] = v[i]->z * iw[i];
+		r[i] = v[i]->r * iw[i];
+		g[i] = v[i]->g * iw[i];
+		bl[i] = v[i]->b * iw[i];
+	}
+
+	// clockwise on screen (y down) is front facing, D3DCULL_CCW drops the rest
+	float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+	if (!(area > 0))
+		return;
+
+	Triangle t;
+	t.minX = std::max(0, (int)std::ceil(std::min(x[0], std::min(x[1], x[2]))));
+	t.minY = std::max(0, (int)std::ceil(std::min(y[0], std::min(y[1], y[2]))));
+	t.maxX = std::min(m_width - 1, (int)std::floor(std::max(x[0], std::max(x[1], x[2]))));
+	t.maxY = std::min(m_height - 1, (int)std::floor(std::max(y[0], std::max(y[1], y[2]))));
+	if (t.minX > t.maxX || t.minY > t.maxY)
+		return;
+
+	for (int i = 0; i < 3; i++)
+	{
+		int j = (i + 1) % 3;
+		float dx = x[j] - x[i], dy = y[j] - y[i];
+		t.edge[i].a = -dy;
+		t.edge[i].b = dx;
+		t.edge[i].c = dy * x[i] - dx * y[i];
+		bool topLeft = (dy == 0 && dx > 0) || dy < 0;
+		t.strict[i] = topLeft ? 0u : ~0u;
+	}
+
+	// value = a * x + b * y + c through the three corners
+	const float* values[5] = { z, iw, r, g, bl };
+	Plane* planes[5] = { &t.z, &t.w, &t.r, &t.g, &t.b };
+	for (int k = 0; k < 5; k++)
+	{
+		const float* f = values[k];
+		Plane& p = *planes[k];
+		p.a = ((f[1] - f[0]) * (y[2] - y[0]) - (f[2] - f[0]) * (y[1] - y[0])) / area;
+		p.b = ((f[2] - f[0]) * (x[1] - x[0]) - (f[1] - f[0]) * (x[2] - x[0])) / area;
+		p.c = f[0] - p.a * x[0] - p.b * y[0];
+	}
+
+	int index = (int)m_triangles.size();
+	m_triangles.push_back(t);
+	m_stats.rasterized++;
+	for (int ty = t.minY / RASTER_TILE; ty <= t.maxY / RASTER_TILE; ty++)
+	{
+		for (int tx = t.minX / RASTER_TILE; tx <= t.maxX / RASTER_TILE; tx++)
+		{
+			m_bins[(size_t)ty * m_tilesX + tx].push_back(index);
+			m_stats.binned++;
+		}
+	}
+}
+
+void render::CSoftBackend::endFrame(void)
+{
+	auto job = [this](int begin, int end, int) {
+		for (int tile = begin; tile < end; tile++)
+			rasterizeTile(tile);
+	};
+	int tiles = m_tilesX * m_tilesY;
+	if (m_pool != NULL)
+		m_pool->parallelFor(tiles, 1, job);
+	else
+		job(0, tiles, 0);
+}
+
+void render::CSoftBackend::rasterizeTile(int tile)
+{
+	PROF_ZONE("tile");
+	int x0 = tile % m_tilesX * RASTER_TILE, y0 = tile / m_tilesX * RASTER_TILE;
+	int x1 = std::min(x0 + RASTER_TILE, m_width) - 1, y1 = std::min(y0 + RASTER_TILE, m_height) - 1;
+
+	for (int y = y0; y <= y1; y++)
+	{
+		size_t row = (size_t)y * m_stride;
+		std::fill(m_color.begin() + row + x0, m_color.begin() + row + x1 + 1, m_clearColor);
+		std::fill(m_depth.begin() + row + x0, m_depth.begin() + row + x1 + 1, 1.0f);
+	}
+
+	const std::vector<int>& bin = m_bins[tile];
+	for (size_t i = 0; i < bin.size(); i++)
+	{
+		const Triangle& t = m_triangles[bin[i]];
+		rasterize(t, std::max(x0, t.minX), std::max(y0, t.minY), std::min(x1, t.maxX), std::min(y1, t.maxY));
+	}
+}
+
+// pixels of t inside [x0, x1] x [y0, y1] that pass the depth test
+void render::CSoftBackend::rasterize(const Triangle& t, int x0, int y0, int x1, int y1)
+{
+#ifdef RASTER_SSE
+	const __m128 lane = _mm_set_ps(3, 2, 1, 0);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1);
+	const __m128 scale = _mm_set1_ps(255);
+	const __m128i alpha = _mm_set1_epi32((int)0xff000000);
+
+	__m128 ea[3], strict[3];
+	for (int i = 0; i < 3; i++)
+	{
+		ea[i] = _mm_set1_ps(t.edge[i].a);
+		strict[i] = _mm_castsi128_ps(_mm_set1_epi32((int)t.strict[i]));
+	}
+	const __m128 za = _mm_set1_ps(t.z.a), wa = _mm_set1_ps(t.w.a);
+	const __m128 ra = _mm_set1_ps(t.r.a), ga = _mm_set1_ps(t.g.a), ba = _mm_set1_ps(t.b.a);
+
+	// the tiles start on a multiple of 4 and the rows are padded to one, so a block of four
+	// pixels never leaves its tile; the lanes outside the triangle fail the edge test
+	for (int y = y0; y <= y1; y++)
+	{
+		float fy = (float)y;
+		__m128 erow[3];
+		for (int i = 0; i < 3; i++)
+			erow[i] = _mm_set1_ps(t.edge[i].b * fy + t.edge[i].c);
+		const __m128 zrow = _mm_set1_ps(t.z.b * fy + t.z.c), wrow = _mm_set1_ps(t.w.b * fy + t.w.c);
+		const __m128 rrow = _mm_set1_ps(t.r.b * fy + t.r.c), grow = _mm_set1_ps(t.g.b * fy + t.g.c);
+		const __m128 brow = _mm_set1_ps(t.b.b * fy + t.b.c);
+		unsigned int* color = &m_color[(size_t)y * m_stride];
+		float* depth = &m_depth[(size_t)y * m_stride];
+
+		for (int x = x0 & ~3; x <= x1; x += 4)
+		{
+			__m128 px = _mm_add_ps(_mm_set1_ps((float)x), lane);
+
+			// inside: every edge >= 0, and > 0 on the edges that are not top or left
+			__m128 mask = _mm_castsi128_ps(_mm_set1_epi32(-1));
+			for (int i = 0; i < 3; i++)
+			{
+				__m128 e = _mm_add_ps(_mm_mul_ps(ea[i], px), erow[i]);
+				__m128 on = _mm_and_ps(_mm_cmpeq_ps(e, zero), strict[i]);
+				mask = _mm_and_ps(mask, _mm_andnot_ps(on, _mm_cmpge_ps(e, zero)));
+			}
+			if (_mm_movemask_ps(mask) == 0)
+				continue;
+
+			__m128 z = _mm_add_ps(_mm_mul_ps(za, px), zrow);
+			__m128 d = _mm_loadu_ps(depth + x);
+			mask = _mm_and_ps(mask, _mm_cmple_ps(z, d));
+			if (_mm_movemask_ps(mask) == 0)
+				continue;
+			_mm_storeu_ps(depth + x, _mm_or_ps(_mm_and_ps(mask, z), _mm_andnot_ps(mask, d)));
+
+			// perspective correct colour
+			__m128 w = _mm_div_ps(one, _mm_add_ps(_mm_mul_ps(wa, px), wrow));
+			__m128 r = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(ra, px), rrow), w);
+			__m128 g = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(ga, px), grow), w);
+			__m128 b = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(ba, px), brow), w);
+			__m128i ri = _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(r, zero), one), scale));
+			__m128i gi = _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(g, zero), one), scale));
+			__m128i bi = _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(b, zero), one), scale));
+			__m128i pixel = _mm_or_si128(_mm_or_si128(alpha, _mm_slli_epi32(ri, 16)),
+				_mm_or_si128(_mm_slli_epi32(gi, 8), bi));
+
+			__m128i m = _mm_castps_si128(mask);
+			__m128i old = _mm_loadu_si128((const __m128i*)(color + x));
+			_mm_storeu_si128((__m128i*)(color + x), _mm_or_si128(_mm_and_si128(m, pixel), _mm_andnot_si128(m, old)));
+		}
+	}
+#else
+	for (int y = y0; y <= y1; y++)
+	{
+		float fy = (float)y;
+		unsigned int* color = &m_color[(size_t)y * m_stride];
+		float* depth = &m_depth[(size_t)y * m_stride];
+		for (int x = x0; x <= x1; x++)
+		{
+			float fx = (float)x;
+			bool inside = true;
+			for (int i = 0; i < 3 && inside; i++)
+			{
+				float e = t.edge[i].a * fx + t.edge[i].b * fy + t.edge[i].c;
+				inside = e > 0 || (e == 0 && t.strict[i] == 0);
+			}
+			if (!inside)
+				continue;
+
+			float z = t.z.a * fx + t.z.b * fy + t.z.c;
+			if (!(z <= depth[x]))
+				continue;
+			depth[x] = z;
+
+			float w = 1 / (t.w.a * fx + t.w.b * fy + t.w.c);
+			float rgb[3] = {
+				(t.r.a * fx + t.r.b * fy + t.r.c) * w,
+				(t.g.a * fx + t.g.b * fy + t.g.c) * w,
+				(t.b.a * fx + t.b.b * fy + t.b.c) * w,
+			};
+			unsigned int pixel = 0xff000000u;
+			for (int c = 0; c < 3; c++)
+				pixel |= (unsigned int)(std::min(std::max(rgb[c], 0.0f), 1.0f) * 255 + 0.5f) << (16 - 8 * c);
+			color[x] = pixel;
+		}
+	}
+#endif
+}
+
+bool render::CSoftBackend::writePPM(const char* path) const
+{
+	FILE* file = fopen(path, "wb");
+	if (file == NULL)
+		return false;
+
+	fprintf(file, "P6\n%d %d\n255\n", m_width, m_height);
+	std::vector<unsigned char> row((size_t)m_width * 3);
+	bool ok = true;
+	for (int y = 0; y < m_height && ok; y++)
+	{
+		for (int x = 0; x < m_width; x++)
+		{
+			unsigned int pixel = getPixel(x, y);
+			row[x * 3 + 0] = (unsigned char)(pixel >> 16);
+			row[x * 3 + 1] = (unsigned char)(pixel >> 8);
+			row[x * 3 + 2] = (unsigned char)pixel;
+		}
+		ok = fwrite(row.data(), 1, row.size(), file) == row.size();
+	}
+	return fclose(file) == 0 && ok;
+}
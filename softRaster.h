@@ -0,0 +1,114 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// File: softRaster.h
+//
+// Desc: Software rasterizer backend of the render command list, for frames without a GPU.
+//       It follows the fixed function pipeline Setup() configures: per-vertex lighting by one
+//       point light (ambient, diffuse and specular, D3DSHADE_GOURAUD), counter-clockwise faces
+//       culled, a depth buffer with D3DCMP_LESSEQUAL, and Direct3D 9 pixel centres.
+//
+//       drawInstances() transforms and lights the vertices, clips the triangles against the
+//       near plane and bins them into RASTER_TILE square screen tiles. endFrame() then
+//       rasterizes the tiles in parallel on a CWorkPool: each tile clears its part of the
+//       buffers and walks its bin in submission order, so the image does not depend on the
+//       number of threads. Coverage, depth and colour are evaluated four pixels at a time with
+//       SSE2 where the compiler has it, with a scalar fallback.
+//
+//       Pixels are 0xAARRGGBB like D3DCOLOR, top row first.
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __softRasterH__
+#define __softRasterH__
+
+#include "meshCache.h"
+#include "renderList.h"
+#include "workPool.h"
+#include <vector>
+
+namespace render
+{
+	const int RASTER_TILE = 64;  // pixels, a multiple of 4
+
+	struct RasterStats
+	{
+		long long           triangles;  // submitted
+		long long           rasterized; // past clipping and culling
+		long long           binned;     // triangle and tile pairs
+	};
+
+	class CSoftBackend : public IRenderBackend {
+	public:
+		CSoftBackend(int width, int height);
+
+		void setPool(sim::CWorkPool* pool) { m_pool = pool; }  // NULL: on the calling thread
+		void setMeshes(const CMeshCache* cache) { m_cache = cache; }
+		void setCamera(const Matrix& view, const Matrix& proj);
+		void setLight(const PointLight& light);
+		void setClearColor(unsigned int argb) { m_clearColor = argb; }
+
+		// drops the triangles of the last frame
+		void beginFrame(void);
+		void setMaterial(int id, const Material& material);
+		void drawInstances(int mesh, const Matrix* worlds, int count);
+		// there is no font to sample, the HUD is left out
+		void drawText(const GlyphQuad*, int) {}
+		// rasterizes the binned triangles into the frame buffer
+		void endFrame(void);
+
+		int getWidth(void) const { return m_width; }
+		int getHeight(void) const { return m_height; }
+		unsigned int getPixel(int x, int y) const { return m_color[(size_t)y * m_stride + x]; }
+		bool writePPM(const char* path) const;
+
+		const RasterStats& getStats(void) const { return m_stats; }  // since construction
+
+	private:
+		struct ClipVertex
+		{
+			float           x, y, z, w;
+			float           r, g, b;
+		};
+
+		// screen space planes a * x + b * y + c
+		struct Plane
+		{
+			float           a, b, c;
+		};
+
+		struct Triangle
+		{
+			Plane           edge[3];
+			unsigned int    strict[3];  // ~0: a pixel exactly on the edge is outside
+			Plane           z, w, r, g, b;  // depth, 1/w and colour/w
+			int             minX, minY, maxX, maxY;
+		};
+
+		void light(const Vertex& v, const Matrix& worldView, ClipVertex& out) const;
+		void clipTriangle(const ClipVertex& a, const ClipVertex& b, const ClipVertex& c);
+		void setupTriangle(const ClipVertex& a, const ClipVertex& b, const ClipVertex& c);
+		void rasterizeTile(int tile);
+		void rasterize(const Triangle& t, int x0, int y0, int x1, int y1);
+
+		int                 m_width, m_height;
+		int                 m_stride;  // pixels per row, a multiple of 4
+		int                 m_tilesX, m_tilesY;
+		std::vector<unsigned int>   m_color;
+		std::vector<float>  m_depth;
+		unsigned int        m_clearColor;
+
+		sim::CWorkPool*     m_pool;
+		const CMeshCache*   m_cache;
+		Matrix              m_view, m_proj;
+		PointLight          m_light;
+		float               m_lightView[3];  // light position in view space
+		Material            m_material;
+
+		std::vector<ClipVertex>         m_vertices;  // of the current instance
+		std::vector<Triangle>           m_triangles;
+		std::vector<std::vector<int> >  m_bins;      // triangle indices per tile
+		RasterStats         m_stats;
+	};
+}
+
+#endif // __softRasterH__
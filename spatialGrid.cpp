@@ -0,0 +1,87 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// File: spatialGrid.cpp
+//
+// Desc: Uniform grid over the table for the ball broad phase.
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "spatialGrid.h"
+
+sim::CSpatialGrid::CSpatialGrid(void)
+{
+	m_xMin = 0;
+	m_zMin = 0;
+	m_invCell = 1;
+	m_cols = 1;
+	m_rows = 1;
+	m_head.assign(1, -1);
+}
+
+void sim::CSpatialGrid::init(float xMin, float zMin, float xMax, float zMax, float cellSize)
+{
+	m_xMin = xMin;
+	m_zMin = zMin;
+	m_invCell = 1 / cellSize;
+	m_cols = (int)std::ceil((xMax - xMin) * m_invCell);
+	m_rows = (int)std::ceil((zMax - zMin) * m_invCell);
+	if (m_cols < 1) m_cols = 1;
+	if (m_rows < 1) m_rows = 1;
+
+	m_head.assign(m_cols * m_rows, -1);
+	m_next.clear();
+	m_prev.clear();
+	m_cell.clear();
+}
+
+void sim::CSpatialGrid::clear(void)
+{
+	m_head.assign(m_cols * m_rows, -1);
+	m_cell.assign(m_cell.size(), -1);
+}
+
+void sim::CSpatialGrid::insert(int id, float x, float z)
+{
+	if (id >= (int)m_cell.size())
+	{
+		m_next.resize(id + 1, -1);
+		m_prev.resize(id + 1, -1);
+		m_cell.resize(id + 1, -1);
+	}
+	else if (m_cell[id] >= 0)
+	{
+		remove(id);
+	}
+
+	int cell = cellOf(x, z);
+	int head = m_head[cell];
+	m_prev[id] = -1;
+	m_next[id] = head;
+	if (head >= 0)
+		m_prev[head] = id;
+	m_head[cell] = id;
+	m_cell[id] = cell;
+}
+
+void sim::CSpatialGrid::remove(int id)
+{
+	if (!contains(id))
+		return;
+
+	int prev = m_prev[id];
+	int next = m_next[id];
+	if (prev >= 0)
+		m_next[prev] = next;
+	else
+		m_head[m_cell[id]] = next;
+	if (next >= 0)
+		m_prev[next] = prev;
+	m_cell[id] = -1;
+}
+
+void sim::CSpatialGrid::move(int id, float x, float z)
+{
+	if (contains(id) && m_cell[id] == cellOf(x, z))
+		return;
+	insert(id, x, z);
+}
@@ -0,0 +1,75 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// File: spatialGrid.h
+//
+// Desc: Uniform grid over the table for the ball broad phase. Every ball id is linked into the
+//       cell that holds its center; a query visits the cells overlapped by a circle, so the cost
+//       of a query depends on the local ball density and not on the number of balls. Positions
+//       outside the grid are kept in the border cells, so the grid stays correct for balls that
+//       leave the table area.
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __spatialGridH__
+#define __spatialGridH__
+
+#include <vector>
+#include <cmath>
+
+namespace sim
+{
+	class CSpatialGrid {
+	public:
+		CSpatialGrid(void);
+
+		void init(float xMin, float zMin, float xMax, float zMax, float cellSize);
+		void clear(void);  // removes every id, keeps the cells
+
+		void insert(int id, float x, float z);
+		void remove(int id);
+		void move(int id, float x, float z);  // relinks the id only when its cell changed
+		bool contains(int id) const { return id < (int)m_cell.size() && m_cell[id] >= 0; }
+
+		// calls visit(id) for every id in the cells overlapped by the square of half size reach
+		template <class F> void query(float x, float z, float reach, F visit) const
+		{
+			int c0 = column(x - reach), c1 = column(x + reach);
+			int r0 = row(z - reach), r1 = row(z + reach);
+			for (int r = r0; r <= r1; r++)
+			{
+				for (int c = c0; c <= c1; c++)
+				{
+					for (int id = m_head[r * m_cols + c]; id >= 0; id = m_next[id])
+						visit(id);
+				}
+			}
+		}
+
+		int getColumns(void) const { return m_cols; }
+		int getRows(void) const { return m_rows; }
+
+	private:
+		int column(float x) const
+		{
+			int c = (int)std::floor((x - m_xMin) * m_invCell);
+			return c < 0 ? 0 : (c >= m_cols ? m_cols - 1 : c);
+		}
+		int row(float z) const
+		{
+			int r = (int)std::floor((z - m_zMin) * m_invCell);
+			return r < 0 ? 0 : (r >= m_rows ? m_rows - 1 : r);
+		}
+		int cellOf(float x, float z) const { return row(z) * m_cols + column(x); }
+
+		float               m_xMin, m_zMin;
+		float               m_invCell;
+		int                 m_cols, m_rows;
+
+		std::vector<int>    m_head;  // first id of every cell, -1 when empty
+		std::vector<int>    m_next;  // per id links inside its cell
+		std::vector<int>    m_prev;
+		std::vector<int>    m_cell;  // per id cell, -1 when not in the grid
+	};
+}
+
+#endif // __spatialGridH__
@@ -0,0 +1,452 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// File: staticGeometry.cpp
+//
+// Desc: Fixed pieces of the table in a bounding volume hierarchy.
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "staticGeometry.h"
+#include "poissonDisk.h"
+#include "simCore.h"
+#include "sweepTest.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+static const float COURSE_BUMPER = 0.4f;     // length of a bumper of makeCourse
+static const float COURSE_THICKNESS = 0.1f;  // of a bumper
+static const float COURSE_POCKET = 0.25f;    // radius of a pocket of makeCourse
+static const float COURSE_GAP = 0.35f;       // between two pieces, wider than a ball
+
+//
+// Box contact
+//
+
+bool sim::boxOverlaps(float x, float z, float r, float cx, float cz, float width, float depth)
+{
+	float wallXmin = cx - (width / 2 + r);
+	float wallXmax = cx + (width / 2 + r);
+	float wallZmin = cz - (depth / 2 + r);
+	float wallZmax = cz + (depth / 2 + r);
+
+	return (wallXmin <= x && x <= wallXmax) && (wallZmin <= z && z <= wallZmax);
+}
+
+void sim::hitBox(float& x, float& z, float& vx, float& vz, float r, float cx, float cz, float width, float depth)
+{
+	if (!boxOverlaps(x, z, r, cx, cz, width, depth))
+		return;
+
+	float ballX = x;
+	float ballZ = z;
+
+	float wallXmin = cx - (width / 2);
+	float wallXmax = cx + (width / 2);
+	float wallZmin = cz - (depth / 2);
+	float wallZmax = cz + (depth / 2);
+
+	if ((wallXmin <= ballX && ballX <= wallXmax) && !(wallZmin <= ballZ && ballZ <= wallZmax))
+	{
+		if (wallZmin - r <= ballZ && ballZ <= cz)
+		{
+			ballZ = wallZmin - r - 0.01f;
+			z = ballZ;
+		}
+		else
+		{
+			x = (wallXmax - wallXmin) / 2 + wallXmin;
+			z = wallZmin + 0.1f;
+			vx = vz = 0;
+		}
+
+		vz = -vz;
+	}
+
+	if (!(wallXmin <= ballX && ballX <= wallXmax) && (wallZmin <= ballZ && ballZ <= wallZmax))
+	{
+		if (wallXmin - r <= ballX && ballX <= cx)
+			ballX = wallXmin - r - 0.01f;
+		else
+			ballX = wallXmax + r + 0.01f;
+		x = ballX;
+		z = ballZ;
+
+		vx = -vx;
+	}
+}
+
+// a ball against a segment grown by its half thickness: pushed out along the normal of the
+// nearest point, the velocity into the segment reflected
+static bool hitSegment(float& x, float& z, float& vx, float& vz, float r, const sim::Obstacle& o)
+{
+	float ux = o.x1 - o.x, uz = o.z1 - o.z;
+	float lengthSq = ux * ux + uz * uz;
+	float s = lengthSq > 0 ? ((x - o.x) * ux + (z - o.z) * uz) / lengthSq : 0;
+	s = std::min(std::max(s, 0.0f), 1.0f);
+	float cx = o.x + s * ux, cz = o.z + s * uz;
+
+	float dx = x - cx, dz = z - cz;
+	float reach = r + o.radius;
+	float distSq = dx * dx + dz * dz;
+	if (distSq >= reach * reach)
+		return false;
+
+	float dist = std::sqrt(distSq);
+	float nx, nz;
+	if (dist > 0)
+	{
+		nx = dx / dist;
+		nz = dz / dist;
+	}
+	else
+	{
+		float length = std::sqrt(lengthSq);  // on the center line: out of the left side
+		nx = length > 0 ? -uz / length : 0;
+		nz = length > 0 ? ux / length : 1;
+	}
+
+	// 0.01 clear of it, as hitBox leaves a ball, or the overlap test still finds it touching
+	x = cx + nx * (reach + 0.01f);
+	z = cz + nz * (reach + 0.01f);
+	float vn = vx * nx + vz * nz;
+	if (vn < 0)
+	{
+		vx -= 2 * vn * nx;
+		vz -= 2 * vn * nz;
+	}
+	return true;
+}
+
+static bool holds(const sim::Obstacle& o, float x, float z)
+{
+	if (o.kind == sim::OBSTACLE_POCKET)
+	{
+		float dx = x - o.x, dz = z - o.z;
+		return dx * dx + dz * dz < o.radius * o.radius;
+	}
+	return o.kind == sim::OBSTACLE_DRAIN && o.minX < x && x < o.maxX && o.minZ < z && z < o.maxZ;
+}
+
+static bool isSolid(const sim::Obstacle& o)
+{
+	return o.kind == sim::OBSTACLE_BOX || o.kind == sim::OBSTACLE_SEGMENT;
+}
+
+// the part [0, tMax] of p + t * d meets the box
+static bool segmentMeetsBox(float px, float pz, float dx, float dz, float tMax, float xMin, float zMin, float xMax,
+	float zMax)
+{
+	float tEnter = 0, tExit = tMax;
+	float p[2] = { px, pz }, d[2] = { dx, dz }, lo[2] = { xMin, zMin }, hi[2] = { xMax, zMax };
+	for (int a = 0; a < 2; a++)
+	{
+		if (d[a] == 0)
+		{
+			if (p[a] < lo[a] || p[a] > hi[a])
+				return false;
+			continue;
+		}
+		float t0 = (lo[a] - p[a]) / d[a], t1 = (hi[a] - p[a]) / d[a];
+		if (t0 > t1)
+			std::swap(t0, t1);
+		tEnter = std::max(tEnter, t0);
+		tExit = std::min(tExit, t1);
+		if (tEnter > tExit)
+			return false;
+	}
+	return true;
+}
+
+//
+// CStaticGeometry
+//
+
+sim::CStaticGeometry::CStaticGeometry(void)
+{
+	m_limitX = m_limitZ = FLT_MAX;
+}
+
+void sim::CStaticGeometry::clear(void)
+{
+	m_obstacles.clear();
+	m_nodes.clear();
+	m_order.clear();
+	m_limitX = m_limitZ = FLT_MAX;
+}
+
+int sim::CStaticGeometry::add(const Obstacle& o)
+{
+	m_obstacles.push_back(o);
+	return (int)m_obstacles.size() - 1;
+}
+
+int sim::CStaticGeometry::addBox(float x, float z, float width, float depth)
+{
+	Obstacle o = { OBSTACLE_BOX, x, z, width, depth, 0, 0, 0,
+		x - width / 2, z - depth / 2, x + width / 2, z + depth / 2 };
+	return add(o);
+}
+
+int sim::CStaticGeometry::addSegment(float x0, float z0, float x1, float z1, float thickness)
+{
+	Obstacle o = { OBSTACLE_SEGMENT, x0, z0, 0, 0, x1, z1, thickness,
+		std::min(x0, x1) - thickness, std::min(z0, z1) - thickness,
+		std::max(x0, x1) + thickness, std::max(z0, z1) + thickness };
+	return add(o);
+}
+
+int sim::CStaticGeometry::addPocket(float x, float z, float radius)
+{
+	Obstacle o = { OBSTACLE_POCKET, x, z, 0, 0, 0, 0, radius, x - radius, z - radius, x + radius, z + radius };
+	return add(o);
+}
+
+int sim::CStaticGeometry::addDrain(float xMin, float zMin, float xMax, float zMax)
+{
+	Obstacle o = { OBSTACLE_DRAIN, (xMin + xMax) / 2, (zMin + zMax) / 2, xMax - xMin, zMax - zMin, 0, 0, 0,
+		xMin, zMin, xMax, zMax };
+	return add(o);
+}
+
+void sim::CStaticGeometry::setLimits(float xLimit, float zLimit)
+{
+	m_limitX = xLimit;
+	m_limitZ = zLimit;
+}
+
+void sim::CStaticGeometry::build(void)
+{
+	int n = size();
+	m_order.resize(n);
+	for (int i = 0; i < n; i++)
+		m_order[i] = i;
+	m_nodes.clear();
+	if (n == 0)
+		return;
+	m_nodes.reserve(2 * (n / LEAF_SIZE + 1));
+	m_nodes.push_back(Node());
+	buildNode(0, 0, n, 0);
+}
+
+// fills node index for m_order[begin, end), split at the median of the centers along the
+// longer side of their bounds
+void sim::CStaticGeometry::buildNode(int index, int begin, int end, int depth)
+{
+	float minX = FLT_MAX, minZ = FLT_MAX, maxX = -FLT_MAX, maxZ = -FLT_MAX;
+	float cMinX = FLT_MAX, cMinZ = FLT_MAX, cMaxX = -FLT_MAX, cMaxZ = -FLT_MAX;
+	for (int k = begin; k < end; k++)
+	{
+		const Obstacle& o = m_obstacles[m_order[k]];
+		minX = std::min(minX, o.minX);
+		minZ = std::min(minZ, o.minZ);
+		maxX = std::max(maxX, o.maxX);
+		maxZ = std::max(maxZ, o.maxZ);
+		cMinX = std::min(cMinX, o.x);
+		cMinZ = std::min(cMinZ, o.z);
+		cMaxX = std::max(cMaxX, o.x);
+		cMaxZ = std::max(cMaxZ, o.z);
+	}
+
+	Node node = { minX, minZ, maxX, maxZ, begin, end - begin };
+	if (end - begin <= LEAF_SIZE || depth >= 60)
+	{
+		m_nodes[index] = node;
+		return;
+	}
+
+	bool alongX = cMaxX - cMinX >= cMaxZ - cMinZ;
+	int mid = (begin + end) / 2;
+	std::nth_element(m_order.begin() + begin, m_order.begin() + mid, m_order.begin() + end, [&](int a, int b) {
+		const Obstacle& oa = m_obstacles[a];
+		const Obstacle& ob = m_obstacles[b];
+		return alongX ? (oa.x < ob.x || (oa.x == ob.x && a < b)) : (oa.z < ob.z || (oa.z == ob.z && a < b));
+	});
+
+	// the children side by side
+	int left = (int)m_nodes.size();
+	node.first = left;
+	node.count = 0;
+	m_nodes[index] = node;
+	m_nodes.push_back(Node());
+	m_nodes.push_back(Node());
+	buildNode(left, begin, mid, depth + 1);
+	buildNode(left + 1, mid, end, depth + 1);
+}
+
+void sim::CStaticGeometry::makeClassic(void)
+{
+	clear();
+
+	// top, right and left walls
+	addBox(0.0f, 3.5f, 6, 0.12f);
+	addBox(3, 0.0f, 0.12f, 7.12f);
+	addBox(-3, 0.0f, 0.12f, 7.12f);
+
+	// the bottom of the table is open
+	addDrain(-FLT_MAX, -FLT_MAX, FLT_MAX, TABLE_BOTTOM_Z);
+
+	setLimits(3, 3.5f);
+	build();
+}
+
+void sim::CStaticGeometry::makeCourse(int count, const CRandom& random)
+{
+	makeClassic();
+
+	// a ball passes between any two pieces and between a piece and a wall: one wedged in a gap
+	// would be pushed through the wall (hitBox takes the side of its center). Above the
+	// paddle, so the red ball always leaves it.
+	float reach = std::max(0.5f * (COURSE_BUMPER + COURSE_THICKNESS), COURSE_POCKET);
+	float xMax = m_limitX - 0.06f - reach - COURSE_GAP;  // inside the inner faces of the walls
+	float zMax = m_limitZ - 0.06f - reach - COURSE_GAP;
+	CPoissonDisk sites;
+	if (!sites.sample(-xMax, -1.5f, xMax, zMax, 2 * reach + COURSE_GAP, count, random.stream(0)))
+		count = sites.size();  // as many as the table holds
+
+	CRandom r = random.stream(1);
+	for (int i = 0; i < count; i++)
+	{
+		float x = sites.getX(i), z = sites.getZ(i);
+		if (i % 4 == 3)
+		{
+			addPocket(x, z, COURSE_POCKET);
+		}
+		else
+		{
+			float angle = r.uniform(0, 3.14159265f);
+			float dx = 0.5f * COURSE_BUMPER * std::cos(angle), dz = 0.5f * COURSE_BUMPER * std::sin(angle);
+			addSegment(x - dx, z - dz, x + dx, z + dz, COURSE_THICKNESS);
+		}
+	}
+	build();
+}
+
+bool sim::CStaticGeometry::hitBy(float& x, float& z, float& vx, float& vz, float r) const
+{
+	// the contact of a piece may push the ball by up to its radius into the next one
+	int hits[MAX_CONTACTS];
+	int count = 0;
+	float reach = 2 * r;
+	query(x - reach, z - reach, x + reach, z + reach, [&](int i) {
+		if (count < MAX_CONTACTS && isSolid(m_obstacles[i]))
+			hits[count++] = i;
+	});
+	std::sort(hits, hits + count);
+
+	for (int k = 0; k < count; k++)
+	{
+		const Obstacle& o = m_obstacles[hits[k]];
+		if (o.kind == OBSTACLE_BOX)
+			hitBox(x, z, vx, vz, r, o.x, o.z, o.width, o.depth);
+		else
+			hitSegment(x, z, vx, vz, r, o);
+	}
+	return isDrained(x, z);
+}
+
+int sim::CStaticGeometry::findOverlap(float x, float z, float r) const
+{
+	int found = -1;
+	query(x - r, z - r, x + r, z + r, [&](int i) {
+		const Obstacle& o = m_obstacles[i];
+		if (found >= 0 && found < i)
+			return;
+		bool overlaps = false;
+		if (o.kind == OBSTACLE_BOX)
+		{
+			overlaps = boxOverlaps(x, z, r, o.x, o.z, o.width, o.depth);
+		}
+		else if (o.kind == OBSTACLE_SEGMENT)
+		{
+			float cx = x, cz = z, cvx = 0, cvz = 0;
+			overlaps = hitSegment(cx, cz, cvx, cvz, r, o);
+		}
+		if (overlaps)
+			found = i;
+	});
+	return found;
+}
+
+bool sim::CStaticGeometry::isDrained(float x, float z) const
+{
+	bool drained = false;
+	query(x, z, x, z, [&](int i) {
+		drained = drained || holds(m_obstacles[i], x, z);
+	});
+	return drained;
+}
+
+bool sim::CStaticGeometry::sweepObstacle(const Obstacle& o, float x, float z, float r, float dx, float dz,
+	float& t) const
+{
+	// the solid pieces grown by the radius less the slop, so the sweep ends inside the contact
+	float grow = r - CONTACT_SLOP;
+	switch (o.kind)
+	{
+	case OBSTACLE_BOX:
+		return sweepBox(x, z, dx, dz, o.x - (o.width / 2 + grow), o.z - (o.depth / 2 + grow),
+			o.x + (o.width / 2 + grow), o.z + (o.depth / 2 + grow), t);
+	case OBSTACLE_SEGMENT:
+		return sweepCapsule(x, z, dx, dz, o.x, o.z, o.x1, o.z1, o.radius + grow, t);
+	case OBSTACLE_POCKET:
+		return sweepCircle(x, z, dx, dz, o.x, o.z, o.radius - CONTACT_SLOP, t);
+	default:
+		return sweepBox(x, z, dx, dz, o.minX + CONTACT_SLOP, o.minZ + CONTACT_SLOP, o.maxX - CONTACT_SLOP,
+			o.maxZ - CONTACT_SLOP, t);
+	}
+}
+
+// a node is skipped when the path up to the best hit so far misses it
+bool sim::CStaticGeometry::sweep(float x, float z, float r, float dx, float dz, float& t, int& obstacle) const
+{
+	if (m_nodes.empty())
+		return false;
+
+	float tHit = 1;
+	int hit = -1;
+	int stack[64];
+	int top = 0;
+	stack[top++] = 0;
+	while (top > 0)
+	{
+		const Node& n = m_nodes[stack[--top]];
+		if (!segmentMeetsBox(x, z, dx, dz, tHit, n.minX - r, n.minZ - r, n.maxX + r, n.maxZ + r))
+			continue;
+		if (n.count == 0)
+		{
+			stack[top++] = n.first;
+			stack[top++] = n.first + 1;
+			continue;
+		}
+		for (int k = n.first; k < n.first + n.count; k++)
+		{
+			int i = m_order[k];
+			float ti;
+			if (sweepObstacle(m_obstacles[i], x, z, r, dx, dz, ti) && (ti < tHit || (ti == tHit && (hit < 0 || i < hit))))
+			{
+				tHit = ti;
+				hit = i;
+			}
+		}
+	}
+
+	if (hit < 0)
+		return false;
+	t = tHit;
+	obstacle = hit;
+	return true;
+}
+
+static sim::CStaticGeometry makeClassicGeometry(void)
+{
+	sim::CStaticGeometry geometry;
+	geometry.makeClassic();
+	return geometry;
+}
+
+const sim::CStaticGeometry& sim::getClassicGeometry(void)
+{
+	static const CStaticGeometry classic = makeClassicGeometry();
+	return classic;
+}
@@ -0,0 +1,140 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// File: staticGeometry.h
+//
+// Desc: The fixed pieces of a table: solid boxes and segments the balls bounce off, round
+//       pockets and drain regions they fall into. The pieces are kept in a bounding volume
+//       hierarchy, so a ball finds the few pieces around it, or the first one on its path, in
+//       O(log n) of the pieces on the table, and a table may have thousands of them.
+//
+//       makeClassic() builds the table of Virtual Billiard: the top, right and left walls and
+//       the open bottom below TABLE_BOTTOM_Z, in that order. A box resolves its contacts as
+//       CWall always did (hitBox), so the classic table plays as the hard-coded walls did.
+//       makeCourse() adds bumpers and pockets to it, a table other than the classic one for
+//       the drivers to play on.
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __staticGeometryH__
+#define __staticGeometryH__
+
+#include "simRandom.h"
+#include <vector>
+
+namespace sim
+{
+	enum ObstacleKind { OBSTACLE_BOX, OBSTACLE_SEGMENT, OBSTACLE_POCKET, OBSTACLE_DRAIN };
+
+	// one piece of the table
+	struct Obstacle
+	{
+		int                 kind;           // ObstacleKind
+		float               x, z;           // center; OBSTACLE_SEGMENT: first end
+		float               width, depth;   // OBSTACLE_BOX, OBSTACLE_DRAIN
+		float               x1, z1;         // OBSTACLE_SEGMENT: second end
+		float               radius;         // OBSTACLE_SEGMENT: half thickness; OBSTACLE_POCKET
+		float               minX, minZ, maxX, maxZ;  // bounds
+	};
+
+	// box of center (cx, cz) and size width x depth against a ball of radius r: the overlap test
+	// and the contact of CWall
+	bool boxOverlaps(float x, float z, float r, float cx, float cz, float width, float depth);
+	void hitBox(float& x, float& z, float& vx, float& vz, float r, float cx, float cz, float width, float depth);
+
+	class CStaticGeometry {
+	public:
+		enum { LEAF_SIZE = 4, MAX_CONTACTS = 32 };
+
+		CStaticGeometry(void);
+
+		void clear(void);
+		// the add functions return the index of the piece; build() once after the last one
+		// a box takes the contacts of CWall, made for walls across the table: a piece inside it
+		// is better a segment
+		int addBox(float x, float z, float width, float depth);
+		int addSegment(float x0, float z0, float x1, float z1, float thickness);
+		int addPocket(float x, float z, float radius);  // takes the balls whose center it holds
+		int addDrain(float xMin, float zMin, float xMax, float zMax);  // same for a box
+		void build(void);
+
+		// last resort of ballStep: centers stay inside |x| < xLimit - r, z < zLimit - r;
+		// FLT_MAX (the default) for none
+		void setLimits(float xLimit, float zLimit);
+		float getLimitX(void) const { return m_limitX; }
+		float getLimitZ(void) const { return m_limitZ; }
+
+		void makeClassic(void);  // clear() and the pieces of Virtual Billiard, built
+		// makeClassic() and count pieces at random in the upper part of the table, where the
+		// yellow balls go: bumpers (short segments), every fourth one a pocket, a ball's width
+		// apart and off the walls (fewer when the table can not hold count); built
+		void makeCourse(int count, const CRandom& random);
+
+		int size(void) const { return (int)m_obstacles.size(); }
+		const Obstacle& get(int i) const { return m_obstacles[i]; }
+		int getNodeCount(void) const { return (int)m_nodes.size(); }
+
+		// calls visit(i) for every piece whose bounds overlap the box, in no particular order
+		template <class F> void query(float xMin, float zMin, float xMax, float zMax, F visit) const
+		{
+			if (m_nodes.empty())
+				return;
+			int stack[64];
+			int top = 0;
+			stack[top++] = 0;
+			while (top > 0)
+			{
+				const Node& n = m_nodes[stack[--top]];
+				if (n.maxX < xMin || n.minX > xMax || n.maxZ < zMin || n.minZ > zMax)
+					continue;
+				if (n.count > 0)
+				{
+					for (int k = n.first; k < n.first + n.count; k++)
+					{
+						const Obstacle& o = m_obstacles[m_order[k]];
+						if (!(o.maxX < xMin || o.minX > xMax || o.maxZ < zMin || o.minZ > zMax))
+							visit(m_order[k]);
+					}
+				}
+				else
+				{
+					stack[top++] = n.first;
+					stack[top++] = n.first + 1;
+				}
+			}
+		}
+
+		// resolves the contacts of a ball with the solid pieces, in the order they were added
+		// (at most MAX_CONTACTS); true when a pocket or a drain holds its center afterwards
+		bool hitBy(float& x, float& z, float& vx, float& vz, float r) const;
+		int findOverlap(float x, float z, float r) const;  // a solid piece the ball touches, -1 for none
+		bool isDrained(float x, float z) const;  // a pocket or a drain holds the point
+
+		// first piece a ball of radius r moving by (dx, dz) meets, t in [0, 1]: a solid one
+		// CONTACT_SLOP deep, a pocket or drain once it holds the center; pieces the ball
+		// already touches are not reported
+		bool sweep(float x, float z, float r, float dx, float dz, float& t, int& obstacle) const;
+
+	private:
+		// count > 0: leaf of the pieces m_order[first, first + count); else the children are
+		// first and first + 1
+		struct Node
+		{
+			float           minX, minZ, maxX, maxZ;
+			int             first, count;
+		};
+
+		int add(const Obstacle& o);
+		void buildNode(int index, int begin, int end, int depth);
+		bool sweepObstacle(const Obstacle& o, float x, float z, float r, float dx, float dz, float& t) const;
+
+		std::vector<Obstacle>  m_obstacles;
+		std::vector<Node>   m_nodes;  // root first
+		std::vector<int>    m_order;  // obstacle indices, leaves hold ranges of it
+		float               m_limitX, m_limitZ;
+	};
+
+	// makeClassic(), shared by every game that was not given other geometry
+	const CStaticGeometry& getClassicGeometry(void);
+}
+
+#endif // __staticGeometryH__
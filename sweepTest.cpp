@@ -0,0 +1,113 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// File: sweepTest.cpp
+//
+// Desc: Swept (continuous) intersection tests.
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "sweepTest.h"
+#include <cmath>
+
+bool sim::sweepCircle(float px, float pz, float dx, float dz, float cx, float cz, float radius, float& t)
+{
+	float mx = px - cx;
+	float mz = pz - cz;
+	float c = mx * mx + mz * mz - radius * radius;
+	float b = mx * dx + mz * dz;
+
+	if (c <= 0 || b >= 0)  // already overlapping, or not moving closer
+		return false;
+
+	float a = dx * dx + dz * dz;
+	float disc = b * b - a * c;
+	if (disc < 0)  // the segment line misses the circle
+		return false;
+
+	float hit = (-b - std::sqrt(disc)) / a;
+	if (hit > 1)
+		return false;
+	t = hit < 0 ? 0 : hit;
+	return true;
+}
+
+// clips [tEnter, tExit] against one slab of the box
+static bool clipSlab(float p, float d, float lo, float hi, float& tEnter, float& tExit)
+{
+	if (std::fabs(d) < 1e-12f)
+		return lo <= p && p <= hi;
+
+	float t0 = (lo - p) / d;
+	float t1 = (hi - p) / d;
+	if (t0 > t1)
+	{
+		float tmp = t0;
+		t0 = t1;
+		t1 = tmp;
+	}
+	if (t0 > tEnter) tEnter = t0;
+	if (t1 < tExit) tExit = t1;
+	return tEnter <= tExit;
+}
+
+bool sim::sweepBox(float px, float pz, float dx, float dz, float xMin, float zMin, float xMax, float zMax, float& t)
+{
+	if (xMin < px && px < xMax && zMin < pz && pz < zMax)  // already inside
+		return false;
+
+	float tEnter = 0, tExit = 1;
+	if (!clipSlab(px, dx, xMin, xMax, tEnter, tExit))
+		return false;
+	if (!clipSlab(pz, dz, zMin, zMax, tEnter, tExit))
+		return false;
+
+	t = tEnter;
+	return true;
+}
+
+// the two ends as circles, the two sides as lines parallel to the segment
+bool sim::sweepCapsule(float px, float pz, float dx, float dz, float ax, float az, float bx, float bz, float radius,
+	float& t)
+{
+	float ux = bx - ax, uz = bz - az;
+	float length = std::sqrt(ux * ux + uz * uz);
+	if (length <= 0)
+		return sweepCircle(px, pz, dx, dz, ax, az, radius, t);
+	ux /= length;
+	uz /= length;
+
+	// p and d in the frame of the segment: along it from a, and across it
+	float along = (px - ax) * ux + (pz - az) * uz;
+	float across = (pz - az) * ux - (px - ax) * uz;
+	float dAlong = dx * ux + dz * uz;
+	float dAcross = dz * ux - dx * uz;
+	if (std::fabs(across) < radius && along >= 0 && along <= length)  // already inside
+		return false;
+
+	bool hit = false;
+	float tHit = 1, tc;
+	if (std::fabs(across) >= radius && across * dAcross < 0)
+	{
+		float side = across > 0 ? radius : -radius;
+		tc = (across - side) / -dAcross;
+		float a = along + tc * dAlong;
+		if (tc <= tHit && a >= 0 && a <= length)
+		{
+			tHit = tc;
+			hit = true;
+		}
+	}
+	if (sweepCircle(px, pz, dx, dz, ax, az, radius, tc) && tc < tHit)
+	{
+		tHit = tc;
+		hit = true;
+	}
+	if (sweepCircle(px, pz, dx, dz, bx, bz, radius, tc) && tc < tHit)
+	{
+		tHit = tc;
+		hit = true;
+	}
+	if (hit)
+		t = tHit;
+	return hit;
+}
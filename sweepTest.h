@@ -0,0 +1,33 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// File: sweepTest.h
+//
+// Desc: Swept (continuous) intersection tests for a ball moving along a straight segment
+//       p + t * d, t in [0, 1]. They return the first time of impact so the step can stop at
+//       the contact instead of jumping over thin targets.
+//
+//       A ball that already overlaps the obstacle at t = 0 is not reported; the discrete
+//       contact code (hasIntersected/hitBy) is responsible for it.
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __sweepTestH__
+#define __sweepTestH__
+
+namespace sim
+{
+	// the sweeps stop this far inside the contact, so the discrete tests see the overlap
+	const float CONTACT_SLOP = 1e-4f;
+
+	// point p moving by d against a circle of the given radius (sum of both ball radii)
+	bool sweepCircle(float px, float pz, float dx, float dz, float cx, float cz, float radius, float& t);
+
+	// point p moving by d against an axis aligned box (already grown by the ball radius)
+	bool sweepBox(float px, float pz, float dx, float dz, float xMin, float zMin, float xMax, float zMax, float& t);
+
+	// point p moving by d against the segment a-b grown by radius (a capsule)
+	bool sweepCapsule(float px, float pz, float dx, float dz, float ax, float az, float bx, float bz, float radius,
+		float& t);
+}
+
+#endif // __sweepTestH__
@@ -0,0 +1,210 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// File: tableScene.cpp
+//
+// Desc: The Virtual Billiard table as render commands.
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "tableScene.h"
+#include <cmath>
+
+static const render::MeshDesc MESHES[render::CTableScene::MESH_COUNT] = {
+	{ render::SHAPE_SPHERE, (float)M_RADIUS, 0, 0, 50, 50 },  // MESH_BALL
+	{ render::SHAPE_BOX, 6, 0.03f, 7, 0, 0 },                 // MESH_PLANE
+	{ render::SHAPE_BOX, 6, 0.3f, 0.12f, 0, 0 },              // MESH_WALL_BACK
+	{ render::SHAPE_BOX, 0.12f, 0.3f, 7.12f, 0, 0 },          // MESH_WALL_SIDE
+	{ render::SHAPE_SPHERE, 0.1f, 0, 0, 10, 10 },             // MESH_LIGHT
+};
+
+// the fixed objects of the table and where Setup() put them
+struct Piece
+{
+	int                 mesh;
+	float               x, y, z;
+};
+
+static const Piece PIECES[] = {
+	{ render::CTableScene::MESH_PLANE, 0.0f, -0.0006f / 5, 0.0f },
+	{ render::CTableScene::MESH_WALL_BACK, 0.0f, 0.12f, 3.5f },
+	{ render::CTableScene::MESH_WALL_SIDE, 3.0f, 0.12f, 0.0f },
+	{ render::CTableScene::MESH_WALL_SIDE, -3.0f, 0.12f, 0.0f },
+};
+static const int PIECE_COUNT = sizeof(PIECES) / sizeof(PIECES[0]);
+
+// the d3d:: colours of d3dUtility.h
+static const render::Color WHITE = { 1, 1, 1, 1 };
+static const render::Color RED = { 1, 0, 0, 1 };
+static const render::Color GREEN = { 0, 1, 0, 1 };
+static const render::Color BLUE = { 0, 0, 1, 1 };
+static const render::Color YELLOW = { 1, 1, 0, 1 };
+static const render::Color DARKRED = { 215 / 255.0f, 0, 0, 1 };
+static const render::Color GRAY = { 0.9f, 0.9f, 0.9f, 0.9f };  // d3d::WHITE * 0.9f
+
+static const float OBJECT_POWER = 5.0f;  // CSphere / CWall
+static const float LIGHT_POWER = 2.0f;   // d3d::WHITE_MTRL
+
+render::CTableScene::CTableScene(void)
+{
+	m_cache = NULL;
+	for (int i = 0; i < MESH_COUNT; i++)
+		m_meshes[i].count = 0;
+	m_yellow = m_red = m_white = m_blue = 0;
+	m_plane = m_wall = m_light = 0;
+
+	// a white point light above the middle of the table
+	m_lit.diffuse = WHITE;
+	m_lit.specular = m_lit.ambient = GRAY;
+	m_lit.position[0] = 0;
+	m_lit.position[1] = 3;
+	m_lit.position[2] = 0;
+	m_lit.range = 100;
+	m_lit.attenuation0 = 0;
+	m_lit.attenuation1 = 0.9f;
+	m_lit.attenuation2 = 0;
+
+	// the meshes are centred on the origin
+	for (int i = 0; i < MESH_COUNT; i++)
+	{
+		const MeshDesc& desc = MESHES[i];
+		float half[3] = { desc.width, desc.width, desc.width };
+		if (desc.shape == SHAPE_BOX)
+		{
+			half[0] = desc.width / 2;
+			half[1] = desc.height / 2;
+			half[2] = desc.depth / 2;
+		}
+		for (int j = 0; j < 3; j++)
+		{
+			m_sphere[i].center[j] = 0;
+			m_box[i].min[j] = -half[j];
+			m_box[i].max[j] = half[j];
+		}
+		m_sphere[i].radius = desc.shape == SHAPE_BOX ?
+			std::sqrt(half[0] * half[0] + half[1] * half[1] + half[2] * half[2]) : desc.width;
+	}
+	m_culling = false;
+}
+
+render::CTableScene::~CTableScene(void)
+{
+	release();
+}
+
+const render::MeshDesc& render::CTableScene::getMesh(int kind)
+{
+	return MESHES[kind];
+}
+
+void render::CTableScene::setup(CRenderList& list, CMeshCache& cache)
+{
+	// acquired before the old ones go, so the meshes both use stay generated
+	MeshLods meshes[MESH_COUNT];
+	for (int i = 0; i < MESH_COUNT; i++)
+		cache.acquireLods(MESHES[i], meshes[i]);
+	release();
+	m_cache = &cache;
+	for (int i = 0; i < MESH_COUNT; i++)
+		m_meshes[i] = meshes[i];
+
+	m_yellow = list.addMaterial(makeMaterial(YELLOW, OBJECT_POWER));
+	m_red = list.addMaterial(makeMaterial(RED, OBJECT_POWER));
+	m_white = list.addMaterial(makeMaterial(WHITE, OBJECT_POWER));
+	m_blue = list.addMaterial(makeMaterial(BLUE, OBJECT_POWER));
+	m_plane = list.addMaterial(makeMaterial(GREEN, OBJECT_POWER));
+	m_wall = list.addMaterial(makeMaterial(DARKRED, OBJECT_POWER));
+	m_light = list.addMaterial(makeMaterial(WHITE, LIGHT_POWER));
+}
+
+void render::CTableScene::release(void)
+{
+	if (m_cache == NULL)
+		return;
+	for (int i = 0; i < MESH_COUNT; i++)
+		m_cache->releaseLods(m_meshes[i]);
+	m_cache = NULL;
+}
+
+void render::CTableScene::setLightPosition(float x, float y, float z)
+{
+	m_lit.position[0] = x;
+	m_lit.position[1] = y;
+	m_lit.position[2] = z;
+}
+
+void render::CTableScene::getCamera(float aspect, Matrix& view, Matrix& proj)
+{
+	const float eye[3] = { 0, 5, -8 }, at[3] = { 0, 0, 0 }, up[3] = { 0, 2, 0 };
+	setLookAtLH(view, eye, at, up);
+	setPerspectiveFovLH(proj, 3.141592654f / 4, aspect, 1, 100);
+}
+
+void render::CTableScene::setView(const Matrix& view, const Matrix& proj, int viewportHeight)
+{
+	setFrustum(m_frustum, view, proj, viewportHeight);
+	m_culling = true;
+}
+
+void render::CTableScene::drawObject(int kind, int material, const Matrix& world, CRenderList& list,
+	SceneStats& stats) const
+{
+	const MeshLods& lods = m_meshes[kind];
+	int level = 0;
+	stats.objects++;
+	if (m_culling)
+	{
+		bool visible = MESHES[kind].shape == SHAPE_BOX ? isVisible(m_frustum, m_box[kind], world) :
+			isVisible(m_frustum, m_sphere[kind], world);
+		if (!visible)
+		{
+			stats.culled++;
+			return;
+		}
+		if (lods.count > 1)
+			level = selectLod(lods, getScreenRadius(m_frustum, m_sphere[kind], world));
+	}
+	stats.triangles += m_cache->getGeometry(lods.mesh[level]).getTriangleCount();
+	list.draw(lods.mesh[level], material, world);
+}
+
+render::SceneStats render::CTableScene::record(const sim::Snapshot& frame, const Matrix& world, CRenderList& list) const
+{
+	SceneStats stats = { 0, 0, 0 };
+	Matrix m;
+	const float y = (float)M_RADIUS;
+
+	for (int i = 0; i < PIECE_COUNT; i++)
+	{
+		translate(m, PIECES[i].x, PIECES[i].y, PIECES[i].z, world);
+		drawObject(PIECES[i].mesh, i == 0 ? m_plane : m_wall, m, list, stats);
+	}
+
+	for (size_t k = 0; k < frame.live.size(); k++)
+	{
+		int i = frame.live[k];
+		translate(m, frame.x[i], y, frame.z[i], world);
+		drawObject(MESH_BALL, m_yellow, m, list, stats);
+	}
+	if (frame.redAlive)
+	{
+		translate(m, frame.red.x, y, frame.red.z, world);
+		drawObject(MESH_BALL, m_red, m, list, stats);
+	}
+	translate(m, frame.white.x, y, frame.white.z, world);
+	drawObject(MESH_BALL, m_white, m, list, stats);
+	if (frame.blueAlive)
+	{
+		translate(m, frame.blue.x, y, frame.blue.z, world);
+		drawObject(MESH_BALL, m_blue, m, list, stats);
+	}
+
+	setTranslation(m, m_lit.position[0], m_lit.position[1], m_lit.position[2]);
+	drawObject(MESH_LIGHT, m_light, m, list, stats);
+	return stats;
+}
+
+int render::CTableScene::countLegacyCalls(const sim::Snapshot& frame)
+{
+	int objects = PIECE_COUNT + 1 + (frame.redAlive ? 1 : 0) + (frame.blueAlive ? 1 : 0) + (int)frame.live.size();
+	return 4 * objects + 3;
+}
@@ -0,0 +1,84 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// File: tableScene.h
+//
+// Desc: What the front end draws for a frame, without a device: the plane, the three walls, the
+//       balls of a Snapshot and the marker of the light, recorded into a CRenderList. The
+//       meshes come from a CMeshCache, so every backend builds the same geometry under the
+//       same mesh ids, and all balls share one sphere mesh, so the balls of a colour end up
+//       in one instanced batch.
+//
+//       After setView() every object is tested against the frustum of the camera, a bounding
+//       sphere for the balls and the light, a box for the plane and the walls, and a ball is
+//       drawn with the coarsest tessellation that still looks round at its size on screen.
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __tableSceneH__
+#define __tableSceneH__
+
+#include "meshCache.h"
+#include "renderList.h"
+#include "simThread.h"
+
+namespace render
+{
+	// what record() made of a frame
+	struct SceneStats
+	{
+		int                 objects;    // in the frame
+		int                 culled;     // of those, outside the frustum
+		long long           triangles;  // of the levels drawn
+	};
+
+	class CTableScene {
+	public:
+		enum { MESH_BALL, MESH_PLANE, MESH_WALL_BACK, MESH_WALL_SIDE, MESH_LIGHT, MESH_COUNT };
+
+		CTableScene(void);
+		~CTableScene(void);
+
+		// the finest level of a kind of mesh, as D3DXCreateSphere / D3DXCreateBox made it
+		static const MeshDesc& getMesh(int kind);
+
+		// adds the materials of the table to list and takes the meshes from cache (the ones of
+		// an earlier setup() are released first), once before the first frame
+		void setup(CRenderList& list, CMeshCache& cache);
+		void release(void);  // gives the meshes back to the cache
+		const MeshLods& getMeshLods(int kind) const { return m_meshes[kind]; }
+		void setLightPosition(float x, float y, float z);  // in world space
+		const PointLight& getLight(void) const { return m_lit; }  // the light of Setup()
+
+		// the camera of Setup() for a back buffer of the given aspect ratio
+		static void getCamera(float aspect, Matrix& view, Matrix& proj);
+		// culls and picks levels of detail for this camera from now on
+		void setView(const Matrix& view, const Matrix& proj, int viewportHeight);
+
+		// the objects of frame as Display() draws them; the light marker is not moved by world
+		SceneStats record(const sim::Snapshot& frame, const Matrix& world, CRenderList& list) const;
+
+		// device calls the per-object draw paths made for frame: SetTransform,
+		// MultiplyTransform, SetMaterial and DrawSubset for every object, no
+		// MultiplyTransform for the light
+		static int countLegacyCalls(const sim::Snapshot& frame);
+
+	private:
+		CTableScene(const CTableScene&);  // holds references into the cache
+		CTableScene& operator=(const CTableScene&);
+
+		void drawObject(int kind, int material, const Matrix& world, CRenderList& list, SceneStats& stats) const;
+
+		CMeshCache*         m_cache;
+		MeshLods            m_meshes[MESH_COUNT];
+		int                 m_yellow, m_red, m_white, m_blue;
+		int                 m_plane, m_wall, m_light;
+		PointLight          m_lit;
+
+		BoundingSphere      m_sphere[MESH_COUNT];
+		BoundingBox         m_box[MESH_COUNT];
+		bool                m_culling;
+		Frustum             m_frustum;
+	};
+}
+
+#endif // __tableSceneH__
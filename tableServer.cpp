@@ -0,0 +1,148 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// File: tableServer.cpp
+//
+// Desc: Multi-table simulation server.
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "tableServer.h"
+#include "levelPack.h"
+#include "profiler.h"
+#include "replay.h"
+#include "workPool.h"
+#include <algorithm>
+#include <cmath>
+
+// paddle travel per frame of the bot at a 16 ms frame, scaled with the frame time
+static const float BOT_STEP = 0.05f;
+static const float BOT_FRAME = 16 * sim::GAME_TIME_PER_MS;
+
+// the scripted player of headlessLego without assist or recording
+class CPaddleBot {
+public:
+	CPaddleBot(const sim::CRandom& random, float maxStep)
+	{
+		m_random = random;
+		m_maxPixels = std::max(1, (int)(maxStep / sim::PADDLE_STEP));
+		m_aim = 0;
+	}
+
+	void play(sim::CGame& game)
+	{
+		const sim::CBall& red = game.getRedBall();
+		const sim::CBall& white = game.getWhiteBall();
+
+		if (!game.isLaunched())
+		{
+			m_aim = m_random.uniform(-0.2f, 0.2f);
+			game.launch(0);
+			return;
+		}
+
+		float target = red.getCenter().x;
+		if (red.getVelocity_Z() < 0)
+			target += m_aim;  // hit the ball off center to send it sideways
+		else
+			m_aim = m_random.uniform(-0.2f, 0.2f);
+
+		int pixels = (int)std::lround((target - white.getCenter().x) / sim::PADDLE_STEP);
+		pixels = std::min(std::max(pixels, -m_maxPixels), m_maxPixels);
+		if (pixels != 0)
+			game.movePaddle((float)pixels * sim::PADDLE_STEP);
+	}
+
+private:
+	sim::CRandom        m_random;
+	int                 m_maxPixels;
+	float               m_aim;
+};
+
+sim::TableSettings::TableSettings(void)
+{
+	ballNum = BALLNUM;
+	frameMicros = 16000;
+	maxFrames = 200000;
+	continuous = true;
+	dynamic = false;
+	eventDriven = false;
+	friction = false;
+	pack = NULL;
+}
+
+sim::CTableServer::CTableServer(CWorkPool* pool)
+{
+	m_pool = pool;
+	m_workers.resize(pool != NULL ? pool->getWorkers() : 1);
+}
+
+void sim::CTableServer::play(CGame& game, unsigned long long seed, int table, TableResult& result) const
+{
+	PROF_ZONE("table");
+	float dt = deltaFromMicros(m_settings.frameMicros);
+	CPaddleBot bot(CRandom(seed).stream(STREAM_PLAYER), BOT_STEP * dt / BOT_FRAME);
+
+	game.setContinuous(m_settings.continuous);
+	game.setDynamic(m_settings.dynamic);
+	game.setEventDriven(m_settings.eventDriven);
+	game.setFriction(m_settings.friction);
+	game.setPool(NULL);  // the tables run side by side instead
+	const CLevelPack* pack = m_settings.pack;
+	game.setLevelPack(pack != NULL && table < pack->getTables() ? pack : NULL, table);
+	game.setup(seed);
+
+	long frames = 0;
+	while (!game.isOver() && frames < m_settings.maxFrames)
+	{
+		bot.play(game);
+		game.step(dt);
+		frames++;
+	}
+
+	result.seed = seed;
+	result.frames = frames;
+	result.level = game.getLevel();
+	result.destroyNum = game.getDestroyNum();
+	result.life = game.getLife();
+	result.win = game.isWin();
+	result.defeated = game.isDefeated();
+	result.failed = game.isFailed();
+}
+
+void sim::CTableServer::run(unsigned long long seed, int count, std::vector<TableResult>& results)
+{
+	results.resize(count);
+	for (size_t w = 0; w < m_workers.size(); w++)
+	{
+		Worker& worker = m_workers[w];
+		if (worker.game.getBallNum() != m_settings.ballNum)
+			worker.game = CGame(m_settings.ballNum);
+		worker.frames = 0;
+		worker.games = 0;
+	}
+
+	// one table per chunk: games differ in length by orders of magnitude, stealing single
+	// tables keeps the workers busy to the end
+	CRandom master(seed);
+	auto tables = [&](int begin, int end, int w) {
+		Worker& worker = m_workers[w];
+		for (int g = begin; g < end; g++)
+		{
+			play(worker.game, master.at((unsigned long long)g), g, results[g]);
+			worker.frames += results[g].frames;
+			worker.games++;
+		}
+	};
+	if (m_pool != NULL)
+		m_pool->parallelFor(count, 1, tables);
+	else
+		tables(0, count, 0);
+}
+
+long long sim::CTableServer::getFrames(void) const
+{
+	long long frames = 0;
+	for (size_t w = 0; w < m_workers.size(); w++)
+		frames += m_workers[w].frames;
+	return frames;
+}
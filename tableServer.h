@@ -0,0 +1,87 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// File: tableServer.h
+//
+// Desc: Multi-table simulation server for tournament scoring and bot evaluation. Plays many
+//       independent games (setup, frames with scripted paddle input, level ups, until the
+//       game is over) on the work-stealing pool: every worker owns a game it sets up again
+//       for each table it takes, and workers that run out of tables steal from the others,
+//       so a few long games do not hold the batch up.
+//
+//       The scripted player is headlessLego's bot without assist: the paddle follows the red
+//       ball in whole mouse pixels and hits it a little off center. Game g is set up on
+//       CRandom(seed).at(g) and steps frames of whole microseconds, so it plays exactly as
+//       game g of headlessLego -seed does, whatever the number of workers.
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __tableServerH__
+#define __tableServerH__
+
+#include "simCore.h"
+#include <vector>
+
+namespace sim
+{
+	class CWorkPool;
+
+	struct TableSettings
+	{
+		int                 ballNum;
+		unsigned int        frameMicros;  // frame time, as the front end gets it
+		long                maxFrames;    // per game, the game is unfinished past it
+		bool                continuous;
+		bool                dynamic;
+		bool                eventDriven;
+		bool                friction;
+		const CLevelPack*   pack;         // table g plays the levels of pack table g, NULL: none
+
+		TableSettings(void);
+	};
+
+	struct TableResult
+	{
+		unsigned long long  seed;
+		long                frames;
+		int                 level;
+		int                 destroyNum;
+		int                 life;
+		bool                win;
+		bool                defeated;
+		bool                failed;
+	};
+
+	class CTableServer {
+	public:
+		explicit CTableServer(CWorkPool* pool);  // NULL: every table on the calling thread
+
+		TableSettings& getSettings(void) { return m_settings; }
+
+		// plays games 0 to count - 1 of the master seed, results[g] is game g
+		void run(unsigned long long seed, int count, std::vector<TableResult>& results);
+
+		// of the last run
+		long long getFrames(void) const;
+		int getWorkers(void) const { return (int)m_workers.size(); }
+		long long getWorkerFrames(int worker) const { return m_workers[worker].frames; }
+		int getWorkerGames(int worker) const { return m_workers[worker].games; }
+
+	private:
+		void play(CGame& game, unsigned long long seed, int table, TableResult& result) const;
+
+		// one per worker, a cache line apart
+		struct Worker
+		{
+			CGame               game;
+			long long           frames;
+			int                 games;
+			char                pad[64];
+		};
+
+		CWorkPool*          m_pool;
+		TableSettings       m_settings;
+		std::vector<Worker> m_workers;
+	};
+}
+
+#endif // __tableServerH__
@@ -0,0 +1,331 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// File: testLego.cpp
+//
+// Desc: Checks of the device-free render path, run by ctest. The mesh generators against the
+//       counts meshCache.h documents, with unit normals and indices inside the vertex list;
+//       the references of the mesh cache; and the batching rules (render::checkSubmission) on
+//       every frame of a few short games, as renderLego checks them. Also the layouts of the
+//       levels on tables with bumpers and pockets (CStaticGeometry::makeCourse), and the
+//       lost balls and the rollout count of the shot evaluator, and the entity handles that
+//       go stale when their ball dies or the level is cleared.
+//
+//       usage: testLego   (the exit code is the number of failed checks)
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "hudText.h"
+#include "meshCache.h"
+#include "renderList.h"
+#include "shotEvaluator.h"
+#include "simCore.h"
+#include "simThread.h"
+#include "tableScene.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+static int g_failed = 0;
+
+#define CHECK(condition) check((condition), #condition, __LINE__)
+
+static bool check(bool condition, const char* text, int line)
+{
+	if (!condition)
+	{
+		printf("testLego.cpp(%d): failed: %s\n", line, text);
+		g_failed++;
+	}
+	return condition;
+}
+
+// normals of unit length and every index inside the vertex list
+static void checkGeometry(const render::Geometry& geometry)
+{
+	int bad = 0;
+	for (size_t i = 0; i < geometry.vertices.size(); i++)
+	{
+		const render::Vertex& v = geometry.vertices[i];
+		float length = std::sqrt(v.nx * v.nx + v.ny * v.ny + v.nz * v.nz);
+		if (std::fabs(length - 1) > 1e-5f)
+			bad++;
+	}
+	CHECK(bad == 0);
+	CHECK(geometry.indices.size() % 3 == 0);
+	unsigned short top = 0;
+	for (size_t i = 0; i < geometry.indices.size(); i++)
+		top = std::max(top, geometry.indices[i]);
+	CHECK(top < geometry.vertices.size());
+}
+
+static void testGenerators(void)
+{
+	const int sizes[][2] = { { 3, 2 }, { 6, 4 }, { 20, 20 }, { 32, 17 } };
+	for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+	{
+		int slices = sizes[i][0], stacks = sizes[i][1];
+		render::Geometry sphere;
+		render::generateSphere(0.21f, slices, stacks, sphere);
+		CHECK(sphere.getTriangleCount() == slices * (stacks - 1) * 2);
+		CHECK((int)sphere.vertices.size() == slices * (stacks - 1) + 2);
+		checkGeometry(sphere);
+	}
+
+	render::Geometry box;
+	render::generateBox(6, 0.12f, 0.5f, box);
+	CHECK(box.getTriangleCount() == 12);
+	CHECK(box.vertices.size() == 24);
+	checkGeometry(box);
+}
+
+static void testCacheReferences(void)
+{
+	render::CMeshCache cache;
+	const render::MeshDesc& ball = render::CTableScene::getMesh(render::CTableScene::MESH_BALL);
+	render::MeshLods first, second;
+	cache.acquireLods(ball, first);
+	cache.acquireLods(ball, second);
+	CHECK(first.count > 1 && first.count == second.count);
+	for (int l = 0; l < first.count; l++)
+	{
+		CHECK(first.mesh[l] == second.mesh[l]);
+		CHECK(cache.getRefCount(first.mesh[l]) == 2);
+	}
+	CHECK(cache.getMeshCount() == first.count);
+
+	render::MeshLods kept = first;
+	cache.releaseLods(first);
+	CHECK(first.count == 0);
+	for (int l = 0; l < kept.count; l++)
+		CHECK(cache.getRefCount(kept.mesh[l]) == 1);
+	cache.releaseLods(second);
+	for (int l = 0; l < kept.count; l++)
+	{
+		CHECK(cache.getRefCount(kept.mesh[l]) == 0);
+		CHECK(!cache.isLive(kept.mesh[l]));
+	}
+	CHECK(cache.getMeshCount() == 0);
+	CHECK(cache.getBytes() == 0);
+}
+
+// renderLego's frame loop without the options: record, sort, submit and the HUD, then the
+// batching rules on the log of the frame
+static void testFrames(void)
+{
+	render::CGlyphAtlas atlas;
+	int advances[render::GLYPH_COUNT];
+	for (int i = 0; i < render::GLYPH_COUNT; i++)
+		advances[i] = 13;
+	atlas.build(16, 24, advances);
+	render::CHudText hud;
+	hud.setAtlas(&atlas);
+
+	render::CMeshCache cache;
+	render::CTableScene scene;
+	render::CRenderList list;
+	render::CRecordingBackend backend;
+	render::Matrix world, view, proj;
+	render::setIdentity(world);
+	render::CTableScene::getCamera(1024.0f / 768, view, proj);
+	scene.setup(list, cache);
+	scene.setView(view, proj, 768);
+	const int meshes = cache.getMeshCount();
+
+	sim::CRandom master(1);
+	sim::Snapshot frame;
+	int bad = 0, frames = 0;
+	for (int g = 0; g < 3; g++)
+	{
+		sim::CGame game;
+		if (!CHECK(game.setup(master.at((unsigned long long)g))))
+			continue;
+		scene.setup(list, cache);  // again for every game, as the front end on a new level
+		CHECK(cache.getMeshCount() == meshes);
+
+		for (long f = 0; !game.isOver() && f < 2000; f++, frames++)
+		{
+			if (!game.isLaunched())
+				game.launch();
+			float dx = game.getRedBall().getCenter().x - game.getWhiteBall().getCenter().x;
+			game.movePaddle(std::min(std::max(dx, -0.05f), 0.05f));
+			game.step(16 * sim::GAME_TIME_PER_MS);
+			frame.capture(game, f, 0);
+
+			backend.beginFrame();
+			list.clear();
+			render::SceneStats drawn = scene.record(frame, world, list);
+			list.sort();
+			render::submit(list, backend);
+			render::HudState state = { frame.life, frame.destroyNum, frame.level, frame.win, frame.defeated,
+				drawn.objects, drawn.objects - drawn.culled, drawn.triangles };
+			hud.update(state);
+			hud.submit(backend);
+
+			if (!render::checkSubmission(list, backend, render::CTableScene::countLegacyCalls(frame)))
+				bad++;
+		}
+	}
+	CHECK(frames > 0);
+	CHECK(bad == 0);
+
+	scene.release();
+	CHECK(cache.getMeshCount() == 0);
+}
+
+// every ball of a level, the blue one too, inside the limits and clear of the pieces
+static void testCourseLayouts(void)
+{
+	sim::CSpatialGrid grid;
+	sim::CPoissonDisk sampler;
+	std::vector<sim::Vec2> positions;
+	sim::initTableGrid(grid);
+	sim::CStaticGeometry course;
+	sim::CBall blue;
+	const float r = (float)M_RADIUS;
+
+	sim::CRandom master(1);
+	int bad = 0, placed = 0;
+	for (int t = 0; t < 20; t++)
+	{
+		sim::CRandom table(master.at((unsigned long long)t));
+		course.makeCourse(40, table.stream(sim::STREAM_COURSE));
+		for (int level = 1; level <= 5; level++)
+		{
+			bool blueActivated = false;
+			if (!sim::generateLevel(table, level, BALLNUM, course, positions, grid, sampler, blue, blueActivated))
+				continue;
+			placed++;
+			if (blueActivated)
+				positions.push_back(blue.getCenter());
+			for (size_t i = 0; i < positions.size(); i++)
+			{
+				float x = positions[i].x, z = positions[i].z;
+				if (course.findOverlap(x, z, r) >= 0 || course.isDrained(x, z) ||
+					std::fabs(x) > course.getLimitX() - r || z > course.getLimitZ() - r)
+					bad++;
+			}
+		}
+	}
+	CHECK(placed > 0);
+	CHECK(bad == 0);
+}
+
+// one rollout per candidate without noise, against the same play: a ball friction stopped
+// costs no life, so it is no loss for the evaluator either
+static void testFrictionRollouts(void)
+{
+	sim::CShotEvaluator evaluator;
+	sim::ShotSettings& settings = evaluator.getSettings();
+	settings.rollouts = 1;
+	settings.angleNoise = settings.positionNoise = 0;
+	std::vector<sim::ShotCandidate> candidates;
+	sim::CShotEvaluator::makeGrid(9, 9, 0.6f, candidates);
+	std::vector<sim::ShotResult> results(candidates.size());
+	const float strip = sim::WALL_Z_MIN - 2 * (float)M_RADIUS;
+
+	int stopped = 0, lost = 0, bad = 0;
+	for (unsigned long long seed = 1; seed <= 5; seed++)
+	{
+		sim::CGame game;
+		game.setFriction(true);
+		if (!CHECK(game.setup(seed)))
+			continue;
+		CHECK(evaluator.evaluate(game, candidates.data(), (int)candidates.size(), sim::CRandom(seed), results.data()));
+
+		for (size_t c = 0; c < candidates.size(); c++)
+		{
+			// the rollout up to the ball back on the paddle or coming down to it again
+			sim::CGame play = game;
+			play.movePaddle(candidates[c].x - play.getWhiteBall().getCenter().x);
+			play.launch(candidates[c].angle);
+			bool left = false;
+			for (int f = 0; f < settings.maxFrames && play.getLevel() == 1 && !play.isOver(); f++)
+			{
+				float dx = play.getRedBall().getCenter().x - play.getWhiteBall().getCenter().x;
+				play.movePaddle(std::min(std::max(dx, -settings.paddleStep), settings.paddleStep));
+				play.step(settings.dt);
+				if (!play.isLaunched())
+				{
+					bool blue = play.getBlueBall().isNull() && !game.getBlueBall().isNull();  // one life more
+					bool loss = play.getLife() < game.getLife() + (blue ? 1 : 0);
+					(loss ? lost : stopped)++;
+					if (results[c].lifeLoss != (loss ? 1.0f : 0.0f))
+						bad++;
+					break;
+				}
+				if (play.getRedBall().getCenter().z > strip)
+					left = true;
+				else if (left && play.getRedBall().getVelocity_Z() > 0)
+					break;
+			}
+		}
+	}
+	CHECK(stopped > 0 && lost > 0);
+	CHECK(bad == 0);
+}
+
+// giveUpAfter 0 never gives a candidate up, every one plays all its rollouts
+static void testGiveUp(void)
+{
+	sim::CShotEvaluator evaluator;
+	sim::ShotSettings& settings = evaluator.getSettings();
+	settings.rollouts = 4;
+	settings.giveUpAfter = 0;
+	std::vector<sim::ShotCandidate> candidates;
+	sim::CShotEvaluator::makeGrid(3, 3, 0.6f, candidates);
+	std::vector<sim::ShotResult> results(candidates.size());
+
+	sim::CGame game;
+	if (!CHECK(game.setup(1)))
+		return;
+	CHECK(evaluator.evaluate(game, candidates.data(), (int)candidates.size(), sim::CRandom(1), results.data()));
+	int bad = 0;
+	for (size_t c = 0; c < results.size(); c++)
+	{
+		if (results[c].rollouts != settings.rollouts)
+			bad++;
+	}
+	CHECK(bad == 0);
+}
+
+// a handle goes stale when its ball dies and when the next level clears the store, even
+// though the index comes back alive
+static void testEntityHandles(void)
+{
+	sim::CBallStore balls;
+	for (int i = 0; i < 4; i++)
+		balls.add((float)i, 0, 0.2f);
+	sim::EntityHandle first = balls.getHandle(0);
+	sim::EntityHandle second = balls.getHandle(1);
+	CHECK(balls.isValid(first) && balls.isValid(second));
+
+	balls.destroy(1);
+	CHECK(balls.isValid(first));
+	CHECK(!balls.isValid(second));
+
+	// what placeBalls does for a new level
+	balls.clear();
+	for (int i = 0; i < 4; i++)
+		balls.add((float)i, 1, 0.2f);
+	CHECK(balls.isAlive(0) && balls.isAlive(1));
+	CHECK(!balls.isValid(first));
+	CHECK(!balls.isValid(second));
+	CHECK(balls.isValid(balls.getHandle(0)));
+
+	sim::EntityHandle outside = { 4, 0 };
+	CHECK(!balls.isValid(outside));
+}
+
+int main(void)
+{
+	testGenerators();
+	testCacheReferences();
+	testFrames();
+	testCourseLayouts();
+	testFrictionRollouts();
+	testGiveUp();
+	testEntityHandles();
+	printf("%d failed check(s)\n", g_failed);
+	return std::min(g_failed, 255);
+}
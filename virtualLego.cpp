@@ -11,10 +11,16 @@
 ////////////////////////////////////////////////////////////////////////////////
 
 #include "d3dUtility.h"
+#include "d3dBackend.h"
+#include "levelPack.h"
+#include "platformWin32.h"
+#include "profiler.h"
+#include "simThread.h"
+#include "tableScene.h"
 #include <vector>
-#include <ctime>
 #include <cstdlib>
 #include <cstdio>
+#include <cstring>
 #include <cassert>
 
 IDirect3DDevice9* Device = NULL;
@@ -30,372 +36,8 @@ D3DXMATRIX g_mWorld;
 D3DXMATRIX g_mView;
 D3DXMATRIX g_mProj;
 
-#define BALLNUM 20  //  
-#define LIFENUM 2  //  
-#define M_RADIUS 0.15   // sphere 
+// BALLNUM, LIFENUM, M_RADIUS  simCore.h  
 #define PI 3.14159265
-#define M_HEIGHT 0.01
-#define DECREASE_RATE 0.9982
-
-// -----------------------------------------------------------------------------
-// CSphere class definition
-// -----------------------------------------------------------------------------
-
-class CSphere {
-private:
-    float               center_x, center_y, center_z;
-    float                   m_radius;
-    float               m_velocity_x;
-    float               m_velocity_z;
-
-public:
-    CSphere(void)
-    {
-        D3DXMatrixIdentity(&m_mLocal);
-        ZeroMemory(&m_mtrl, sizeof(m_mtrl));
-        m_radius = 0;
-        m_velocity_x = 0;
-        m_velocity_z = 0;
-        m_pSphereMesh = NULL;
-    }
-    ~CSphere(void) {}
-
-public:
-    bool create(IDirect3DDevice9* pDevice, D3DXCOLOR color = d3d::WHITE)
-    {
-        if (NULL == pDevice)
-            return false;
-
-        m_mtrl.Ambient = color;
-        m_mtrl.Diffuse = color;
-        m_mtrl.Specular = color;
-        m_mtrl.Emissive = d3d::BLACK;
-        m_mtrl.Power = 5.0f;
-
-        if (FAILED(D3DXCreateSphere(pDevice, getRadius(), 50, 50, &m_pSphereMesh, NULL)))
-            return false;
-        return true;
-    }
-
-    void destroy(void)
-    {
-        if (m_pSphereMesh != NULL) {
-            m_pSphereMesh->Release();
-            m_pSphereMesh = NULL;
-        }
-    }
-
-    void draw(IDirect3DDevice9* pDevice, const D3DXMATRIX& mWorld)
-    {
-        if (NULL == pDevice)
-            return;
-        pDevice->SetTransform(D3DTS_WORLD, &mWorld);
-        pDevice->MultiplyTransform(D3DTS_WORLD, &m_mLocal);
-        pDevice->SetMaterial(&m_mtrl);
-        m_pSphereMesh->DrawSubset(0);
-    }
-
-    bool hasIntersected(CSphere& ball)
-    {
-        D3DXVECTOR3 center1 = this->getCenter();
-        D3DXVECTOR3 center2 = ball.getCenter();
-        float distance = D3DXVec3Length(&(center1 - center2)); //   ߽  Ÿ
-
-        if (distance < (this->getRadius() + ball.getRadius())) {
-            //  ģ  ġ 
-            D3DXVECTOR3 collisionNormal = center2 - center1;
-            D3DXVec3Normalize(&collisionNormal, &collisionNormal);
-
-            float overlap = (this->getRadius() + ball.getRadius()) - distance;
-
-            //   ݴ  ̵
-            this->setCenter(center1.x - collisionNormal.x * (overlap / 2),
-                center1.y,
-                center1.z - collisionNormal.z * (overlap / 2));
-
-            return true;
-        }
-        return false;
-    }
-
-    bool hitBy(CSphere& ball)
-    {
-        if (hasIntersected(ball)) {
-            //   ߽ ǥ
-            D3DXVECTOR3 center1 = this->getCenter();
-            D3DXVECTOR3 center2 = ball.getCenter();
-
-            // 浹    (1 -> 2)
-            D3DXVECTOR3 collisionNormal = center2 - center1;
-            D3DXVec3Normalize(&collisionNormal, &collisionNormal); // ȭ
-
-            //  ӵ 
-            D3DXVECTOR3 velocity1(this->getVelocity_X(), 0, this->getVelocity_Z());
-            D3DXVECTOR3 velocity2(ball.getVelocity_X(), 0, ball.getVelocity_Z());
-
-            // 浹  Ϳ  ӵ   
-            float v1_dot_n = D3DXVec3Dot(&velocity1, &collisionNormal);
-            float v2_dot_n = D3DXVec3Dot(&velocity2, &collisionNormal);
-
-            // ο ӵ  (ݻ )
-            D3DXVECTOR3 newVelocity1 = velocity1 - 2 * v1_dot_n * collisionNormal;
-            D3DXVECTOR3 newVelocity2 = velocity2 - 2 * v2_dot_n * collisionNormal;
-
-            // ο ӵ  
-            this->setPower(newVelocity1.x, newVelocity1.z);
-            //ball.setPower(newVelocity2.x, newVelocity2.z);    -    ֱ⿡ ʿX
-            return true;
-        }
-        return false;
-    }
-
-    void ballUpdate(float timeDiff)
-    {
-        const float TIME_SCALE = 3.3;
-        D3DXVECTOR3 cord = this->getCenter();
-        double vx = abs(this->getVelocity_X());
-        double vz = abs(this->getVelocity_Z());
-
-
-        if (vx > 0.01 || vz > 0.01)
-        {
-            float tX = cord.x + TIME_SCALE * timeDiff * m_velocity_x;
-            float tZ = cord.z + TIME_SCALE * timeDiff * m_velocity_z;
-
-            //correction of position of ball
-            // Please uncomment this part because this correction of ball position is necessary when a ball collides with a wall
-            if (tX >= (3 - M_RADIUS))
-                tX = 3 - M_RADIUS;
-            else if (tX <= (-3 + M_RADIUS))
-                tX = -3 + M_RADIUS;
-            //else if(tZ <= (-3.5 + M_RADIUS))
-            //   tZ = -3.5 + M_RADIUS;
-            else if (tZ >= (3.5 - M_RADIUS))
-                tZ = 3.5 - M_RADIUS;
-
-            this->setCenter(tX, cord.y, tZ);
-        }
-
-
-
-        else { this->setPower(0, 0); }
-        //this->setPower(this->getVelocity_X() * DECREASE_RATE, this->getVelocity_Z() * DECREASE_RATE);
-        double rate = 1 - (1 - DECREASE_RATE) * timeDiff * 400;
-        if (rate < 0)
-            rate = 0;
-        //this->setPower(getVelocity_X() * rate, getVelocity_Z() * rate);
-    }
-
-    double getVelocity_X() { return this->m_velocity_x; }
-    double getVelocity_Z() { return this->m_velocity_z; }
-
-    void setPower(double vx, double vz)
-    {
-        this->m_velocity_x = vx;
-        this->m_velocity_z = vz;
-    }
-
-    void setCenter(float x, float y, float z)
-    {
-        D3DXMATRIX m;
-        center_x = x;   center_y = y;   center_z = z;
-        D3DXMatrixTranslation(&m, x, y, z);
-        setLocalTransform(m);
-    }
-
-    float getRadius(void)  const { return (float)(M_RADIUS); }
-    const D3DXMATRIX& getLocalTransform(void) const { return m_mLocal; }
-    void setLocalTransform(const D3DXMATRIX& mLocal) { m_mLocal = mLocal; }
-    D3DXVECTOR3 getCenter(void) const
-    {
-        D3DXVECTOR3 org(center_x, center_y, center_z);
-        return org;
-    }
-
-    bool isNull() const {
-        if (this->m_pSphereMesh == NULL) {
-            return true;
-        }
-        return false;
-    }
-
-private:
-    D3DXMATRIX              m_mLocal;
-    D3DMATERIAL9            m_mtrl;
-    ID3DXMesh* m_pSphereMesh;
-
-};
-
-// -----------------------------------------------------------------------------
-// CWall class definition
-// -----------------------------------------------------------------------------
-
-class CWall {
-
-private:
-
-    float               m_x;
-    float               m_z;
-    float                   m_width;
-    float                   m_depth;
-    float               m_height;
-
-public:
-    CWall(void)
-    {
-        D3DXMatrixIdentity(&m_mLocal);
-        ZeroMemory(&m_mtrl, sizeof(m_mtrl));
-        m_width = 0;
-        m_depth = 0;
-        m_pBoundMesh = NULL;
-    }
-    ~CWall(void) {}
-public:
-    bool create(IDirect3DDevice9* pDevice, float ix, float iz, float iwidth, float iheight, float idepth, D3DXCOLOR color = d3d::WHITE)
-    {
-        if (NULL == pDevice)
-            return false;
-
-        m_mtrl.Ambient = color;
-        m_mtrl.Diffuse = color;
-        m_mtrl.Specular = color;
-        m_mtrl.Emissive = d3d::BLACK;
-        m_mtrl.Power = 5.0f;
-
-        m_width = iwidth;
-        m_depth = idepth;
-
-        if (FAILED(D3DXCreateBox(pDevice, iwidth, iheight, idepth, &m_pBoundMesh, NULL)))
-            return false;
-        return true;
-    }
-    void destroy(void)
-    {
-        if (m_pBoundMesh != NULL) {
-            m_pBoundMesh->Release();
-            m_pBoundMesh = NULL;
-        }
-    }
-    void draw(IDirect3DDevice9* pDevice, const D3DXMATRIX& mWorld)
-    {
-        if (NULL == pDevice)
-            return;
-        pDevice->SetTransform(D3DTS_WORLD, &mWorld);
-        pDevice->MultiplyTransform(D3DTS_WORLD, &m_mLocal);
-        pDevice->SetMaterial(&m_mtrl);
-        m_pBoundMesh->DrawSubset(0);
-    }
-
-    bool hasIntersected(CSphere& ball) {
-        float ballX = ball.getCenter().x;
-        float ballZ = ball.getCenter().z;
-        float ballR = ball.getRadius();
-
-        float wallXmin = this->m_x - (this->m_width / 2 + ballR);
-        float wallXmax = this->m_x + (this->m_width / 2 + ballR);
-        float wallZmin = this->m_z - (this->m_depth / 2 + ballR);
-        float wallZmax = this->m_z + (this->m_depth / 2 + ballR);
-
-        if ((wallXmin <= ballX && ballX <= wallXmax) && (wallZmin <= ballZ && ballZ <= wallZmax)) {
-            return true;
-        }
-
-        return false;
-    }
-
-
-    void hitBy(CSphere& ball) {
-        if (hasIntersected(ball)) {
-            float ballX = ball.getCenter().x;
-            float ballY = ball.getCenter().y;
-            float ballZ = ball.getCenter().z;
-            float ballR = ball.getRadius();
-
-            float wallXmin = this->m_x - (this->m_width / 2);
-            float wallXmax = this->m_x + (this->m_width / 2);
-            float wallZmin = this->m_z - (this->m_depth / 2);
-            float wallZmax = this->m_z + (this->m_depth / 2);
-
-            if ((wallXmin <= ballX && ballX <= wallXmax) && !(wallZmin <= ballZ && ballZ <= wallZmax)) {
-                if (wallZmin - ballR <= ballZ && ballZ <= this->m_z) {
-                    ballZ = wallZmin - ballR - 0.01f;
-                    ball.setCenter(ballX, ballY, ballZ);
-                }
-                else {
-                    ball.setCenter((wallXmax - wallXmin) / 2 + wallXmin, 0, wallZmin + 0.1);
-                    ball.setPower(0, 0);
-                }
-
-                ball.setPower(ball.getVelocity_X(), -ball.getVelocity_Z());
-            }
-
-            if (!(wallXmin <= ballX && ballX <= wallXmax) && (wallZmin <= ballZ && ballZ <= wallZmax)) {
-                if (wallXmin - ballR <= ballX && ballX <= this->m_x) {
-                    ballX = wallXmin - ballR - 0.01f;
-                    ball.setCenter(ballX, ballY, ballZ);
-                }
-                else {
-                    ballX = wallXmax + ballR + 0.01f;
-                    ball.setCenter(ballX, ballY, ballZ);
-                }
-
-                ball.setPower(-ball.getVelocity_X(), ball.getVelocity_Z());
-            }
-
-        }
-
-    }
-
-    //bool hasIntersected(CSphere& ball) {
-    //    D3DXVECTOR3 center = ball.getCenter(); 
-    //    float radius = ball.getRadius(); 
-    //    // Check if the sphere's center is within the bounds of the wall, considering the sphere's radius 
-    //    if ((abs(center.x - m_x) <= radius+m_width/2) && (abs(center.z - m_z) <= radius + m_depth / 2)) {
-    //        return true; 
-    //    } 
-    //    return false; 
-    //} 
-    //
-    //void hitBy(CSphere& ball) {
-    //    if (hasIntersected(ball)) {
-    //        D3DXVECTOR3 center = ball.getCenter(); float radius = ball.getRadius(); //  ǥ    
-    //        D3DXVECTOR3 velocity(ball.getVelocity_X(), 0, ball.getVelocity_Z());
-
-    //        if ((abs(center.z - m_z) <= radius + m_depth / 2) && m_width >= 6) {
-    //            if (center.z < m_z) {
-    //                // 
-    //                ball.setPower(velocity.x, -velocity.z);
-    //                return;
-    //            }
-    //        } if ((abs(center.x - m_x) <= radius + m_width / 2) && m_height >= 7) {
-    //            //̴ ̴
-    //            ball.setPower(-velocity.x, velocity.z);
-    //        }
-    //    }
-    //}
-
-    void setPosition(float x, float y, float z)
-    {
-        D3DXMATRIX m;
-        this->m_x = x;
-        this->m_z = z;
-
-        D3DXMatrixTranslation(&m, x, y, z);
-        setLocalTransform(m);
-    }
-
-
-    float getHeight(void) const { return M_HEIGHT; }
-
-
-
-private:
-    void setLocalTransform(const D3DXMATRIX& mLocal) { m_mLocal = mLocal; }
-
-    D3DXMATRIX              m_mLocal;
-    D3DMATERIAL9            m_mtrl;
-    ID3DXMesh* m_pBoundMesh;
-};
 
 // -----------------------------------------------------------------------------
 // CLight class definition
@@ -409,7 +51,6 @@ public:
         m_index = i++;
         D3DXMatrixIdentity(&m_mLocal);
         ::ZeroMemory(&m_lit, sizeof(m_lit));
-        m_pMesh = NULL;
         m_bound._center = D3DXVECTOR3(0.0f, 0.0f, 0.0f);
         m_bound._radius = 0.0f;
     }
@@ -419,8 +60,6 @@ public:
     {
         if (NULL == pDevice)
             return false;
-        if (FAILED(D3DXCreateSphere(pDevice, radius, 10, 10, &m_pMesh, NULL)))
-            return false;
 
         m_bound._center = lit.Position;
         m_bound._radius = radius;
@@ -440,13 +79,6 @@ public:
         m_lit.Phi = lit.Phi;
         return true;
     }
-    void destroy(void)
-    {
-        if (m_pMesh != NULL) {
-            m_pMesh->Release();
-            m_pMesh = NULL;
-        }
-    }
     bool setLight(IDirect3DDevice9* pDevice, const D3DXMATRIX& mWorld)
     {
         if (NULL == pDevice)
@@ -462,24 +94,12 @@ public:
         return true;
     }
 
-    void draw(IDirect3DDevice9* pDevice)
-    {
-        if (NULL == pDevice)
-            return;
-        D3DXMATRIX m;
-        D3DXMatrixTranslation(&m, m_lit.Position.x, m_lit.Position.y, m_lit.Position.z);
-        pDevice->SetTransform(D3DTS_WORLD, &m);
-        pDevice->SetMaterial(&d3d::WHITE_MTRL);
-        m_pMesh->DrawSubset(0);
-    }
-
     D3DXVECTOR3 getPosition(void) const { return D3DXVECTOR3(m_lit.Position); }
 
 private:
     DWORD               m_index;
     D3DXMATRIX          m_mLocal;
     D3DLIGHT9           m_lit;
-    ID3DXMesh* m_pMesh;
     d3d::BoundingSphere m_bound;
 };
 
@@ -487,250 +107,72 @@ private:
 // -----------------------------------------------------------------------------
 // Global variables
 // -----------------------------------------------------------------------------
-CWall   g_legoPlane;
-CWall   g_legowall[3];
-CSphere   g_sphere[BALLNUM];
-CSphere   g_target_whiteball;
-CSphere   g_target_redball;
-CSphere   g_target_blueball;
 CLight   g_light;
 
-ID3DXFont* g_pFont_life = NULL;
-ID3DXFont* g_pFont_level = NULL;
-ID3DXFont* g_pFont_start = NULL;
-ID3DXFont* g_pFont_endMess = NULL;
+// , , ,  ǥô  Ͽ   ޽/  ؼ   ׸
+render::CMeshCache g_meshCache;  //   ޽ô ϳ ؼ  ( īƮ)
+render::CTableScene g_scene;
+render::CRenderList g_renderList;
+render::CD3DBackend g_renderBackend;
 
-int spaceActivate = 0;
-int life;  // life  
-int destroyNum;  // ı   ( īƮ )
-bool win;  // ¸  Ȯ
-bool blueActivated = false;  // Ķ  (߰) Ȱȭ 
-int level = 1;  // ʱ 
-double speed = 2;  // ʱ   ӵ
+// ȭ : ۲ ϳ  ؽó ϰ, ġ  簢 
+render::CGlyphAtlas g_glyphAtlas;
+render::CHudText g_hud;
 
-double g_camera_pos[3] = { 0.0, 5.0, -8.0 };
+platform::CWin32Platform g_platform;  // â, Է ̺Ʈ, ػ ð
+
+sim::CSimThread g_sim;  //   (  Ģ  ƽ simCore  ó)
+sim::Snapshot g_frame;  // ̹ ӿ ׸  (ֱ   )
+sim::CReplayWriter g_replay;  // -record <>: Է  (replayLego  )
+char g_replayPath[MAX_PATH] = "";
+sim::CLevelPack g_levelPack;  // -pack <>: ̸   ġ (packLego), ޸𸮿 
 
-const float WALL_X_MIN = -2.8f, WALL_X_MAX = 2.8f;  // WALL β ؼ Ƿ  ʺ ּ, ʺ ִ밪
-const float WALL_Z_MIN = -2.6f, WALL_Z_MAX = 3.3f;  //  ּҰ ٸ    +    ġ 
-float spherePos[BALLNUM][2];  //   x, y ǥ
+//  ð: ֱ 1024   â  ǥ (p50 / p99 / p99.9)
+// T Ű Ǵ -trace <>:   Ѱ, ٽ T  ų   Chrome trace  
+prof::CFrameHistogram g_frameTimes;
+unsigned long long g_frameStart = 0;
+char g_tracePath[MAX_PATH] = "virtualLego.trace.json";
 
-std::vector<D3DXCOLOR> sphereColor(BALLNUM, d3d::YELLOW);  //    Ҵ ()
+double g_camera_pos[3] = { 0.0, 5.0, -8.0 };
 
 // -----------------------------------------------------------------------------
 // Functions
 // -----------------------------------------------------------------------------
 
 
-void destroyAllLegoBlock(void)
+// ʱȭ
+bool Setup()
 {
-    for (int i = 0; i < BALLNUM; i++) {
-        if (!g_sphere->isNull()) {
-            g_sphere[i].destroy();
-        }
-    }
-    g_target_redball.destroy();
-    g_target_whiteball.destroy();
-    g_legoPlane.destroy();
-}
-
-void resetGame() {  // پ  ȣǴ Լ. 
-    g_target_redball.create(Device, d3d::RED);      //  
-    g_target_redball.setCenter(g_target_whiteball.getCenter().x, g_target_whiteball.getCenter().y, g_target_whiteball.getCenter().z + g_target_whiteball.getRadius() * 2); //   
-    g_target_redball.setPower(0, 0);    //ӵ 
-    spaceActivate = 0;   //߻縦  ٽ spaceActivate = 0
-}
-
-//   Ÿ  Լ
-bool isColliding(float x1, float z1, float x2, float z2) {
-    float dx = x1 - x2;
-    float dz = z1 - z2;
-    return (dx * dx + dz * dz) < (4 * M_RADIUS * M_RADIUS);  // Ÿ      񱳷 浹  Ǻ
-}
-
-//  ġ  Լ
-void generateRandomPositions(float spherePos[BALLNUM][2]) {
-    std::srand(static_cast<unsigned int>(std::time(nullptr)));  //  õ 
-
-    for (int i = 0; i < BALLNUM; ++i) {
-        bool validPosition = false;
-        float x, z;
-
-        while (!validPosition) {
-            //  ġ   ( wall /Ʒ  (, ּڰ) + 0.0~1.0   εҼ  *  )
-            x = WALL_X_MIN + static_cast<float>(std::rand()) / RAND_MAX * (WALL_X_MAX - WALL_X_MIN);
-            z = WALL_Z_MIN + static_cast<float>(std::rand()) / RAND_MAX * (WALL_Z_MAX - WALL_Z_MIN);
-
-            //   浹  Ȯ
-            validPosition = true;
-            for (int j = 0; j < i; ++j) {
-                if (isColliding(x, z, spherePos[j][0], spherePos[j][1])) {
-                    validPosition = false;
-                    break;
-                }
-            }
-        }
-
-        // ġ 
-        spherePos[i][0] = x;
-        spherePos[i][1] = z;
-    }
-
-}
-
-
-bool SetupBlueBall(CSphere& blueBall, float spherePos[BALLNUM][2], LPDIRECT3DDEVICE9 device) {  // Ķ  ġ 
-    std::srand(static_cast<unsigned int>(std::time(nullptr)));  //  õ 
-    //blue Activated θ random 
-
-    blueBall.destroy();
-
-    blueActivated = (std::rand() % 3 == 0);
-
-    if (false == blueActivated || false == blueBall.create(device, d3d::BLUE)) return false;
-
-    bool validPosition = false;
-    float blueX, blueZ;
+    PROF_ZONE("Setup");
 
-    while (!validPosition) {
-        //  ġ 
-        blueX = WALL_X_MIN + static_cast<float>(std::rand()) / RAND_MAX * (WALL_X_MAX - WALL_X_MIN);
-        blueZ = WALL_Z_MIN + static_cast<float>(std::rand()) / RAND_MAX * (WALL_Z_MAX - WALL_Z_MIN);
-
-        // sphere 迭  浹  Ȯ
-        validPosition = true;
-        for (int i = 0; i < BALLNUM; ++i) {
-            if (isColliding(blueX, blueZ, spherePos[i][0], spherePos[i][1])) {
-                validPosition = false;
-                break;
-            }
-        }
-    }
-
-    blueBall.setCenter(blueX, (float)M_RADIUS, blueZ);
-    blueBall.setPower(0, 0);
-    return true;
-}
-
-bool checkLevelUp(int destroyNum) {  //    Ȯ  ( BALLNUM   ̻ ؾϴ°ɷ   )
-    const int score_per_level = BALLNUM / 2;
-
-    if (destroyNum >= level * score_per_level) {  //    ʱȭ ʰ Ǳ  level  
-        return true;
-    }
-    return false;
-}
-
-void levelUp() {  //     ӵ +2  ȴ.
-    life = LIFENUM;
-    level++;
-    speed += 1.5;
-
-    resetGame();
-
-    generateRandomPositions(spherePos);
-    for (int i = 0; i < BALLNUM; ++i) {  //   
-        g_sphere[i].create(Device, sphereColor[i]);
-        g_sphere[i].setCenter(spherePos[i][0], (float)M_RADIUS, spherePos[i][1]);
-        g_sphere[i].setPower(0, 0);
-    }
-
-    SetupBlueBall(g_target_blueball, spherePos, Device);
-}
-
-bool SetupFonts(LPDIRECT3DDEVICE9 Device, ID3DXFont*& g_pFont_life, ID3DXFont*& g_pFont_endMess, ID3DXFont*& g_pFont_level, ID3DXFont*& g_pFont_start) {  // ȭ鿡    font ü 
-    D3DXFONT_DESC fontDesc = {
-        24, // Height
-        0,  // Width
-        0,  // Weight
-        0,  // MipLevels
-        FALSE, // Italic
-        DEFAULT_CHARSET, // CharSet
-        OUT_DEFAULT_PRECIS, // OutputPrecision
-        CLIP_DEFAULT_PRECIS, // Quality
-        DEFAULT_PITCH, // PitchAndFamily
-        "Arial" // FaceName
-    };
-
-    // Create font for start
-    if (FAILED(D3DXCreateFontIndirect(Device, &fontDesc, &g_pFont_start))) {
-        ::MessageBox(0, "D3DXCreateFontIndirect() for g_pFont_start - FAILED", 0, 0);
-        return false;
-    }
-    // Create font for level
-    if (FAILED(D3DXCreateFontIndirect(Device, &fontDesc, &g_pFont_level))) {
-        ::MessageBox(0, "D3DXCreateFontIndirect() for g_pFont_level - FAILED", 0, 0);
-        return false;
+    //   ʱȭ ( , Ķ  ġ  ,  )
+    //   ù    
+    //      ̺ ϳ  ġ  ʰ 
+    unsigned long long seed = sim::clockSeed();
+    if (g_levelPack.isOpen())
+    {
+        int table = (int)(seed % (unsigned long long)g_levelPack.getTables());
+        seed = g_levelPack.getTableSeed(table);
+        g_sim.getGame().setLevelPack(&g_levelPack, table);
     }
-
-    // Create font for life & score
-    if (FAILED(D3DXCreateFontIndirect(Device, &fontDesc, &g_pFont_life))) {
-        ::MessageBox(0, "D3DXCreateFontIndirect() for g_pFont_life - FAILED", 0, 0);
+    if (!g_sim.start(seed))
         return false;
-    }
-
-    // Create font for end message
-    if (FAILED(D3DXCreateFontIndirect(Device, &fontDesc, &g_pFont_endMess))) {
-        ::MessageBox(0, "D3DXCreateFontIndirect() for g_pFont_endMess - FAILED", 0, 0);
-        return false;
-    }
-
-    return true;
-}
-
-// ʱȭ
-bool Setup()
-{
-    spaceActivate = 0;
-    destroyNum = 0;
-    win = false;
-    std::srand(static_cast<unsigned int>(std::time(nullptr)));  //  õ 
-    //blue Activated θ random 
-    blueActivated = (std::rand() % 3 == 0);
-    int i;
-    life = LIFENUM;
+    g_sim.sample(g_frame);
 
     D3DXMatrixIdentity(&g_mWorld);
     D3DXMatrixIdentity(&g_mView);
     D3DXMatrixIdentity(&g_mProj);
 
-    //  
-    if (!SetupFonts(Device, g_pFont_life, g_pFont_endMess, g_pFont_level, g_pFont_start)) {
-        return false;
-    }
-
-    // create plane and set the position
-    if (false == g_legoPlane.create(Device, -1, -1, 6, 0.03f, 7, d3d::GREEN)) return false;
-    g_legoPlane.setPosition(0.0f, -0.0006f / 5, 0.0f);
-
-    //  3 
-    if (false == g_legowall[0].create(Device, -1, -1, 6, 0.3f, 0.12f, d3d::DARKRED)) return false;
-    g_legowall[0].setPosition(0.0f, 0.12f, 3.5);
-    if (false == g_legowall[1].create(Device, -1, -1, 0.12f, 0.3f, 7.12, d3d::DARKRED)) return false;
-    g_legowall[1].setPosition(3, 0.12f, 0.0f);
-    if (false == g_legowall[2].create(Device, -1, -1, 0.12f, 0.3f, 7.12, d3d::DARKRED)) return false;
-    g_legowall[2].setPosition(-3, 0.12f, 0.0f);
+    // ,  3, ,  ǥ ޽  (   ޽ ϳ )
+    g_scene.setup(g_renderList, g_meshCache);
+    if (false == g_renderBackend.create(Device, g_meshCache)) return false;
 
-    generateRandomPositions(spherePos);  //    ġ 
-
-    for (int i = 0; i < BALLNUM; ++i) {  //   
-        if (false == g_sphere[i].create(Device, sphereColor[i])) return false;
-        g_sphere[i].setCenter(spherePos[i][0], (float)M_RADIUS, spherePos[i][1]);
-        g_sphere[i].setPower(0, 0);
-    }
-
-    // Ķ  
-    if (SetupBlueBall(g_target_blueball, spherePos, Device)) {
-        g_target_blueball.setPower(0, 0);
+    //   (Arial 24)
+    if (false == g_renderBackend.createFont("Arial", 24, g_glyphAtlas)) {
+        ::MessageBox(0, "createFont() - FAILED", 0, 0);
+        return false;
     }
-
-    //   
-    if (false == g_target_redball.create(Device, d3d::RED)) return false;
-    g_target_redball.setCenter(0, (float)M_RADIUS, -3.5f + 0.06f + 3 * g_target_redball.getRadius());
-    g_target_redball.setPower(0, 0);
-
-    //   
-    if (false == g_target_whiteball.create(Device, d3d::WHITE)) return false;
-    g_target_whiteball.setCenter(0, (float)M_RADIUS, -3.5f + 0.06f + 1 * g_target_redball.getRadius());
+    g_hud.setAtlas(&g_glyphAtlas);
 
     // light setting 
     D3DLIGHT9 lit;
@@ -759,162 +201,116 @@ bool Setup()
         (float)Width / (float)Height, 1.0f, 100.0f);
     Device->SetTransform(D3DTS_PROJECTION, &g_mProj);
 
+    // ȭ  ü ׸ ʰ, ۰ ̴     ޽÷ ׸
+    render::Matrix view, proj;
+    memcpy(&view, &g_mView, sizeof(view));
+    memcpy(&proj, &g_mProj, sizeof(proj));
+    g_scene.setView(view, proj, Height);
+
     // Set render states.
     Device->SetRenderState(D3DRS_LIGHTING, TRUE);
     Device->SetRenderState(D3DRS_SPECULARENABLE, TRUE);
     Device->SetRenderState(D3DRS_SHADEMODE, D3DSHADE_GOURAUD);
 
     g_light.setLight(Device, g_mWorld);
+    D3DXVECTOR3 lightPos = g_light.getPosition();
+    g_scene.setLightPosition(lightPos.x, lightPos.y, lightPos.z);
     return true;
 }
 
 void Cleanup(void)
 {
-    g_legoPlane.destroy();
-    for (int i = 0; i < 3; i++) {
-        g_legowall[i].destroy();
+    g_sim.stop();
+    if (g_replayPath[0] != '\0') {
+        g_replay.end(g_sim.getGame());
+        g_replay.save(g_replayPath);
+    }
+    g_renderBackend.destroy();
+    g_scene.release();
+    if (prof::isEnabled()) {
+        prof::setEnabled(false);
+        prof::writeChromeTrace(g_tracePath);
     }
-    destroyAllLegoBlock();
-    g_light.destroy();
+}
+
+//  Ӻ ð ϰ 60 Ӹ â   ǥ
+void UpdateFrameTime(void)
+{
+    unsigned long long now = prof::now();
+    if (g_frameStart != 0)
+        g_frameTimes.add(prof::ticksToNanos(now - g_frameStart));
+    g_frameStart = now;
+
+    static int frames = 0;
+    if (++frames % 60 != 0)
+        return;
+    char title[128];
+    snprintf(title, sizeof(title), "Virtual Billiard - frame p50 %.2f ms  p99 %.2f ms  p99.9 %.2f ms%s",
+        g_frameTimes.getPercentile(50) * 1e-6, g_frameTimes.getPercentile(99) * 1e-6,
+        g_frameTimes.getPercentile(99.9) * 1e-6, prof::isEnabled() ? "  [trace]" : "");
+    g_platform.setTitle(title);
 }
 
 // timeDelta represents the time between the current image frame and the last image frame.
-// the distance of moving balls should be "velocity * timeDelta"
+// the balls are moved by the simulation thread at a fixed tick, so it is not used for physics
 bool Display(float timeDelta)
 {
-    int i = 0;
-    int j = 0;
-
-
     if (Device)
     {
+        UpdateFrameTime();
+        PROF_ZONE("frame");
         Device->Clear(0, 0, D3DCLEAR_TARGET | D3DCLEAR_ZBUFFER, 0x00afafaf, 1.0f, 0);
         Device->BeginScene();
 
-        // redball 
-        g_target_redball.ballUpdate(timeDelta);
-
-        // ʵ带   destroyϰ life 
-        if (g_target_redball.getCenter().z < -3.5) {
-            g_target_redball.destroy();
-            if (life == 1) {
-                life--;
-            }
-            if (life > 1) {
-                life--;
-                resetGame();
-            }
-        }
-
-        //   浹ߴ Ȯ
-        for (j = 0; j < 3; j++) {
-            g_legowall[j].hitBy(g_target_redball);
-        }
-
-        //     ġ
-        g_target_redball.hitBy(g_target_whiteball);
-
-        // Ķ  ( ߰) 浹ߴ Ȯ
-        if (!g_target_blueball.isNull()) {
-            if (g_target_redball.hasIntersected(g_target_blueball)) {
-                g_target_blueball.destroy();
-                life++;
-            }
-        }
-
-        for (j = 0; j < BALLNUM; j++) {  //   浹ߴ Ȯ
-            if (g_sphere[j].isNull() == false) {
-                if (g_target_redball.hitBy(g_sphere[j])) {  // 浹ߴٸ true ϵǱ⿡ 浹  destroy
-                    g_sphere[j].destroy();
-                    destroyNum++;
-                }
-            }
-        }
-
-        // draw plane, walls, and spheres
-        g_legoPlane.draw(Device, g_mWorld);
-        for (i = 0; i < BALLNUM; i++) {
-            if (g_sphere[i].isNull() == false) {
-                // destroyed  ° ƴ϶
-                g_sphere[i].draw(Device, g_mWorld);
-            }
-        }
-        for (i = 0; i < 3; i++) {
-            g_legowall[i].draw(Device, g_mWorld);
-        }
-        if (g_target_redball.isNull() == true) {
-            //   ٸ
-        }
-        else {
-            g_target_redball.draw(Device, g_mWorld);
+        //  ̵, 浹, // ó  忡 (simThread)
+        {
+            PROF_ZONE("sample");
+            g_sim.sample(g_frame);
         }
-        g_target_whiteball.draw(Device, g_mWorld);
 
-        if (!g_target_blueball.isNull()) {
-            // Ķ ų μ ʾҴٸ
-            g_target_blueball.draw(Device, g_mWorld);
+        // draw plane, walls, live spheres and the light
+        // (μ  ,     ,  Ķ   )
+        render::SceneStats drawn;
+        {
+            PROF_ZONE("draw");
+            render::Matrix world;
+            memcpy(&world, &g_mWorld, sizeof(world));
+            g_renderList.clear();
+            drawn = g_scene.record(g_frame, world, g_renderList);
+            g_renderList.sort();
+            render::submit(g_renderList, g_renderBackend);
         }
 
-        g_light.draw(Device);
-
-
-        // Life  Score ؽƮ 
-        RECT rect_life = { 50, 50, 0, 0 };  // ȭ  ܿ ġ
-        char str[100] = "Life : ";
-        char buff[100];
-        itoa(life, buff, 10);
-        strcat(str, buff);
-        strcat(str, "\nScore : ");
-        itoa(destroyNum, buff, 10);
-        strcat(str, buff);
-
-        g_pFont_life->DrawText(NULL, str, -1, &rect_life, DT_NOCLIP, D3DCOLOR_XRGB(0, 0, 0));
 
-        // Level ؽƮ 
-        RECT rect_level = { 800, 50, 0, 0 };  // ȭ  ܿ ġ
-        char levelStr[50] = "Level: ";
-        itoa(level, buff, 10);
-        strcat(levelStr, buff);
-        g_pFont_level->DrawText(NULL, levelStr, -1, &rect_level, DT_NOCLIP, D3DCOLOR_XRGB(0, 0, 0));
-
-        // Press Space to Start ޽  (ȭ ϴ ߾)
-        RECT rect_start = { 400, 650, 0, 0 };  // ϴ ߾ ġ
-        g_pFont_start->DrawTextA(NULL, "Press Space to Start", -1, &rect_start, DT_NOCLIP, D3DCOLOR_XRGB(0, 0, 0));
-
-
-        //  
-        if (destroyNum == BALLNUM * level) {  //     (level  ִ  destroyNum (score)  ʱȭ ʱ )
-            levelUp();
-        }
-
-        else {  //     
-            if (life == 0) {  //  0 
-                if (checkLevelUp(destroyNum)) {  //    Ǻ (BALLNUM   ̻ )
-                    if (level == 5) {  // ̹  5 ()   WIN
-                        win = true;
-                        RECT rect_endMess = { 330, 300,0,0 };
-                        g_target_redball.setPower(0, 0);
-                        g_pFont_endMess->DrawTextA(NULL, "YOU WIN! Press ESC to quit game", -1, &rect_endMess, DT_NOCLIP, D3DCOLOR_XRGB(0, 0, 0));
-                    }
-                    else {  //  5  ƴ  
-                        levelUp();
-                    }
-                }
-                else {  // BALLNUM   ̻    LOSE
-                    RECT rect_endMess = { 330, 300,0,0 };
-                    g_pFont_endMess->DrawTextA(NULL, "Defeated. Press ESC to quit game", -1, &rect_endMess, DT_NOCLIP, D3DCOLOR_XRGB(0, 0, 0));
-                }
-            }
+        // Life, Score, Level, ȳ   ޽: ° ٲ ӿ  ġ ٽ ϰ
+        // (  simCore  ó)  ڸ   ׸
+        {
+            PROF_ZONE("hud");
+            render::HudState hud;
+            hud.life = g_frame.life;
+            hud.score = g_frame.destroyNum;
+            hud.level = g_frame.level;
+            hud.win = g_frame.win;
+            hud.defeated = g_frame.defeated;
+            hud.objects = drawn.objects;
+            hud.drawn = drawn.objects - drawn.culled;
+            hud.triangles = drawn.triangles;
+            g_hud.update(hud);
+            g_hud.submit(g_renderBackend);
         }
 
         Device->EndScene();
-        Device->Present(0, 0, 0, 0);
+        {
+            PROF_ZONE("present");
+            Device->Present(0, 0, 0, 0);
+        }
         Device->SetTexture(0, NULL);
     }
     return true;
 }
 
-LRESULT CALLBACK d3d::WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
+// Ű, 콺 Է (â ޽ platform  ̺Ʈ ȯ)
+void OnEvent(const platform::Event& e)
 {
     static bool wire = false;
     static bool isReset = true;
@@ -922,38 +318,31 @@ LRESULT CALLBACK d3d::WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
     static int old_y = 0;
     static enum { WORLD_MOVE, LIGHT_MOVE, BLOCK_MOVE } move = WORLD_MOVE;
 
-    switch (msg) {
-    case WM_DESTROY:
+    switch (e.type) {
+    case platform::EVENT_KEY_DOWN:
     {
-        ::PostQuitMessage(0);
-        break;
-    }
-    case WM_KEYDOWN:
-    {
-        switch (wParam) {
-        case VK_ESCAPE:
-            ::DestroyWindow(hwnd);
+        switch (e.key) {
+        case platform::KEY_ESCAPE:
+            g_platform.close();
             break;
-        case VK_RETURN:
+        case platform::KEY_RETURN:
             if (NULL != Device) {
                 wire = !wire;
                 Device->SetRenderState(D3DRS_FILLMODE,
                     (wire ? D3DFILL_WIREFRAME : D3DFILL_SOLID));
             }
             break;
-        case VK_SPACE:
-            if (spaceActivate == 0 && win == false) {
-                D3DXVECTOR3 targetpos = g_target_whiteball.getCenter();
-                D3DXVECTOR3   whitepos = g_target_redball.getCenter();
-                double theta = acos(sqrt(pow(targetpos.x - whitepos.x, 2)) / sqrt(pow(targetpos.x - whitepos.x, 2) +
-                    pow(targetpos.z - whitepos.z, 2)));      // ⺻ 1 и
-                if (targetpos.z - whitepos.z <= 0 && targetpos.x - whitepos.x >= 0) { theta = -theta; }   //4 и
-                if (targetpos.z - whitepos.z >= 0 && targetpos.x - whitepos.x <= 0) { theta = PI - theta; } //2 и
-                if (targetpos.z - whitepos.z <= 0 && targetpos.x - whitepos.x <= 0) { theta = PI + theta; } // 3 и
-                double distance = sqrt(pow(targetpos.x - whitepos.x, 2) + pow(targetpos.z - whitepos.z, 2));
-                //g_sphere[3].setPower(distance * cos(theta), distance * sin(theta));
-                g_target_redball.setPower(0, speed);  //   ӵ  
-                spaceActivate = 1;  // ó ߻ ÿ space   Ȱȭ
+        case platform::KEY_SPACE:
+            g_sim.launch();  // ó ߻ ÿ  ( ƽ )
+            break;
+        case 'T':
+            if (!prof::isEnabled()) {
+                prof::clear();
+                prof::setEnabled(true);
+            }
+            else {
+                prof::setEnabled(false);
+                prof::writeChromeTrace(g_tracePath);
             }
             break;
 
@@ -961,14 +350,14 @@ LRESULT CALLBACK d3d::WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
         break;
     }
 
-    case WM_MOUSEMOVE:
+    case platform::EVENT_MOUSE_MOVE:
     {
-        int new_x = LOWORD(lParam);
-        int new_y = HIWORD(lParam);
+        int new_x = e.x;
+        int new_y = e.y;
         float dx;
         float dy;
 
-        if (LOWORD(wParam) & MK_RBUTTON) {
+        if (e.buttons & platform::BUTTON_RIGHT) {
 
             if (isReset) {
                 isReset = false;
@@ -999,37 +388,62 @@ LRESULT CALLBACK d3d::WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
         else {
             isReset = true;
 
-            if (life > 0 && win == false) {
-                dx = (old_x - new_x);// * 0.01f;
-                D3DXVECTOR3 coord3d = g_target_whiteball.getCenter();
-                D3DXVECTOR3 coord3d_W = g_target_redball.getCenter();
-                if ((coord3d.x + dx * (-0.007f) > -3 + g_target_whiteball.getRadius() + 0.06f) && (coord3d.x + dx * (-0.007f) < 3 - g_target_whiteball.getRadius() - 0.06f)) {
-                    g_target_whiteball.setCenter(coord3d.x + dx * (-0.007f), coord3d.y, coord3d.z);
-                    if (spaceActivate == 0) {
-                        g_target_redball.setCenter(coord3d_W.x + dx * (-0.007f), coord3d_W.y, coord3d_W.z);
-                    }
-                }
-            }
+            g_sim.movePaddle(new_x - old_x);  //   ̵, ȼ  ( ְ ¸  )
             old_x = new_x;
 
             move = WORLD_MOVE;
         }
         break;
     }
+    default:
+        break;
     }
-
-    return ::DefWindowProc(hwnd, msg, wParam, lParam);
 }
 
+// d3d::EnterMsgLoop :   ̺Ʈ  ó    ׸
+class CBilliardApp : public platform::IApplication {
+public:
+    void onEvent(const platform::Event& e) { OnEvent(e); }
+    //  ð ũ  ( ð 0.0007 / ms)
+    bool frame(unsigned int micros) { return Display(sim::deltaFromMicros(micros)); }
+};
+
 int WINAPI WinMain(HINSTANCE hinstance,
     HINSTANCE prevInstance,
     PSTR cmdLine,
     int showCmd)
 {
-    srand(static_cast<unsigned int>(time(NULL)));
+    // -dynamic:    ̸  浹
+    if (cmdLine != NULL && strstr(cmdLine, "-dynamic") != NULL)
+        g_sim.getGame().setDynamic(true);
+
+    // -friction:   ,      ʰ ٽ е 
+    if (cmdLine != NULL && strstr(cmdLine, "-friction") != NULL)
+        g_sim.getGame().setFriction(true);
+
+    // -record <>:   Է  
+    const char* record = cmdLine != NULL ? strstr(cmdLine, "-record ") : NULL;
+    if (record != NULL && sscanf(record + 8, "%259s", g_replayPath) == 1)
+        g_sim.setRecorder(&g_replay);
+
+    // -pack <>:   ġ ÷ (  ٸ )
+    const char* pack = cmdLine != NULL ? strstr(cmdLine, "-pack ") : NULL;
+    char packPath[MAX_PATH];
+    if (pack != NULL && sscanf(pack + 6, "%259s", packPath) == 1 && g_levelPack.open(packPath) &&
+        g_levelPack.getBallNum() != g_sim.getGame().getBallNum())
+        g_levelPack.close();
+
+    // -trace <>: ۺ   (T Ű    )
+    const char* trace = cmdLine != NULL ? strstr(cmdLine, "-trace ") : NULL;
+    if (trace != NULL && sscanf(trace + 7, "%259s", g_tracePath) == 1)
+        prof::setEnabled(true);
+    prof::setThreadName("main");
+
+    if (!g_platform.createWindow("Virtual Billiard", Width, Height))
+        return 0;
+    g_sim.setClock(&g_platform.getClock());
 
-    if (!d3d::InitD3D(hinstance,
-        Width, Height, true, D3DDEVTYPE_HAL, &Device))
+    if (!d3d::InitD3D((HWND)g_platform.getNativeWindow(), true, D3DDEVTYPE_HAL, &Device))
     {
         ::MessageBox(0, "InitD3D() - FAILED", 0, 0);
         return 0;
@@ -1041,7 +455,8 @@ int WINAPI WinMain(HINSTANCE hinstance,
         return 0;
     }
 
-    d3d::EnterMsgLoop(Display);
+    CBilliardApp app;
+    platform::runLoop(g_platform, app);
 
     Cleanup();
 
@@ -0,0 +1,136 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// File: workPool.cpp
+//
+// Desc: Work-stealing thread pool for data parallel loops.
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "workPool.h"
+#include "profiler.h"
+#include <algorithm>
+#include <cstdio>
+
+// polls of the job counter before an idle worker goes to sleep
+static const int SPIN_COUNT = 20000;
+
+sim::CWorkPool::CWorkPool(int workers)
+{
+	if (workers <= 0)
+		workers = (int)std::thread::hardware_concurrency();
+	if (workers <= 0)
+		workers = 1;
+
+	m_workers = workers;
+	m_ranges = new Range[workers];
+	m_job = NULL;
+	m_context = NULL;
+	m_grain = 1;
+	m_generation = 0;
+	m_active = 0;
+	m_quit = false;
+	m_sleeping = 0;
+
+	for (int w = 1; w < workers; w++)
+		m_threads.push_back(std::thread(&CWorkPool::workerLoop, this, w));
+}
+
+sim::CWorkPool::~CWorkPool(void)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_quit = true;
+	}
+	m_wake.notify_all();
+	for (size_t i = 0; i < m_threads.size(); i++)
+		m_threads[i].join();
+	delete[] m_ranges;
+}
+
+void sim::CWorkPool::run(int count, int grain, Job job, void* context)
+{
+	if (count <= 0)
+		return;
+	if (grain < 1)
+		grain = 1;
+	if (m_workers == 1 || count <= grain)
+	{
+		job(context, 0, count, 0);
+		return;
+	}
+
+	for (int w = 0; w < m_workers; w++)
+	{
+		m_ranges[w].next.store((int)((long long)count * w / m_workers), std::memory_order_relaxed);
+		m_ranges[w].end = (int)((long long)count * (w + 1) / m_workers);
+	}
+	m_job = job;
+	m_context = context;
+	m_grain = grain;
+	m_active.store(m_workers - 1, std::memory_order_relaxed);
+	m_generation.fetch_add(1, std::memory_order_release);
+
+	{
+		// a worker checks the counter under the lock before it waits, so it can not miss this
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_sleeping > 0)
+			m_wake.notify_all();
+	}
+
+	work(0);
+
+	while (m_active.load(std::memory_order_acquire) > 0)
+		std::this_thread::yield();
+}
+
+void sim::CWorkPool::work(int worker)
+{
+	// own range first, then steal from the others
+	for (int k = 0; k < m_workers; k++)
+	{
+		Range& range = m_ranges[(worker + k) % m_workers];
+		for (;;)
+		{
+			int begin = range.next.fetch_add(m_grain, std::memory_order_relaxed);
+			if (begin >= range.end)
+				break;
+			m_job(m_context, begin, std::min(begin + m_grain, range.end), worker);
+		}
+	}
+}
+
+void sim::CWorkPool::workerLoop(int worker)
+{
+	char name[32];
+	snprintf(name, sizeof(name), "worker %d", worker);
+	prof::setThreadName(name);
+
+	int seen = 0;
+	for (;;)
+	{
+		int generation = seen;
+		for (int spin = 0; spin < SPIN_COUNT && generation == seen; spin++)
+		{
+			if (m_quit.load(std::memory_order_relaxed))
+				return;
+			generation = m_generation.load(std::memory_order_acquire);
+		}
+
+		if (generation == seen)
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_sleeping++;
+			m_wake.wait(lock, [&]() {
+				return m_quit.load(std::memory_order_relaxed) || m_generation.load(std::memory_order_acquire) != seen;
+			});
+			m_sleeping--;
+			if (m_quit.load(std::memory_order_relaxed))
+				return;
+			generation = m_generation.load(std::memory_order_acquire);
+		}
+
+		seen = generation;
+		work(worker);
+		m_active.fetch_sub(1, std::memory_order_release);
+	}
+}
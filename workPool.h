@@ -0,0 +1,78 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// File: workPool.h
+//
+// Desc: Small work-stealing thread pool for data parallel loops. parallelFor splits [0, count)
+//       into one contiguous range per worker; a worker takes grain sized chunks from the front
+//       of its own range and, once it is empty, steals chunks from the other ranges. Chunks are
+//       claimed with one atomic add, so there is no lock on the work path.
+//
+//       The calling thread runs as worker 0. Idle workers spin for a short while before they
+//       sleep, so back to back loops (one per solver colour) do not pay a wake up each time.
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __workPoolH__
+#define __workPoolH__
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace sim
+{
+	class CWorkPool {
+	public:
+		explicit CWorkPool(int workers = 0);  // 0: one worker per hardware thread
+		~CWorkPool(void);
+
+		int getWorkers(void) const { return m_workers; }
+
+		// calls f(begin, end, worker) over chunks of at most grain indices covering [0, count);
+		// worker is in [0, getWorkers()) and can index per worker scratch. Returns once every
+		// chunk ran. Only one thread may call parallelFor at a time.
+		template <class F> void parallelFor(int count, int grain, F& f)
+		{
+			run(count, grain, &invoke<F>, &f);
+		}
+
+	private:
+		typedef void (*Job)(void* context, int begin, int end, int worker);
+
+		template <class F> static void invoke(void* context, int begin, int end, int worker)
+		{
+			(*static_cast<F*>(context))(begin, end, worker);
+		}
+
+		struct Range
+		{
+			std::atomic<int>    next;
+			int                 end;
+			char                pad[64 - sizeof(std::atomic<int>) - sizeof(int)];  // one range per cache line
+		};
+
+		void run(int count, int grain, Job job, void* context);
+		void work(int worker);
+		void workerLoop(int worker);
+
+		int                         m_workers;
+		Range*                      m_ranges;
+		std::vector<std::thread>    m_threads;
+
+		Job                         m_job;
+		void*                       m_context;
+		int                         m_grain;
+
+		std::atomic<int>            m_generation;  // bumped once per parallelFor
+		std::atomic<int>            m_active;      // workers still running the current loop
+		std::atomic<bool>           m_quit;
+
+		std::mutex                  m_mutex;
+		std::condition_variable     m_wake;
+		int                         m_sleeping;  // guarded by m_mutex
+	};
+}
+
+#endif // __workPoolH__